@@ -34,9 +34,9 @@ public:
 		return 0;
 	}
 
-	basic_handler(const elliptics::logger *logger, async_generic_result &result) :
+	basic_handler(const elliptics::logger *logger, async_generic_result &result, bool replicated = false) :
 		m_logger(*logger),
-		m_handler(result), m_completed(0), m_total(0)
+		m_handler(result), m_completed(0), m_total(0), m_replicated(replicated)
 	{
 	}
 
@@ -52,8 +52,20 @@ public:
 			dnet_flags_dump_cflags(cmd->flags), uint64_t(cmd->trans), int(cmd->status), uint64_t(cmd->size),
 			!(cmd->flags & DNET_FLAGS_REPLY), !(cmd->flags & DNET_FLAGS_MORE));
 
+		/*
+		 * Replicated write: node of the first group relays replies of every group with DNET_FLAGS_MORE
+		 * and completes the transaction by the empty reply, which is not a result of any group.
+		 */
+		if (m_replicated && !(cmd->flags & DNET_FLAGS_MORE) && !cmd->status)
+			return false;
+
 		auto data = std::make_shared<callback_result_data>(addr, cmd);
 
+		if (m_replicated && (cmd->flags & DNET_FLAGS_MORE) && (cmd->status || !cmd->size)) {
+			dnet_cmd *reply = reinterpret_cast<dnet_cmd *>(data->data.data<char>() + sizeof(dnet_addr));
+			reply->flags &= ~DNET_FLAGS_MORE;
+		}
+
 		if (cmd->status)
 			data->error = create_error(*cmd);
 
@@ -69,9 +81,17 @@ public:
 	}
 
 	bool set_total(size_t total)
+	{
+		return set_total(total, total);
+	}
+
+	/*
+	 * Expects @total results which are received by @transactions transactions
+	 */
+	bool set_total(size_t total, size_t transactions)
 	{
 		m_handler.set_total(total);
-		m_total = total + 1;
+		m_total = transactions + 1;
 		return increment_completed();
 	}
 
@@ -90,6 +110,7 @@ private:
 	async_result_handler<callback_result_entry> m_handler;
 	std::atomic_size_t m_completed;
 	std::atomic_size_t m_total;
+	const bool m_replicated;
 };
 
 } // namespace detail
@@ -208,6 +229,28 @@ async_generic_result send_to_groups(session &sess, dnet_io_control &control)
 	return send_impl(sess, control, send_to_groups_io_impl);
 }
 
+// Send replicated write to the first session's group, its node writes the object to the rest groups
+async_generic_result send_replicated(session &sess, dnet_io_control &control)
+{
+	scoped_trace_id guard(sess);
+	async_generic_result result(sess);
+
+	dnet_session *native = sess.get_native();
+	detail::basic_handler *handler = new detail::basic_handler(sess.get_native_node()->log, result, true);
+
+	control.complete = detail::basic_handler::handler;
+	control.priv = handler;
+	control.id.group_id = native->groups[0];
+
+	dnet_io_trans_alloc_send(native, &control);
+
+	/* results of every group are received by the single transaction, which is destroyed even on error */
+	if (handler->set_total(native->group_num, 1))
+		delete handler;
+
+	return result;
+}
+
 async_generic_result send_srw_command(session &sess, dnet_id *id, sph *srw_data)
 {
 	scoped_trace_id guard(sess);
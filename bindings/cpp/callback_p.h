@@ -146,7 +146,18 @@ struct entry_converter
 
 	static void convert(read_result_entry &entry, callback_result_data *)
 	{
-		dnet_convert_io_attr(entry.io_attribute());
+		dnet_io_attr *io = entry.io_attribute();
+		dnet_convert_io_attr(io);
+
+		if (!(io->flags & DNET_IO_FLAGS_READ_RANGES) || entry.data().size() < sizeof(dnet_io_attr) + sizeof(dnet_io_ranges))
+			return;
+
+		dnet_io_ranges *ranges = reinterpret_cast<dnet_io_ranges *>(io + 1);
+		dnet_convert_io_ranges(ranges);
+
+		const size_t max_num = (entry.data().size() - sizeof(dnet_io_attr) - sizeof(dnet_io_ranges)) / sizeof(dnet_io_range);
+		for (uint32_t i = 0; i < std::min<size_t>(ranges->num, max_num); ++i)
+			dnet_convert_io_range(&ranges->ranges[i]);
 	}
 
 	static void convert(backend_status_result_entry &, callback_result_data *)
@@ -183,6 +194,9 @@ async_generic_result send_to_each_node(session &sess, const transport_control &c
 async_generic_result send_to_groups(session &sess, const transport_control &control);
 async_generic_result send_to_groups(session &sess, dnet_io_control &control);
 
+// Send replicated write to the first session's group
+async_generic_result send_replicated(session &sess, dnet_io_control &control);
+
 async_generic_result send_srw_command(session &sess, dnet_id *id, sph *srw_data);
 
 template <typename Handler, typename Entry>
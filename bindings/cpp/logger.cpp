@@ -14,6 +14,16 @@
 
 #include <boost/io/ios_state.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
 __thread trace_id_t backend_trace_id_hook;
 
 namespace ioremap { namespace elliptics {
@@ -220,6 +230,303 @@ void dnet_log_set_verbosity(dnet_logger *logger, dnet_log_level level)
 	logger->log().verbosity(level);
 }
 
+namespace ioremap { namespace elliptics {
+
+/*
+ * Asynchronous logging: records are opened and filled by the calling thread,
+ * but they are formatted and written to the sink by the background thread.
+ * Each thread puts its records into its own bounded ring,
+ * records which do not fit into the ring are dropped and counted.
+ * Only records of loggers which wrap the sink are captured, the others are written immediately.
+ */
+class async_log {
+public:
+	async_log(const std::shared_ptr<logger_base> &sink, size_t ring_size)
+	: m_sink(sink)
+	, m_generation(next_generation())
+	, m_ring_size(1)
+	, m_need_exit(false)
+	, m_dropped(0)
+	, m_reported_dropped(0)
+	{
+		while (m_ring_size < ring_size)
+			m_ring_size <<= 1;
+
+		m_thread = std::thread(std::bind(&async_log::run, this));
+	}
+
+	/*
+	 * Stops background thread and writes all captured records,
+	 * all threads which use this instance must be already stopped
+	 */
+	~async_log() {
+		{
+			std::unique_lock<std::mutex> guard(m_wait_lock);
+			m_need_exit = true;
+		}
+		m_wait.notify_one();
+		m_thread.join();
+	}
+
+	/*
+	 * Returns false if @logger does not write to the sink and record was not captured
+	 */
+	bool push(dnet_logger *logger, dnet_logger_record &&record) {
+		if (&logger->log() != m_sink.get())
+			return false;
+
+		ring &r = thread_ring();
+
+		const size_t tail = r.tail.load(std::memory_order_relaxed);
+		if (tail - r.head.load(std::memory_order_acquire) >= m_ring_size) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		new (&r.slots[tail & (m_ring_size - 1)]) dnet_logger_record(std::move(record));
+		r.tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	uint64_t dropped() const {
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	typedef std::aligned_storage<sizeof(dnet_logger_record), __alignof__(dnet_logger_record)>::type slot;
+
+	/*
+	 * Single-producer single-consumer ring of captured records,
+	 * it is shared by the producing thread and the instance,
+	 * @closed is set when the producer will not push records anymore
+	 */
+	struct ring {
+		ring(size_t size) : slots(new slot[size]), head(0), tail(0), closed(false) {}
+
+		std::unique_ptr<slot[]>	slots;
+		std::atomic<size_t>	head;
+		std::atomic<size_t>	tail;
+		std::atomic<bool>	closed;
+	};
+
+	/*
+	 * Ring of the current thread, @generation identifies instance which the ring belongs to,
+	 * addresses can not be used for that since new instance may be allocated at the address of destroyed one
+	 */
+	struct thread_state {
+		uint64_t		generation;
+		std::shared_ptr<ring>	ring_ptr;
+
+		~thread_state() {
+			if (ring_ptr)
+				ring_ptr->closed.store(true, std::memory_order_release);
+		}
+	};
+
+	static __thread thread_state *local_state;
+	static pthread_key_t local_state_key;
+	static pthread_once_t local_state_once;
+
+	static void destroy_local_state(void *data) {
+		delete static_cast<thread_state *>(data);
+		local_state = NULL;
+	}
+
+	static void create_local_state_key() {
+		pthread_key_create(&local_state_key, destroy_local_state);
+	}
+
+	static uint64_t next_generation() {
+		static std::atomic<uint64_t> generation(0);
+		return ++generation;
+	}
+
+	ring &thread_ring() {
+		if (local_state && local_state->generation == m_generation)
+			return *local_state->ring_ptr;
+
+		if (!local_state) {
+			pthread_once(&local_state_once, create_local_state_key);
+
+			std::unique_ptr<thread_state> state(new thread_state);
+			pthread_setspecific(local_state_key, state.get());
+			local_state = state.release();
+		}
+
+		// ring of the previous instance is closed and will be freed by it if it is still alive
+		if (local_state->ring_ptr) {
+			local_state->ring_ptr->closed.store(true, std::memory_order_release);
+			local_state->ring_ptr.reset();
+		}
+
+		auto r = std::make_shared<ring>(m_ring_size);
+		{
+			std::unique_lock<std::mutex> guard(m_rings_lock);
+			m_rings.push_back(r);
+		}
+
+		local_state->generation = m_generation;
+		local_state->ring_ptr = std::move(r);
+		return *local_state->ring_ptr;
+	}
+
+	/*
+	 * Writes all records captured by now, frees rings of exited threads,
+	 * returns number of written records
+	 */
+	size_t flush() {
+		std::vector<std::shared_ptr<ring>> rings;
+		{
+			std::unique_lock<std::mutex> guard(m_rings_lock);
+			rings = m_rings;
+		}
+
+		size_t count = 0;
+		bool need_cleanup = false;
+		for (auto it = rings.begin(); it != rings.end(); ++it) {
+			ring &r = **it;
+			// producer sets @closed after its last push, so check it before reading the tail
+			const bool closed = r.closed.load(std::memory_order_acquire);
+			const size_t tail = r.tail.load(std::memory_order_acquire);
+			size_t head = r.head.load(std::memory_order_relaxed);
+
+			for (; head != tail; ++head, ++count) {
+				auto record = reinterpret_cast<dnet_logger_record *>(&r.slots[head & (m_ring_size - 1)]);
+				try {
+					m_sink->push(std::move(*record));
+				} catch (...) {
+				}
+				record->~record_t();
+				r.head.store(head + 1, std::memory_order_release);
+			}
+
+			need_cleanup |= closed;
+		}
+
+		if (need_cleanup) {
+			std::unique_lock<std::mutex> guard(m_rings_lock);
+			m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(),
+				[] (const std::shared_ptr<ring> &r) {
+					return r->closed.load(std::memory_order_acquire) &&
+						r->head.load(std::memory_order_relaxed) == r->tail.load(std::memory_order_acquire);
+				}), m_rings.end());
+		}
+
+		return count;
+	}
+
+	/*
+	 * Report is written directly to the sink,
+	 * background thread does not capture its own records
+	 */
+	void report_dropped() {
+		const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+		if (dropped == m_reported_dropped)
+			return;
+
+		char buffer[128];
+		snprintf(buffer, sizeof(buffer), "async log: dropped %llu messages since start, ring size: %zu",
+			static_cast<unsigned long long>(dropped), m_ring_size);
+
+		try {
+			auto record = m_sink->open_record(DNET_LOG_ERROR);
+			if (record.valid()) {
+				record.attributes.insert(blackhole::keyword::message() = buffer);
+				m_sink->push(std::move(record));
+			}
+		} catch (...) {
+		}
+		m_reported_dropped = dropped;
+	}
+
+	void run() {
+		dnet_set_name("dnet_log");
+
+		while (!m_need_exit) {
+			if (flush())
+				continue;
+
+			report_dropped();
+
+			std::unique_lock<std::mutex> guard(m_wait_lock);
+			if (!m_need_exit)
+				m_wait.wait_for(guard, std::chrono::milliseconds(10));
+		}
+
+		flush();
+		report_dropped();
+	}
+
+	std::shared_ptr<logger_base>		m_sink;
+	const uint64_t				m_generation;
+	size_t					m_ring_size;
+
+	std::mutex				m_wait_lock;
+	std::condition_variable			m_wait;
+	std::atomic<bool>			m_need_exit;
+
+	std::atomic<uint64_t>			m_dropped;
+	uint64_t				m_reported_dropped;
+
+	std::mutex				m_rings_lock;
+	std::vector<std::shared_ptr<ring>>	m_rings;
+
+	std::thread				m_thread;
+};
+
+__thread async_log::thread_state *async_log::local_state = NULL;
+pthread_key_t async_log::local_state_key;
+pthread_once_t async_log::local_state_once = PTHREAD_ONCE_INIT;
+
+}} // namespace ioremap::elliptics
+
+static std::atomic<ioremap::elliptics::async_log *> dnet_async_log(NULL);
+
+int dnet_log_async_start(const std::shared_ptr<ioremap::elliptics::logger_base> &logger, size_t ring_size)
+{
+	if (!logger || !ring_size)
+		return -EINVAL;
+
+	try {
+		std::unique_ptr<ioremap::elliptics::async_log> async(new ioremap::elliptics::async_log(logger, ring_size));
+
+		ioremap::elliptics::async_log *expected = NULL;
+		if (!dnet_async_log.compare_exchange_strong(expected, async.get()))
+			return -EEXIST;
+
+		async.release();
+	} catch (...) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void dnet_log_async_stop()
+{
+	delete dnet_async_log.exchange(NULL);
+}
+
+int dnet_log_async_enabled()
+{
+	return dnet_async_log.load() != NULL;
+}
+
+uint64_t dnet_log_async_dropped()
+{
+	auto async = dnet_async_log.load();
+	return async ? async->dropped() : 0;
+}
+
+static void dnet_log_push(dnet_logger *logger, dnet_logger_record *record)
+{
+	auto async = dnet_async_log.load(std::memory_order_acquire);
+	if (async && async->push(logger, std::move(*record)))
+		return;
+
+	logger->push(std::move(*record));
+}
+
 static void dnet_log_add_message(dnet_logger_record *record, const char *format, va_list args)
 {
 	char buffer[2048];
@@ -243,7 +550,7 @@ void dnet_log_vwrite(dnet_logger *logger, dnet_logger_record *record, const char
 {
 	dnet_log_add_message(record, format, args);
 
-	logger->push(std::move(*record));
+	dnet_log_push(logger, record);
 }
 
 void dnet_log_write(dnet_logger *logger, dnet_logger_record *record, const char *format, ...)
@@ -253,7 +560,7 @@ void dnet_log_write(dnet_logger *logger, dnet_logger_record *record, const char
 	dnet_log_add_message(record, format, args);
 	va_end(args);
 
-	logger->push(std::move(*record));
+	dnet_log_push(logger, record);
 }
 
 void dnet_log_write_err(dnet_logger *logger, dnet_logger_record *record, int err, const char *format, ...)
@@ -265,7 +572,7 @@ void dnet_log_write_err(dnet_logger *logger, dnet_logger_record *record, int err
 	dnet_log_add_message(record, format, args);
 	va_end(args);
 
-	logger->push(std::move(*record));
+	dnet_log_push(logger, record);
 }
 
 void dnet_log_close_record(dnet_logger_record *record)
@@ -161,14 +161,59 @@ struct dnet_io_attr *read_result_entry::io_attribute() const
 	DNET_DATA_END(sizeof(dnet_io_attr));
 }
 
+// Data of the ranges which follows their list in the reply to DNET_IO_FLAGS_READ_RANGES read
+static data_pointer read_ranges_data(const data_pointer &file)
+{
+	const dnet_io_ranges *ranges = file.data<dnet_io_ranges>();
+	const size_t size = sizeof(dnet_io_ranges) + ranges->num * sizeof(dnet_io_range);
+
+	if (file.size() < size)
+		throw not_found_error("ranges list is out of data");
+
+	return file.skip(size);
+}
+
 data_pointer read_result_entry::file() const
 {
 	DNET_DATA_BEGIN();
-	return data()
+	data_pointer file = data()
 		.skip<struct dnet_io_attr>();
+
+	if (io_attribute()->flags & DNET_IO_FLAGS_READ_RANGES)
+		return read_ranges_data(file);
+
+	return file;
 	DNET_DATA_END(sizeof(dnet_io_attr));
 }
 
+std::vector<data_pointer> read_result_entry::ranges() const
+{
+	std::vector<data_pointer> result;
+
+	if (!(io_attribute()->flags & DNET_IO_FLAGS_READ_RANGES)) {
+		result.push_back(file());
+		return result;
+	}
+
+	DNET_DATA_BEGIN();
+	data_pointer file = data()
+		.skip<struct dnet_io_attr>();
+	const dnet_io_ranges *ranges = file.data<dnet_io_ranges>();
+	data_pointer range_data = read_ranges_data(file);
+
+	result.reserve(ranges->num);
+	for (uint32_t i = 0; i < ranges->num; ++i) {
+		if (range_data.size() < ranges->ranges[i].size)
+			throw not_found_error("range is out of data");
+
+		result.push_back(range_data.slice(0, ranges->ranges[i].size));
+		range_data = range_data.skip(ranges->ranges[i].size);
+	}
+
+	return result;
+	DNET_DATA_END(sizeof(dnet_io_attr) + sizeof(dnet_io_ranges));
+}
+
 lookup_result_entry::lookup_result_entry()
 {
 }
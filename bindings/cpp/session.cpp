@@ -19,8 +19,10 @@
 #include "functional_p.h"
 
 #include <cerrno>
+#include <ctime>
 #include <sstream>
 #include <functional>
+#include <random>
 
 #include "node_p.hpp"
 
@@ -715,6 +717,16 @@ uint64_t session::get_user_flags() const
 	return dnet_session_get_user_flags(m_data->session_ptr);
 }
 
+void session::set_ttl(uint64_t ttl)
+{
+	dnet_session_set_ttl(m_data->session_ptr, ttl);
+}
+
+uint64_t session::get_ttl() const
+{
+	return dnet_session_get_ttl(m_data->session_ptr);
+}
+
 void session::set_timestamp(const dnet_time &ts)
 {
 	dnet_session_set_timestamp(m_data->session_ptr, &ts);
@@ -769,10 +781,13 @@ class read_handler : public multigroup_handler<read_handler, read_result_entry>
 {
 public:
 	read_handler(const session &sess, const async_read_result &result,
-		std::vector<int> &&groups, const dnet_io_control &control) :
+		std::vector<int> &&groups, const dnet_io_control &control, const data_pointer &payload = data_pointer()) :
 		parent_type(sess, result, std::move(groups)),
-		m_control(control)
+		m_control(control),
+		m_payload(payload)
 	{
+		if (!m_payload.empty())
+			m_control.data = m_payload.data();
 	}
 
 	async_generic_result send_to_next_group()
@@ -816,6 +831,7 @@ public:
 
 		if (!error && !m_failed_groups.empty()
 				&& io
+				&& !(io->flags & DNET_IO_FLAGS_READ_RANGES)
 				&& (io->size == io->total_size)
 				&& (io->offset == 0)) {
 
@@ -852,6 +868,8 @@ public:
 
 private:
 	dnet_io_control m_control;
+	// request's data which follows io attributes, it has to live until the last group is asked
+	data_pointer m_payload;
 	read_result_entry m_read_result;
 	std::vector<int> m_failed_groups;
 };
@@ -889,6 +907,45 @@ async_read_result session::read_data(const key &id, int group, const dnet_io_att
 	return read_data(id, groups, io);
 }
 
+async_read_result session::read_ranges(const key &id, const std::vector<dnet_io_range> &ranges)
+{
+	DNET_SESSION_GET_GROUPS(async_read_result);
+
+	transform(id);
+
+	async_read_result result(*this);
+
+	if (ranges.empty()) {
+		async_result_handler<read_result_entry> handler(result);
+		handler.complete(create_error(-EINVAL, id, "read_ranges: no ranges to read"));
+		return result;
+	}
+
+	data_pointer payload = data_pointer::allocate(sizeof(dnet_io_ranges) + ranges.size() * sizeof(dnet_io_range));
+	dnet_io_ranges *io_ranges = payload.data<dnet_io_ranges>();
+	io_ranges->num = ranges.size();
+	io_ranges->reserved = 0;
+	memcpy(io_ranges->ranges, ranges.data(), ranges.size() * sizeof(dnet_io_range));
+
+	dnet_io_control control;
+	memset(&control, 0, sizeof(control));
+
+	control.fd = -1;
+	control.cmd = DNET_CMD_READ;
+	control.cflags = DNET_FLAGS_NEED_ACK;
+	control.id = id.id();
+
+	memcpy(control.io.id, control.id.id, DNET_ID_SIZE);
+	memcpy(control.io.parent, control.id.id, DNET_ID_SIZE);
+	control.io.flags = get_ioflags() | DNET_IO_FLAGS_READ_RANGES;
+
+	auto handler = std::make_shared<read_handler>(*this, result, std::move(groups), control, payload);
+	handler->set_total(1);
+	handler->start();
+
+	return result;
+}
+
 async_read_result session::read_data(const key &id, const std::vector<int> &groups, uint64_t offset, uint64_t size)
 {
 	transform(id);
@@ -970,6 +1027,9 @@ async_write_result session::write_data(const dnet_io_control &ctl)
 
 	memcpy(ctl_copy.io.id, ctl_copy.id.id, DNET_ID_SIZE);
 
+	if (!ctl_copy.io.expire && get_ttl())
+		ctl_copy.io.expire = time(NULL) + get_ttl();
+
 	if (dnet_time_is_empty(&ctl_copy.io.timestamp)) {
 		get_timestamp(&ctl_copy.io.timestamp);
 
@@ -978,6 +1038,10 @@ async_write_result session::write_data(const dnet_io_control &ctl)
 	}
 
 	session sess = clean_clone();
+
+	if ((ctl_copy.io.flags & DNET_IO_FLAGS_REPLICATE) && !sess.get_groups().empty())
+		return async_result_cast<write_result_entry>(*this, send_replicated(sess, ctl_copy));
+
 	return async_result_cast<write_result_entry>(*this, send_to_groups(sess, ctl_copy));
 }
 
@@ -1419,6 +1483,346 @@ async_write_result session::write_cache(const key &id, const argument_data &file
 	return write_data(ctl);
 }
 
+/*
+ * Manifest of the striped object, it is stored by the object's key.
+ * Fields are little-endian.
+ */
+struct striped_manifest
+{
+	uint64_t magic;
+	uint64_t size;
+	uint64_t stripe_size;
+	uint64_t stripe_count;
+	/* random number of the write, stripes of every version of the object have their own keys */
+	uint64_t generation;
+} __attribute__ ((packed));
+
+// "dnstripe"
+static const uint64_t striped_manifest_magic = 0x6570697274736e64ULL;
+
+static void convert_striped_manifest(striped_manifest *manifest)
+{
+	manifest->magic = dnet_bswap64(manifest->magic);
+	manifest->size = dnet_bswap64(manifest->size);
+	manifest->stripe_size = dnet_bswap64(manifest->stripe_size);
+	manifest->stripe_count = dnet_bswap64(manifest->stripe_count);
+	manifest->generation = dnet_bswap64(manifest->generation);
+}
+
+static error_info parse_striped_manifest(const key &id, const data_pointer &file, striped_manifest &manifest)
+{
+	if (file.size() != sizeof(striped_manifest))
+		return create_error(-EINVAL, id, "striped object: invalid manifest size: %zu", file.size());
+
+	memcpy(&manifest, file.data(), sizeof(striped_manifest));
+	convert_striped_manifest(&manifest);
+
+	if (manifest.magic != striped_manifest_magic || !manifest.stripe_size ||
+			manifest.stripe_count != (manifest.size + manifest.stripe_size - 1) / manifest.stripe_size)
+		return create_error(-EINVAL, id, "striped object: invalid manifest");
+
+	return error_info();
+}
+
+/*
+ * Stripe's key is the hash of object's id, write's generation and stripe's index,
+ * so stripes of the object are spread over the whole key space
+ */
+static key striped_key(const session &sess, const key &id, uint64_t generation, uint64_t index)
+{
+	std::string seed(id.raw_id().id, id.raw_id().id + DNET_ID_SIZE);
+
+	generation = dnet_bswap64(generation);
+	seed.append(reinterpret_cast<char *>(&generation), sizeof(generation));
+	index = dnet_bswap64(index);
+	seed.append(reinterpret_cast<char *>(&index), sizeof(index));
+
+	dnet_id stripe_id;
+	memset(&stripe_id, 0, sizeof(stripe_id));
+	sess.transform(seed, stripe_id);
+
+	return stripe_id;
+}
+
+/*
+ * Writes all stripes of the new generation in parallel, then the manifest,
+ * and then removes stripes of the previous generation.
+ * Stripes of the previous generation are not touched until the new manifest is written,
+ * so the previous version of the object stays readable until the new one is fully written.
+ */
+struct striped_write_handler : std::enable_shared_from_this<striped_write_handler>
+{
+	ELLIPTICS_DISABLE_COPY(striped_write_handler)
+
+	striped_write_handler(const session &sess, const async_write_result &result, const key &id,
+			const data_pointer &file, uint64_t stripe_size)
+		: sess(sess.clone()), handler(result), id(id), file(file), stripe_size(stripe_size),
+		generation(0), has_previous(false), pending(0)
+	{
+		this->sess.set_exceptions_policy(session::no_exceptions);
+		handler.set_total(1);
+	}
+
+	session sess;
+	async_result_handler<write_result_entry> handler;
+	key id;
+	data_pointer file;
+	uint64_t stripe_size;
+	uint64_t generation;
+
+	striped_manifest previous;
+	bool has_previous;
+	sync_write_result manifest_result;
+
+	std::mutex lock;
+	uint64_t pending;
+	error_info error;
+
+	void start() {
+		session read_sess = sess.clone();
+		read_sess.set_filter(filters::positive);
+
+		read_sess.read_data(id, 0, 0)
+			.connect(bind_method(shared_from_this(), &striped_write_handler::on_previous));
+	}
+
+	void on_previous(const sync_read_result &result, const error_info &err) {
+		// object which can't be read has no stripes to remove
+		has_previous = !err && !parse_striped_manifest(id, result[0].file(), previous);
+
+		std::random_device random;
+		do {
+			generation = (uint64_t(random()) << 32) | random();
+		} while (has_previous && generation == previous.generation);
+
+		const uint64_t count = (file.size() + stripe_size - 1) / stripe_size;
+		if (!count) {
+			write_manifest();
+			return;
+		}
+
+		pending = count;
+		for (uint64_t i = 0; i < count; ++i) {
+			sess.write_data(striped_key(sess, id, generation, i), file.slice(i * stripe_size, stripe_size), 0)
+				.connect(std::bind(&striped_write_handler::on_stripe, shared_from_this(), i,
+					std::placeholders::_1, std::placeholders::_2));
+		}
+	}
+
+	void on_stripe(uint64_t index, const sync_write_result &, const error_info &err) {
+		std::unique_lock<std::mutex> guard(lock);
+		if (err && !error)
+			error = create_error(err.code(), id, "write_striped: failed to write stripe %llu: %s",
+				(unsigned long long)index, err.message().c_str());
+
+		if (--pending)
+			return;
+		guard.unlock();
+
+		// manifest is not written, so the previous version of the object remains readable
+		if (error) {
+			handler.complete(error);
+			return;
+		}
+
+		write_manifest();
+	}
+
+	void write_manifest() {
+		striped_manifest manifest;
+		manifest.magic = striped_manifest_magic;
+		manifest.size = file.size();
+		manifest.stripe_size = stripe_size;
+		manifest.stripe_count = (file.size() + stripe_size - 1) / stripe_size;
+		manifest.generation = generation;
+		convert_striped_manifest(&manifest);
+
+		sess.write_data(id, data_pointer::copy(&manifest, sizeof(manifest)), 0)
+			.connect(bind_method(shared_from_this(), &striped_write_handler::on_manifest));
+	}
+
+	void on_manifest(const sync_write_result &result, const error_info &err) {
+		manifest_result = result;
+
+		// manifest of the previous generation may be left in groups where the new one was not written
+		bool written = !err && result.size() == sess.get_groups().size();
+		for (auto it = result.begin(); it != result.end(); ++it)
+			written = written && !it->error();
+
+		if (err || !written || !has_previous || !previous.stripe_count) {
+			finish(err);
+			return;
+		}
+
+		pending = previous.stripe_count;
+		for (uint64_t i = 0; i < previous.stripe_count; ++i) {
+			sess.remove(striped_key(sess, id, previous.generation, i))
+				.connect(bind_method(shared_from_this(), &striped_write_handler::on_previous_stripe));
+		}
+	}
+
+	// stripes of the previous generation which were not removed are only wasted space
+	void on_previous_stripe(const sync_remove_result &, const error_info &) {
+		std::unique_lock<std::mutex> guard(lock);
+		if (--pending)
+			return;
+		guard.unlock();
+
+		finish(error_info());
+	}
+
+	void finish(const error_info &err) {
+		for (auto it = manifest_result.begin(); it != manifest_result.end(); ++it)
+			handler.process(*it);
+		handler.complete(err);
+	}
+};
+
+async_write_result session::write_striped(const key &id, const data_pointer &file, uint64_t stripe_size)
+{
+	async_write_result result(*this);
+
+	if (!stripe_size) {
+		async_result_handler<write_result_entry> handler(result);
+		handler.complete(create_error(-EINVAL, id, "write_striped: stripe size must be positive"));
+		return result;
+	}
+
+	transform(id);
+
+	auto handler = std::make_shared<striped_write_handler>(*this, result, id, file, stripe_size);
+	handler->start();
+
+	return result;
+}
+
+// Reads the manifest and then all stripes in parallel directly into the buffer of the resulting entry
+struct striped_read_handler : std::enable_shared_from_this<striped_read_handler>
+{
+	ELLIPTICS_DISABLE_COPY(striped_read_handler)
+
+	striped_read_handler(const session &sess, const async_read_result &result, const key &id)
+		: sess(sess.clone()), handler(result), id(id), pending(0)
+	{
+		this->sess.set_exceptions_policy(session::no_exceptions);
+		this->sess.set_filter(filters::positive);
+		handler.set_total(1);
+	}
+
+	session sess;
+	async_result_handler<read_result_entry> handler;
+	key id;
+
+	striped_manifest manifest;
+	std::shared_ptr<callback_result_data> data;
+	char *content;
+
+	std::mutex lock;
+	uint64_t pending;
+	error_info error;
+
+	void start() {
+		sess.read_data(id, 0, 0)
+			.connect(bind_method(shared_from_this(), &striped_read_handler::on_manifest));
+	}
+
+	void on_manifest(const sync_read_result &result, const error_info &err) {
+		if (err) {
+			handler.complete(err);
+			return;
+		}
+
+		const read_result_entry &entry = result[0];
+
+		error_info parse_error = parse_striped_manifest(id, entry.file(), manifest);
+		if (parse_error) {
+			handler.complete(parse_error);
+			return;
+		}
+
+		const size_t header_size = sizeof(dnet_addr) + sizeof(dnet_cmd) + sizeof(dnet_io_attr);
+
+		data = std::make_shared<callback_result_data>();
+		data->data = data_pointer::allocate(header_size + manifest.size);
+
+		char *raw = data->data.data<char>();
+		dnet_addr *addr = reinterpret_cast<dnet_addr *>(raw);
+		dnet_cmd *cmd = reinterpret_cast<dnet_cmd *>(raw + sizeof(dnet_addr));
+		dnet_io_attr *io = reinterpret_cast<dnet_io_attr *>(raw + sizeof(dnet_addr) + sizeof(dnet_cmd));
+		content = raw + header_size;
+
+		*addr = *entry.address();
+		*cmd = *entry.command();
+		cmd->flags &= ~DNET_FLAGS_MORE;
+		cmd->size = sizeof(dnet_io_attr) + manifest.size;
+		*io = *entry.io_attribute();
+		io->offset = 0;
+		io->size = manifest.size;
+		io->total_size = manifest.size;
+
+		if (!manifest.stripe_count) {
+			finish();
+			return;
+		}
+
+		pending = manifest.stripe_count;
+		for (uint64_t i = 0; i < manifest.stripe_count; ++i) {
+			sess.read_data(striped_key(sess, id, manifest.generation, i), 0, 0)
+				.connect(std::bind(&striped_read_handler::on_stripe, shared_from_this(), i,
+					std::placeholders::_1, std::placeholders::_2));
+		}
+	}
+
+	void on_stripe(uint64_t index, const sync_read_result &result, const error_info &err) {
+		const uint64_t offset = index * manifest.stripe_size;
+		const uint64_t size = std::min(manifest.stripe_size, manifest.size - offset);
+
+		error_info stripe_error = err;
+		if (!err) {
+			data_pointer file = result[0].file();
+			if (file.size() == size)
+				memcpy(content + offset, file.data(), size);
+			else
+				stripe_error = create_error(-EILSEQ, "stripe size: %zu, expected: %llu",
+					file.size(), (unsigned long long)size);
+		}
+
+		std::unique_lock<std::mutex> guard(lock);
+		if (stripe_error && !error)
+			error = create_error(stripe_error.code(), id, "read_striped: failed to read stripe %llu: %s",
+				(unsigned long long)index, stripe_error.message().c_str());
+
+		if (--pending)
+			return;
+		guard.unlock();
+
+		if (error) {
+			handler.complete(error);
+			return;
+		}
+
+		finish();
+	}
+
+	void finish() {
+		callback_result_entry entry = data;
+		handler.process(*static_cast<const read_result_entry *>(&entry));
+		handler.complete(error_info());
+	}
+};
+
+async_read_result session::read_striped(const key &id)
+{
+	transform(id);
+
+	async_read_result result(*this);
+
+	auto handler = std::make_shared<striped_read_handler>(*this, result, id);
+	handler->start();
+
+	return result;
+}
+
 std::string session::lookup_address(const key &id, int group_id)
 {
 	char buf[128];
@@ -1764,6 +2168,93 @@ async_remove_result session::remove(const key &id)
 	return send_to_groups(*this, ctl);
 }
 
+// Removes all stripes in parallel and then the manifest
+struct striped_remove_handler : std::enable_shared_from_this<striped_remove_handler>
+{
+	ELLIPTICS_DISABLE_COPY(striped_remove_handler)
+
+	striped_remove_handler(const session &sess, const async_remove_result &result, const key &id)
+		: sess(sess.clone()), handler(result), id(id), pending(0)
+	{
+		this->sess.set_exceptions_policy(session::no_exceptions);
+		handler.set_total(1);
+	}
+
+	session sess;
+	async_result_handler<remove_result_entry> handler;
+	key id;
+
+	std::mutex lock;
+	uint64_t pending;
+	error_info error;
+
+	void start() {
+		session read_sess = sess.clone();
+		read_sess.set_filter(filters::positive);
+
+		read_sess.read_data(id, 0, 0)
+			.connect(bind_method(shared_from_this(), &striped_remove_handler::on_manifest));
+	}
+
+	void on_manifest(const sync_read_result &result, const error_info &err) {
+		if (err) {
+			handler.complete(err);
+			return;
+		}
+
+		striped_manifest manifest;
+		error_info parse_error = parse_striped_manifest(id, result[0].file(), manifest);
+		if (parse_error) {
+			handler.complete(parse_error);
+			return;
+		}
+
+		if (!manifest.stripe_count) {
+			sess.remove(id).connect(handler);
+			return;
+		}
+
+		pending = manifest.stripe_count;
+		for (uint64_t i = 0; i < manifest.stripe_count; ++i) {
+			sess.remove(striped_key(sess, id, manifest.generation, i))
+				.connect(std::bind(&striped_remove_handler::on_stripe, shared_from_this(), i,
+					std::placeholders::_1, std::placeholders::_2));
+		}
+	}
+
+	void on_stripe(uint64_t index, const sync_remove_result &, const error_info &err) {
+		std::unique_lock<std::mutex> guard(lock);
+		// stripe could be removed by the previous unfinished attempt
+		if (err && err.code() != -ENOENT && !error)
+			error = create_error(err.code(), id, "remove_striped: failed to remove stripe %llu: %s",
+				(unsigned long long)index, err.message().c_str());
+
+		if (--pending)
+			return;
+		guard.unlock();
+
+		// manifest is kept, so removal can be retried
+		if (error) {
+			handler.complete(error);
+			return;
+		}
+
+		sess.remove(id).connect(handler);
+	}
+};
+
+async_remove_result session::remove_striped(const key &id)
+{
+	transform(id);
+
+	async_remove_result result(*this);
+
+	auto handler = std::make_shared<striped_remove_handler>(*this, result, id);
+	handler->start();
+
+	return result;
+}
+
 async_monitor_stat_result session::monitor_stat(uint64_t categories)
 {
 	dnet_monitor_stat_request request;
@@ -1781,10 +2272,16 @@ async_monitor_stat_result session::monitor_stat(uint64_t categories)
 }
 
 async_monitor_stat_result session::monitor_stat(const address &addr, uint64_t categories)
+{
+	return monitor_stat(addr, categories, 0);
+}
+
+async_monitor_stat_result session::monitor_stat(const address &addr, uint64_t categories, uint64_t since_version)
 {
 	dnet_monitor_stat_request request;
 	memset(&request, 0, sizeof(struct dnet_monitor_stat_request));
 	request.categories = categories;
+	request.since_version = since_version;
 	dnet_convert_monitor_stat_request(&request);
 
 	transport_control control;
@@ -1874,6 +2371,11 @@ async_backend_control_result session::set_backend_ids(const address &addr, uint3
 	return update_backend_status(*this, addr, backend_id, DNET_BACKEND_SET_IDS, ids);
 }
 
+async_backend_control_result session::migrate_backend_ids(const address &addr, uint32_t backend_id, const std::vector<dnet_raw_id> &ids)
+{
+	return update_backend_status(*this, addr, backend_id, DNET_BACKEND_MIGRATE_IDS, ids);
+}
+
 async_backend_control_result session::make_readonly(const address &addr, uint32_t backend_id)
 {
 	return update_backend_status(*this, addr, backend_id, DNET_BACKEND_READ_ONLY);
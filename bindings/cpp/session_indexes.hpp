@@ -109,6 +109,14 @@ static inline dnet_raw_id transform_index_id(session &sess, const dnet_raw_id &d
 	return id;
 }
 
+/*!
+ * Inserts or removes \a index_data of object \a request->id into index table \a data
+ * according to \a action, returns new packed table
+ */
+data_pointer convert_index_table(dnet_node *node, dnet_id *cmd_id, const dnet_indexes_request *request,
+	const data_pointer &index_data, const data_pointer &data, uint32_t action,
+	std::vector<dnet_indexes_reply_entry> * &removed, const dnet_indexes_request_entry &entry);
+
 }} /* namespace ioremap::elliptics */
 
 namespace msgpack
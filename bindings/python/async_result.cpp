@@ -50,6 +50,18 @@ struct def_async_result<T>
 			     "    Performs waiting all operation results and returns it by list\n\n"
 			     "    results = async_result.get()\n"
 			     "    first_result = results[0]")
+			.def("next_batch", &python_async_result<T>::next_batch,
+			     (bp::arg("max_size")),
+			     "next_batch(max_size)\n"
+			     "    Waits for next max_size results and returns them by list.\n"
+			     "    The list is shorter only at the end of results and empty after the last result.\n"
+			     "    GIL is released while waiting, so it is the fastest way to process many results\n\n"
+			     "    while True:\n"
+			     "        results = async_result.next_batch(1000)\n"
+			     "        if not results:\n"
+			     "            break\n"
+			     "        for result in results:\n"
+			     "            print 'The operation result:', result")
 			.def("wait", &python_async_result<T>::wait,
 			     "wait()\n"
 			     "    Performs waiting all operation result\n\n"
@@ -94,6 +106,18 @@ struct def_async_result<T>
 			     "            print 'The operation failed: {0}'\n"
 			     "                  .format(error)\n"
 			     "    async_result.connect(rhandler, fhandler)")
+			.def("connect_batch", &python_async_result<T>::connect_batch,
+			     (bp::arg("result_handler"), bp::arg("final_handler"), bp::arg("batch_size")),
+			     "connect_batch(result_handler, final_handler, batch_size)\n"
+			     "    Sets callbacks:\n"
+			     "        result_handler will be called with lists of batch_size results\n"
+			     "        (the last list may be shorter)\n"
+			     "        final_handler will be called once after all results\n\n"
+			     "    def rhandler(results):\n"
+			     "         print 'Received {0} results'.format(len(results))\n"
+			     "    def fhandler(error):\n"
+			     "        print 'The operation completed: {0}'.format(error)\n"
+			     "    async_result.connect_batch(rhandler, fhandler, 1000)")
 			.def("connect", &python_async_result<T>::connect_all,
 			     (bp::arg("handler")),
 			     "connect(result_handler)\n"
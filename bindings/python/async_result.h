@@ -22,6 +22,8 @@
 #include <boost/python/str.hpp>
 #include <boost/python/errors.hpp>
 
+#include <mutex>
+
 #include <elliptics/result_entry.hpp>
 
 #include "elliptics_time.h"
@@ -88,12 +90,77 @@ struct callback_one_handlers {
 	std::unique_ptr<bp::api::object> final_handler;
 };
 
+/*
+ * Accumulates results and passes them to python by lists of \a batch_size results,
+ * so GIL is taken once per batch instead of once per result
+ */
+template <typename T>
+struct callback_batch_handlers {
+	ELLIPTICS_DISABLE_COPY(callback_batch_handlers)
+
+	callback_batch_handlers(bp::api::object &result, bp::api::object &final, size_t batch_size)
+	: batch_size(batch_size ? batch_size : 1) {
+		result_handler.reset(new bp::api::object(result));
+		final_handler.reset(new bp::api::object(final));
+		results.reserve(this->batch_size);
+	}
+
+	~callback_batch_handlers() {
+		gil_guard gstate;
+		result_handler.reset();
+		final_handler.reset();
+	}
+
+	void on_result(const T &result) {
+		std::vector<T> batch;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			results.push_back(result);
+			if (results.size() < batch_size)
+				return;
+
+			batch.swap(results);
+			results.reserve(batch_size);
+		}
+
+		gil_guard gstate;
+		try {
+			(*result_handler)(convert_to_list(batch));
+		} catch (const bp::error_already_set& e) {}
+	}
+
+	void on_final(const error_info &err) {
+		std::vector<T> batch;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			batch.swap(results);
+		}
+
+		gil_guard gstate;
+		try {
+			if (!batch.empty())
+				(*result_handler)(convert_to_list(batch));
+			(*final_handler)(error(err.code(), err.message()));
+		} catch (const bp::error_already_set& e) {}
+	}
+
+	size_t batch_size;
+	std::mutex lock;
+	std::vector<T> results;
+	std::unique_ptr<bp::api::object> result_handler;
+	std::unique_ptr<bp::api::object> final_handler;
+};
+
 template <typename T>
 struct python_async_result
 {
 	typedef typename async_result<T>::iterator iterator;
 
 	std::shared_ptr<async_result<T>> scope;
+	/*
+	 * Iterator which is used by next_batch()
+	 */
+	std::shared_ptr<iterator> batch_it;
 
 	iterator begin() {
 		py_allow_threads_scoped pythr;
@@ -112,6 +179,26 @@ struct python_async_result
 		return convert_to_list(res);
 	}
 
+	/*
+	 * Waits without GIL for next \a max_size results and returns them by single list,
+	 * list is shorter only at the end of results and is empty after the last result
+	 */
+	bp::list next_batch(size_t max_size) {
+		std::vector<T> batch;
+		{
+			py_allow_threads_scoped pythr;
+			if (!batch_it)
+				batch_it = std::make_shared<iterator>(scope->begin());
+
+			iterator end = scope->end();
+			batch.reserve(max_size);
+			for (; batch.size() < max_size && *batch_it != end; ++(*batch_it)) {
+				batch.push_back(**batch_it);
+			}
+		}
+		return convert_to_list(batch);
+	}
+
 	void wait() {
 		py_allow_threads_scoped pythr;
 		scope->wait();
@@ -140,6 +227,12 @@ struct python_async_result
 		               boost::bind(&callback_one_handlers<T>::on_final, callback, _1));
 	}
 
+	void connect_batch(bp::api::object &result_handler, bp::api::object &final_handler, size_t batch_size) {
+		auto callback = boost::make_shared<callback_batch_handlers<T>>(result_handler, final_handler, batch_size);
+		scope->connect(boost::bind(&callback_batch_handlers<T>::on_result, callback, _1),
+		               boost::bind(&callback_batch_handlers<T>::on_final, callback, _1));
+	}
+
 	void connect_all(bp::api::object &handler) {
 		auto callback = boost::make_shared<callback_all_handler<T>>(handler);
 		scope->connect(boost::bind(&callback_all_handler<T>::on_results, callback, _1, _2));
@@ -149,7 +242,7 @@ struct python_async_result
 template <typename T>
 python_async_result<T> create_result(async_result<T> &&result)
 {
-	python_async_result<T> pyresult = { std::make_shared<async_result<T>>(std::move(result)) };
+	python_async_result<T> pyresult = { std::make_shared<async_result<T>>(std::move(result)), nullptr };
 	return pyresult;
 }
 
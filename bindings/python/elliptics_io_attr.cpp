@@ -105,6 +105,10 @@ void init_elliptics_io_attr() {
 		    "io_flags.size = len('object data')")
 		.def_readwrite("total_size", &dnet_io_attr::total_size,
 		    "Total size of the object being read.")
+		.def_readwrite("expire", &dnet_io_attr::expire,
+		    "Absolute expiration time of the object in seconds since epoch.\n"
+		    "If zero, object never expires.\n\n"
+		    "io_attr.expire = int(time.time()) + 3600")
 		.def_pickle(io_attr_pickle())
 	;
 }
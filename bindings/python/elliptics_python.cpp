@@ -67,6 +67,7 @@ enum elliptics_ioflags {
 	ioflags_cache = DNET_IO_FLAGS_CACHE,
 	ioflags_cache_only = DNET_IO_FLAGS_CACHE_ONLY,
 	ioflags_cache_remove_from_disk = DNET_IO_FLAGS_CACHE_REMOVE_FROM_DISK,
+	ioflags_replicate = DNET_IO_FLAGS_REPLICATE,
 };
 
 enum elliptics_exceptions_policy {
@@ -86,6 +87,7 @@ enum elliptics_config_flags {
 	config_flags_mix_states			= DNET_CFG_MIX_STATES,
 	config_flags_no_csum			= DNET_CFG_NO_CSUM,
 	config_flags_randomize_states	= DNET_CFG_RANDOMIZE_STATES,
+	config_flags_balanced_ids		= DNET_CFG_BALANCED_IDS,
 };
 
 enum elliptics_node_status_flags {
@@ -406,7 +408,9 @@ BOOST_PYTHON_MODULE(core)
 		"cache_only\n    Means we do not want to sink to disk,\n"
 		            "    just return whatever cache processing returned (even error)\n"
 		"cache_remove_from_disk\n    is set and object is being removed from cache,\n"
-		                        "    then remove object from disk too")
+		                        "    then remove object from disk too\n"
+		"replicate\n    Write is sent once to the first group,\n"
+		           "    node of this group writes the object to the rest groups")
 		.value("default", ioflags_default)
 		.value("append", ioflags_append)
 		.value("prepare", ioflags_prepare)
@@ -418,6 +422,7 @@ BOOST_PYTHON_MODULE(core)
 		.value("cache", ioflags_cache)
 		.value("cache_only", ioflags_cache_only)
 		.value("cache_remove_from_disk", ioflags_cache_remove_from_disk)
+		.value("replicate", ioflags_replicate)
 	;
 
 	bp::enum_<blackhole::defaults::severity>("log_level",
@@ -455,13 +460,15 @@ BOOST_PYTHON_MODULE(core)
 	    "no_route_list\n    Do not request route table from remote nodes\n"
 	    "mix_states\n    Mix states according to their weights before reading data\n"
 	    "no_csum\n    Globally disable checksum verification and update\n"
-	    "randomize_states\n    Randomize states for read requests\n\n"
+	    "randomize_states\n    Randomize states for read requests\n"
+	    "balanced_ids\n    New ids split the largest ranges of the group instead of being random\n\n"
 	    "config.flags = elliptics.config_flags.mix_stats | elliptics.config_flags.randomize_states\n"
 	    )
 		.value("no_route_list", config_flags_no_route_list)
 		.value("mix_states", config_flags_mix_states)
 		.value("no_csum", config_flags_no_csum)
 		.value("randomize_states", config_flags_randomize_states)
+		.value("balanced_ids", config_flags_balanced_ids)
 	;
 
 	bp::enum_<elliptics_node_status_flags>("status_flags",
@@ -67,13 +67,19 @@ enum elliptics_monitor_categories {
 	elliptics_monitor_categories_backend = DNET_MONITOR_BACKEND,
 	elliptics_monitor_categories_procfs = DNET_MONITOR_PROCFS,
 	elliptics_monitor_categories_stats = DNET_MONITOR_STATS,
+	elliptics_monitor_categories_hot_keys = DNET_MONITOR_HOT_KEYS,
+	elliptics_monitor_categories_request_stages = DNET_MONITOR_REQUEST_STAGES,
+	elliptics_monitor_categories_slow_requests = DNET_MONITOR_SLOW_REQUESTS,
 	elliptics_monitor_categories_all = DNET_MONITOR_CACHE |
 	                                   DNET_MONITOR_IO |
 	                                   DNET_MONITOR_COMMANDS |
 	                                   DNET_MONITOR_IO_HISTOGRAMS |
 	                                   DNET_MONITOR_BACKEND |
 	                                   DNET_MONITOR_PROCFS |
-	                                   DNET_MONITOR_STATS
+	                                   DNET_MONITOR_STATS |
+	                                   DNET_MONITOR_HOT_KEYS |
+	                                   DNET_MONITOR_REQUEST_STAGES |
+	                                   DNET_MONITOR_SLOW_REQUESTS
 };
 
 struct write_cas_converter {
@@ -704,7 +710,7 @@ public:
 		return create_result(std::move(session::remove_index_internal(transform(id).raw_id())));
 	}
 
-	python_monitor_stat_result monitor_stat(const bp::tuple &addr, uint64_t categories) {
+	python_monitor_stat_result monitor_stat(const bp::tuple &addr, uint64_t categories, uint64_t since_version) {
 		if (bp::len(addr) == 0)
 			return create_result(std::move(session::monitor_stat(categories)));
 
@@ -715,7 +721,8 @@ public:
 		return create_result(std::move(session::monitor_stat(address(get_host(),
 		                                                             get_port(),
 		                                                             get_family()),
-		                                                     categories)));
+		                                                     categories,
+		                                                     since_version)));
 	}
 
 private:
@@ -781,7 +788,10 @@ void init_elliptics_session() {
 		"io_histograms\n    Category for IO hisograms statistics\n"
 		"backend\n    Category for backend statistics\n"
 		"procfs\n    Category for system statistics about process"
-		"stats\n    Category for in-process runtime statistics")
+		"stats\n    Category for in-process runtime statistics\n"
+		"hot_keys\n    Category for the most requested keys of each backend\n"
+		"request_stages\n    Category for time spent by requests at each stage of processing\n"
+		"slow_requests\n    Category for the last slow and randomly sampled requests")
 		.value("all", elliptics_monitor_categories_all)
 		.value("cache", elliptics_monitor_categories_cache)
 		.value("io", elliptics_monitor_categories_io)
@@ -790,6 +800,9 @@ void init_elliptics_session() {
 		.value("backend", elliptics_monitor_categories_backend)
 		.value("procfs", elliptics_monitor_categories_procfs)
 		.value("stats", elliptics_monitor_categories_stats)
+		.value("hot_keys", elliptics_monitor_categories_hot_keys)
+		.value("request_stages", elliptics_monitor_categories_request_stages)
+		.value("slow_requests", elliptics_monitor_categories_slow_requests)
 	;
 
 	bp::enum_<exec_context::final_state>("exec_context_final_states",
@@ -916,6 +929,16 @@ void init_elliptics_session() {
 		.def("set_user_flags", &elliptics_session::set_user_flags)
 		.def("get_user_flags", &elliptics_session::get_user_flags)
 
+		.add_property("ttl",
+		              &elliptics_session::get_ttl,
+		              &elliptics_session::set_ttl,
+		    "Lifetime in seconds of objects written by the session.\n"
+		    "Expired objects are treated as absent and removed by the server.\n"
+		    "If zero, objects never expire.\n\n"
+		    "session.ttl = 3600")
+		.def("set_ttl", &elliptics_session::set_ttl)
+		.def("get_ttl", &elliptics_session::get_ttl)
+
 		.add_property("timestamp",
 		              &elliptics_session::get_timestamp,
 		              &elliptics_session::set_timestamp,
@@ -1757,10 +1780,12 @@ void init_elliptics_session() {
 // Statistics
 
 		.def("monitor_stat", &elliptics_session::monitor_stat,
-		     (bp::arg("address"), bp::arg("categories")=elliptics_monitor_categories_all),
-		    "monitor_stat(key=None, categories=elliptics.monitor_stat_categories.all)\n"
+		     (bp::arg("address"), bp::arg("categories")=elliptics_monitor_categories_all,
+		      bp::arg("since_version")=0),
+		    "monitor_stat(key=None, categories=elliptics.monitor_stat_categories.all, since_version=0)\n"
 		    "    Gather monitor statistics of specified categories.\n"
-		    "    -- address - elliptics.Address of node\n\n"
+		    "    -- address - elliptics.Address of node\n"
+		    "    -- since_version - if not zero, only values changed since report with this version are returned\n\n"
 		    "    result = session.monitor_stat(elliptics.Address.from_host_port('host.com:1025'))\n"
 		    "    stats = result.get()\n")
 
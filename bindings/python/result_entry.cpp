@@ -30,6 +30,30 @@ namespace bp = boost::python;
 
 namespace ioremap { namespace elliptics { namespace python {
 
+/*
+ * Read-only wrapper of data_pointer which supports buffer protocol.
+ * data_pointer is reference-counted, so memoryview over the wrapper
+ * keeps the data alive without copying it into python string.
+ */
+struct data_view {
+	data_pointer data;
+};
+
+static int data_view_get_buffer(PyObject *obj, Py_buffer *view, int flags)
+{
+	data_view &dv = bp::extract<data_view &>(obj);
+	return PyBuffer_FillInfo(view, obj, (void *)dv.data.data(), dv.data.size(), 1, flags);
+}
+
+static PyBufferProcs data_view_buffer_procs;
+
+static bp::object make_data_view(const data_pointer &data)
+{
+	data_view dv = { data };
+	bp::object obj(dv);
+	return bp::object(bp::handle<>(PyMemoryView_FromObject(obj.ptr())));
+}
+
 elliptics_id index_entry_get_index(index_entry &result)
 {
 	return elliptics_id(result.index);
@@ -60,6 +84,11 @@ std::string iterator_result_response_data(iterator_result_entry result)
 	return result.reply_data().to_string();
 }
 
+bp::object iterator_result_response_data_view(iterator_result_entry result)
+{
+	return make_data_view(result.reply_data());
+}
+
 elliptics_id iterator_response_get_key(dnet_iterator_response *response)
 {
 	return elliptics_id(response->key);
@@ -100,6 +129,11 @@ std::string read_result_get_data(read_result_entry &result)
 	return result.file().to_string();
 }
 
+bp::object read_result_get_data_view(read_result_entry &result)
+{
+	return make_data_view(result.file());
+}
+
 elliptics_id read_result_get_id(read_result_entry &result)
 {
 	dnet_raw_id id;
@@ -289,6 +323,15 @@ bp::list dnet_backend_status_result_get_backends(const backend_status_result_ent
 
 void init_result_entry() {
 
+	bp::object data_view_class = bp::class_<data_view>("DataView",
+			"Read-only buffer which refers to data of result entry. Use memoryview to access it", bp::no_init);
+	PyTypeObject *data_view_type = (PyTypeObject *)data_view_class.ptr();
+	data_view_buffer_procs.bf_getbuffer = data_view_get_buffer;
+	data_view_type->tp_as_buffer = &data_view_buffer_procs;
+#if PY_MAJOR_VERSION < 3
+	data_view_type->tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+
 	bp::class_<index_entry>("IndexEntry")
 		.add_property("index",
 		              index_entry_get_index,
@@ -309,6 +352,8 @@ void init_result_entry() {
 		              "elliptics.IteratorResultResponse which provides meta information about iterated key")
 		.add_property("response_data", iterator_result_response_data,
 		              "Data of iterated key. May be empty if elliptics.iterator_flags.data hasn't been specified for iteration.")
+		.add_property("response_data_view", iterator_result_response_data_view,
+		              "Read-only memoryview of data of iterated key. Unlike response_data it does not copy the data")
 		.add_property("address", result_entry_address<iterator_result_entry>,
 		              "Address of node")
 		.add_property("group_id", result_entry_group_id<iterator_result_entry>)
@@ -338,6 +383,8 @@ void init_result_entry() {
 	bp::class_<read_result_entry>("ReadResultEntry")
 		.add_property("data", read_result_get_data,
 		              "Read data")
+		.add_property("data_view", read_result_get_data_view,
+		              "Read-only memoryview of read data. Unlike data it does not copy the data")
 		.add_property("id", read_result_get_id,
 		              "elliptics.Id of read object")
 		.add_property("timestamp", read_result_get_timestamp,
@@ -234,10 +234,12 @@ class Session(Session):
                                                   family=address.family,
                                                   backend_id=backend_id)
 
-    def monitor_stat(self, address=None, categories=monitor_stat_categories.all):
+    def monitor_stat(self, address=None, categories=monitor_stat_categories.all, since_version=0):
         '''
         Gather monitor statistics of specified categories from @address.
-        If @address is None monitoring statistics will be gathered from all nodes.\n
+        If @address is None monitoring statistics will be gathered from all nodes.
+        If @since_version is not zero, only values changed since report
+        with this version are returned by @address.\n
         result = session.monitor_stat(elliptics.Address.from_host_port('host.com:1025'))
         stats = result.get()
         '''
@@ -245,4 +247,4 @@ class Session(Session):
             address = ()
         else:
             address = tuple(address)
-        return super(Session, self).monitor_stat(address, categories);
+        return super(Session, self).monitor_stat(address, categories, since_version);
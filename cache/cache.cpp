@@ -89,6 +89,10 @@ int cache_manager::lookup(const unsigned char *id, dnet_net_state *st, dnet_cmd
 	return m_caches[idx(id)]->lookup(id, st, cmd);
 }
 
+bool cache_manager::contains(const unsigned char *id) {
+	return m_caches[idx(id)]->contains(id);
+}
+
 int cache_manager::indexes_find(dnet_cmd *cmd, dnet_indexes_request *request) {
 	(void) cmd;
 	(void) request;
@@ -276,6 +280,21 @@ int dnet_cmd_cache_io(struct dnet_backend_io *backend, struct dnet_net_state *st
 	return err;
 }
 
+int dnet_cmd_cache_contains(struct dnet_backend_io *backend, const unsigned char *id)
+{
+	if (!backend->cache) {
+		return 0;
+	}
+
+	cache_manager *cache = (cache_manager *)backend->cache;
+
+	try {
+		return cache->contains(id);
+	} catch (const std::exception &) {
+		return 0;
+	}
+}
+
 int dnet_cmd_cache_lookup(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd)
 {
 	// HANDY_TIMER_SCOPE("cache.LOOKUP");
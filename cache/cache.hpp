@@ -353,6 +353,8 @@ class cache_manager {
 
 		int lookup(const unsigned char *id, dnet_net_state *st, dnet_cmd *cmd);
 
+		bool contains(const unsigned char *id);
+
 		int indexes_find(dnet_cmd *cmd, dnet_indexes_request *request);
 
 		int indexes_update(dnet_cmd *cmd, dnet_indexes_request *request);
@@ -55,6 +55,7 @@ slru_cache_t::slru_cache_t(struct dnet_backend_io *backend, struct dnet_node *n,
 	m_clear_occured(false),
 	m_sync_timeout(sync_timeout) {
 	m_lifecheck = std::thread(std::bind(&slru_cache_t::life_check, this));
+	dnet_thread_bind(m_node, m_lifecheck.native_handle(), DNET_THREAD_POOL_IO, m_backend->backend_id);
 }
 
 slru_cache_t::~slru_cache_t() {
@@ -66,7 +67,7 @@ slru_cache_t::~slru_cache_t() {
 int slru_cache_t::write(const unsigned char *id, dnet_net_state *st, dnet_cmd *cmd, dnet_io_attr *io, const char *data) {
 	TIMER_SCOPE("write");
 
-	const size_t lifetime = io->start;
+	size_t lifetime = io->start;
 	const size_t size = io->size;
 	const bool remove_from_disk = (io->flags & DNET_IO_FLAGS_CACHE_REMOVE_FROM_DISK);
 	const bool cache = (io->flags & DNET_IO_FLAGS_CACHE);
@@ -238,6 +239,12 @@ int slru_cache_t::write(const unsigned char *id, dnet_net_state *st, dnet_cmd *c
 		it->set_synctime(time(NULL) + m_sync_timeout);
 	}
 
+	// object's expiration time limits its lifetime in cache unless lifetime is set explicitly
+	if (!lifetime && io->expire) {
+		const uint64_t now = time(NULL);
+		lifetime = io->expire > now ? io->expire - now : 1;
+	}
+
 	if (lifetime) {
 		it->set_lifetime(lifetime + time(NULL));
 	}
@@ -305,6 +312,17 @@ std::shared_ptr<raw_data_t> slru_cache_t::read(const unsigned char *id, dnet_cmd
 	return std::shared_ptr<raw_data_t>();
 }
 
+bool slru_cache_t::contains(const unsigned char *id) {
+	TIMER_SCOPE("contains");
+
+	elliptics_unique_lock<std::mutex> guard(m_lock, m_node, "%s: CACHE CONTAINS: %p", dnet_dump_id_str(id), this);
+
+	data_t* it = m_treap.find(id);
+
+	// appended object has to be synced with the disk before it can be read
+	return it && !it->only_append();
+}
+
 int slru_cache_t::remove(const unsigned char *id, dnet_io_attr *io) {
 	TIMER_SCOPE("remove");
 
@@ -35,6 +35,8 @@ public:
 
 	int lookup(const unsigned char *id, dnet_net_state *st, dnet_cmd *cmd);
 
+	bool contains(const unsigned char *id);
+
 	void clear();
 
 	cache_stats get_cache_stats() const;
@@ -120,6 +120,7 @@ rm -rf %{buildroot}
 %defattr(-,root,root,-)
 %{_bindir}/dnet_find
 %{_bindir}/dnet_ioclient
+%{_bindir}/dnet_load
 %{_bindir}/dnet_index
 %{_bindir}/dnet_notify
 %{_bindir}/dnet_ids
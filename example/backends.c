@@ -132,6 +132,7 @@ int dnet_ext_hdr_to_list(const struct dnet_ext_list_hdr *ehdr,
 	elist->timestamp.tnsec = dnet_bswap64(ehdr->timestamp.tnsec);
 	elist->size = dnet_bswap32(ehdr->size);
 	elist->flags = dnet_bswap64(ehdr->flags);
+	elist->expire = dnet_bswap64(ehdr->expire);
 
 	return 0;
 }
@@ -150,6 +151,7 @@ int dnet_ext_list_to_hdr(const struct dnet_ext_list *elist,
 	ehdr->version = elist->version;
 	ehdr->size = dnet_bswap32(elist->size);
 	ehdr->flags = dnet_bswap64(elist->flags);
+	ehdr->expire = dnet_bswap64(elist->expire);
 	ehdr->timestamp.tsec = dnet_bswap64(elist->timestamp.tsec);
 	ehdr->timestamp.tnsec = dnet_bswap64(elist->timestamp.tnsec);
 
@@ -166,6 +168,7 @@ int dnet_ext_list_to_io(const struct dnet_ext_list *elist, struct dnet_io_attr *
 
 	io->timestamp = elist->timestamp;
 	io->user_flags = elist->flags;
+	io->expire = elist->expire;
 
 	return 0;
 }
@@ -180,6 +183,7 @@ int dnet_ext_io_to_list(const struct dnet_io_attr *io, struct dnet_ext_list *eli
 
 	elist->timestamp = io->timestamp;
 	elist->flags = io->user_flags;
+	elist->expire = io->expire;
 
 	return 0;
 }
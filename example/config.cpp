@@ -30,6 +30,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <malloc.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -41,6 +42,8 @@
 
 #include <algorithm>
 #include <fstream>
+#include <set>
+#include <sstream>
 
 #include "elliptics/packet.h"
 #include "elliptics/interface.h"
@@ -88,6 +91,9 @@ extern "C" void dnet_config_data_destroy(dnet_config_data *public_data)
 {
 	config_data *data = static_cast<config_data *>(public_data);
 
+	if (data->log_async)
+		dnet_log_async_stop();
+
 	free(data->cfg_addrs);
 
 	delete data;
@@ -132,18 +138,29 @@ static void parse_logger(config_data *data, const config &logger)
 
 	repository.add_config(log_config);
 
-	data->logger_base = repository.root<dnet_log_level>();
-	data->logger_base.add_attribute(keyword::request_id() = 0);
+	*data->logger_base = repository.root<dnet_log_level>();
+	data->logger_base->add_attribute(keyword::request_id() = 0);
 
 	const config &level_config = logger.at("level");
 	const std::string &level = level_config.as<std::string>();
 	try {
-		data->logger_base.verbosity(file_logger::parse_level(level));
+		data->logger_base->verbosity(file_logger::parse_level(level));
 	} catch (error &exc) {
 		throw config_error() << level_config.path() << " " << exc.what();
 	}
 
 	data->cfg_state.log = &data->logger;
+
+	if (logger.at<bool>("async", false)) {
+		const size_t ring_size = logger.at<size_t>("async_ring_size", DNET_DEFAULT_LOG_ASYNC_RING_SIZE);
+		if (ring_size == 0)
+			throw config_error(logger.at("async_ring_size").path() + " must be non-zero");
+
+		int err = dnet_log_async_start(data->logger_base, ring_size);
+		if (err)
+			throw config_error() << logger.path() << " failed to start asynchronous logging: " << err;
+		data->log_async = true;
+	}
 }
 
 struct dnet_addr_wrap {
@@ -247,6 +264,59 @@ static int dnet_set_malloc_options(config_data *data, unsigned long long value)
 	return 0;
 }
 
+static void parse_cpu_list(const std::string &path, const std::string &list, std::set<int> &cpus)
+{
+	std::istringstream in(list);
+	std::string range;
+
+	while (std::getline(in, range, ',')) {
+		if (range.empty() || std::all_of(range.begin(), range.end(), ::isspace))
+			continue;
+
+		int first, last;
+		char dash, tail;
+		std::istringstream range_in(range);
+
+		if (!(range_in >> first))
+			throw config_error() << path << " has invalid cpu range: " << range;
+
+		last = first;
+		if (range_in >> dash && (dash != '-' || !(range_in >> last)))
+			throw config_error() << path << " has invalid cpu range: " << range;
+
+		if (range_in >> tail || first < 0 || last < first || last >= CPU_SETSIZE)
+			throw config_error() << path << " has invalid cpu range: " << range;
+
+		for (int cpu = first; cpu <= last; ++cpu)
+			cpus.insert(cpu);
+	}
+}
+
+std::vector<int> parse_cpus(const config &cfg, const std::string &prefix)
+{
+	std::set<int> cpus;
+
+	if (cfg.has(prefix + "cpus")) {
+		const config value = cfg.at(prefix + "cpus");
+		parse_cpu_list(value.path(), value.as<std::string>(), cpus);
+	}
+
+	if (cfg.has(prefix + "numa_node")) {
+		const config value = cfg.at(prefix + "numa_node");
+		const int numa_node = value.as<int>();
+		const std::string sys_path = "/sys/devices/system/node/node" + std::to_string(numa_node) + "/cpulist";
+
+		std::ifstream in(sys_path.c_str());
+		std::string list;
+		if (numa_node < 0 || !std::getline(in, list))
+			throw config_error() << value.path() << " is unknown numa node, failed to read " << sys_path;
+
+		parse_cpu_list(sys_path, list, cpus);
+	}
+
+	return std::vector<int>(cpus.begin(), cpus.end());
+}
+
 void parse_options(config_data *data, const config &options)
 {
 	if (options.has("mallopt_mmap_threshold")) {
@@ -267,8 +337,14 @@ void parse_options(config_data *data, const config &options)
 	data->cfg_state.server_prio = options.at("server_net_prio", 0);
 	data->cfg_state.client_prio = options.at("client_net_prio", 0);
 	data->cfg_state.indexes_shard_count = options.at("indexes_shard_count", 0);
+	data->net_thread_cpus = parse_cpus(options, "net_thread_");
+	data->io_thread_cpus = parse_cpus(options, "io_thread_");
 	data->daemon_mode = options.at("daemon", false);
 	data->parallel_start = options.at("parallel", true);
+	data->zerocopy_threshold = options.at("zerocopy_threshold", 0ull);
+	data->inline_commands = options.at("inline_commands", false);
+	data->defrag_concurrency = options.at("defrag_concurrency", 1);
+	data->coalesce_reads = options.at("coalesce_reads", true);
 	snprintf(data->cfg_state.cookie, DNET_AUTH_COOKIE_SIZE, "%s", options.at<std::string>("auth_cookie").c_str());
 
 	if (options.has("srw_config")) {
@@ -288,6 +364,7 @@ void parse_options(config_data *data, const config &options)
 		const config monitor = options.at("monitor");
 		data->cfg_state.monitor_port = monitor.at("port", 0);
 		data->cfg_state.monitor_call_tree_timeout = monitor.at("call_tree_timeout", 0);
+		data->monitor_config = ioremap::monitor::monitor_config::parse(monitor);
 	}
 
 	if (options.has("handystats_config")) {
@@ -341,19 +341,34 @@ public:
 	config open(const std::string &path);
 };
 
+/*
+ * Returns sorted list of CPUs configured by \a prefix + "cpus" string like "0-7,16-23"
+ * and by \a prefix + "numa_node" number, empty list means that threads are not bound
+ */
+std::vector<int> parse_cpus(const config &cfg, const std::string &prefix);
+
 struct config_data : public dnet_config_data
 {
-	config_data() : logger(logger_base, blackhole::log::attributes_t())
+	config_data()
+	: logger_base(std::make_shared<ioremap::elliptics::logger_base>())
+	, logger(*logger_base, blackhole::log::attributes_t())
+	, log_async(false)
 	{
 	}
 
 	std::string config_path;
 	dnet_backend_info_list backends_guard;
 	std::string logger_value;
-	ioremap::elliptics::logger_base logger_base;
+	/* shared with asynchronous logging which writes captured records to it */
+	std::shared_ptr<ioremap::elliptics::logger_base> logger_base;
 	ioremap::elliptics::logger logger;
+	bool log_async;
 	std::vector<address> remotes;
 	std::unique_ptr<cache::cache_config> cache_config;
+	std::unique_ptr<monitor::monitor_config> monitor_config;
+	/* CPUs which network threads and node's io threads are bound to */
+	std::vector<int> net_thread_cpus;
+	std::vector<int> io_thread_cpus;
 };
 
 } } } // namespace ioremap::elliptics::config
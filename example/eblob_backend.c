@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <eblob/blob.h>
@@ -47,6 +48,8 @@
 
 #include "monitor/measure_points.h"
 
+#include "../library/elliptics.h"
+
 /*
  * FIXME: __unused is used internally by glibc, so it may cause conflicts.
  */
@@ -89,19 +92,123 @@ static int eblob_read_params_compare(const void *p1, const void *p2)
 	return 0;
 }
 
+/*
+ * Freshness of scrubbed records is tracked per slice of the key space (by the highest bits of the key),
+ * so it takes fixed amount of memory. Scrubber verifies records by batches of whole slices,
+ * each batch holds about BLOB_SCRUB_BATCH_SIZE keys.
+ */
+#define BLOB_SCRUB_SLICE_BITS		12
+#define BLOB_SCRUB_SLICES		(1 << BLOB_SCRUB_SLICE_BITS)
+#define BLOB_SCRUB_BATCH_SIZE		(64 * 1024)
+
+struct blob_scrub_slice {
+	/* start time of the last verification which found all records of the slice intact, zero if there was none */
+	time_t				verified;
+	/* time of the last write or removal of the slice's record */
+	time_t				changed;
+};
+
 struct eblob_backend_config {
 	struct eblob_config		data;
 	struct eblob_backend		*eblob;
 	dnet_logger			*blog;
 	struct eblob_log		log;
+	/* node's key locks serialize background changes of the record with clients' commands */
+	struct dnet_node		*node;
 
 	pthread_mutex_t			last_read_lock;
 	int64_t				vm_total;		/* squared in bytes */
 	int				random_access;
 	int				last_read_index;
 	struct eblob_read_params	last_reads[100];
+
+	/* Background removal of expired records, disabled if @expire_scan_timeout is zero */
+	long				expire_scan_timeout;
+	int				expire_need_exit;
+	int				expire_started;
+	pthread_t			expire_tid;
+	pthread_mutex_t			expire_lock;
+	pthread_cond_t			expire_wait;
+
+	/*
+	 * Background verification of records' checksums (scrubbing) at @scrub_rate bytes per second,
+	 * disabled if @scrub_rate is zero. Reads of records verified less than @scrub_fresh_time seconds ago
+	 * do not verify checksum again.
+	 */
+	uint64_t			scrub_rate;
+	long				scrub_interval;
+	long				scrub_fresh_time;
+	int				scrub_need_exit;
+	int				scrub_started;
+	pthread_t			scrub_tid;
+	pthread_mutex_t			scrub_lock;
+	pthread_cond_t			scrub_wait;
+	/* BLOB_SCRUB_SLICES entries, protected by @scrub_lock as well as the rest of scrub fields */
+	struct blob_scrub_slice		*scrub_slices;
+	/* statistics of the last completed pass */
+	uint64_t			scrub_passes;
+	time_t				scrub_last_start;
+	time_t				scrub_last_finish;
+	uint64_t			scrub_verified_records;
+	uint64_t			scrub_verified_bytes;
+	uint64_t			scrub_corrupted_records;
+	uint64_t			scrub_failed_records;
 };
 
+
+/*
+ * Removes expired record, space is reclaimed by the next defragmentation.
+ */
+static void blob_remove_expired(struct eblob_backend_config *c, struct eblob_key *key)
+{
+	int err;
+
+	err = eblob_remove(c->eblob, key);
+
+	dnet_backend_log(c->blog, err ? DNET_LOG_ERROR : DNET_LOG_NOTICE, "%s: EBLOB: expired record removed: %d",
+			dnet_dump_id_str(key->id), err);
+}
+
+static size_t blob_scrub_slice(const struct eblob_key *key)
+{
+	return ((size_t)key->id[0] << 8 | key->id[1]) >> (16 - BLOB_SCRUB_SLICE_BITS);
+}
+
+/*
+ * Makes the slice's records not fresh until they are verified again.
+ * Called after the change, so verification which has started earlier can't make the slice fresh.
+ */
+static void blob_scrub_forget(struct eblob_backend_config *c, const struct eblob_key *key)
+{
+	if (!c->scrub_started)
+		return;
+
+	pthread_mutex_lock(&c->scrub_lock);
+	c->scrub_slices[blob_scrub_slice(key)].changed = time(NULL);
+	pthread_mutex_unlock(&c->scrub_lock);
+}
+
+/*
+ * Returns true if checksums of all records of the key's slice have been successfully verified by the scrubber
+ * less than @scrub_fresh_time seconds ago and none of them has been changed since, so read may skip verification
+ */
+static int blob_scrub_fresh(struct eblob_backend_config *c, const struct eblob_key *key)
+{
+	struct blob_scrub_slice *slice;
+	int fresh;
+
+	if (!c->scrub_started || c->scrub_fresh_time <= 0)
+		return 0;
+
+	pthread_mutex_lock(&c->scrub_lock);
+	slice = &c->scrub_slices[blob_scrub_slice(key)];
+	fresh = slice->verified && slice->changed < slice->verified &&
+		slice->verified + c->scrub_fresh_time > time(NULL);
+	pthread_mutex_unlock(&c->scrub_lock);
+
+	return fresh;
+}
+
 /* Pre-callback that formats arguments and calls ictl->callback */
 static int blob_iterate_callback(struct eblob_disk_control *dc,
 		struct eblob_ram_control *rctl __unused,
@@ -251,6 +358,8 @@ static int blob_write(struct eblob_backend_config *c, void *state,
 			dnet_dump_id_str(io->id), wc.data_fd, wc.offset, fd_offset, wc.size);
 
 err_out_exit:
+	/* even failed write may have changed the record */
+	blob_scrub_forget(c, &key);
 	dnet_ext_list_destroy(&elist);
 	return err;
 }
@@ -273,7 +382,7 @@ static int blob_read(struct eblob_backend_config *c, void *state, struct dnet_cm
 
 	memcpy(key.id, io->id, EBLOB_ID_SIZE);
 
-	if (io->flags & DNET_IO_FLAGS_NOCSUM)
+	if ((io->flags & DNET_IO_FLAGS_NOCSUM) || blob_scrub_fresh(c, &key))
 		csum = EBLOB_READ_NOCSUM;
 
 	err = eblob_read_return(b, &key, csum, &wc);
@@ -302,6 +411,13 @@ static int blob_read(struct eblob_backend_config *c, void *state, struct dnet_cm
 		if (err != 0)
 			goto err_out_exit;
 		dnet_ext_hdr_to_list(&ehdr, &elist);
+
+		if (dnet_ext_list_expired(&elist, time(NULL))) {
+			blob_remove_expired(c, &key);
+			err = -ENOENT;
+			goto err_out_exit;
+		}
+
 		dnet_ext_list_to_io(&elist, io);
 
 		/* Take into an account extended header's len */
@@ -449,6 +565,13 @@ static int blob_read_range_callback(struct eblob_range_request *req)
 				goto err_out_exit;
 
 			dnet_ext_hdr_to_list(&ehdr, &elist);
+
+			/* Expired records are skipped, they are removed by the next scan or read */
+			if (dnet_ext_list_expired(&elist, time(NULL))) {
+				err = 0;
+				goto err_out_exit;
+			}
+
 			dnet_ext_list_to_io(&elist, &io);
 
 			io.offset += sizeof(struct dnet_ext_list_hdr);
@@ -486,6 +609,7 @@ static int blob_del_range_callback(struct eblob_backend_config *c, struct eblob_
 				dnet_dump_id_str(req->record_key), err);
 	}
 
+	blob_scrub_forget(c, &key);
 	return err;
 }
 
@@ -640,6 +764,8 @@ static int blob_del(struct eblob_backend_config *c, struct dnet_cmd *cmd)
 			dnet_dump_id_str(cmd->id.id), err, strerror(-err));
 	}
 
+	blob_scrub_forget(c, &key);
+
 	return err;
 }
 
@@ -683,6 +809,12 @@ static int blob_file_info(struct eblob_backend_config *c, void *state, struct dn
 			goto err_out_exit;
 		dnet_ext_hdr_to_list(&ehdr, &elist);
 
+		if (dnet_ext_list_expired(&elist, time(NULL))) {
+			blob_remove_expired(c, &key);
+			err = -ENOENT;
+			goto err_out_exit;
+		}
+
 		/* Take into an account extended header's len */
 		size -= ehdr_size;
 		offset += ehdr_size;
@@ -908,6 +1040,38 @@ static int dnet_blob_set_defrag_percentage(struct dnet_config_backend *b, char *
 	return 0;
 }
 
+static int dnet_blob_set_expire_scan_timeout(struct dnet_config_backend *b, char *key __unused, char *value)
+{
+	struct eblob_backend_config *c = b->data;
+
+	c->expire_scan_timeout = strtol(value, NULL, 0);
+	return 0;
+}
+
+static int dnet_blob_set_scrub_rate(struct dnet_config_backend *b, char *key __unused, char *value)
+{
+	struct eblob_backend_config *c = b->data;
+
+	c->scrub_rate = strtoull(value, NULL, 0);
+	return 0;
+}
+
+static int dnet_blob_set_scrub_interval(struct dnet_config_backend *b, char *key __unused, char *value)
+{
+	struct eblob_backend_config *c = b->data;
+
+	c->scrub_interval = strtol(value, NULL, 0);
+	return 0;
+}
+
+static int dnet_blob_set_scrub_fresh_time(struct dnet_config_backend *b, char *key __unused, char *value)
+{
+	struct eblob_backend_config *c = b->data;
+
+	c->scrub_fresh_time = strtol(value, NULL, 0);
+	return 0;
+}
+
 static int dnet_blob_set_blob_flags(struct dnet_config_backend *b, char *key __unused, char *value)
 {
 	struct eblob_backend_config *c = b->data;
@@ -934,10 +1098,578 @@ int eblob_backend_storage_stat_json(void *priv, char **json_stat, size_t *size)
 	return 0;
 }
 
+int eblob_backend_scrub_stat_json(void *priv, char **json_stat, size_t *size)
+{
+	struct eblob_backend_config *c = priv;
+	size_t i, fresh = 0;
+	time_t now = time(NULL);
+	int len;
+
+	if (!c->scrub_started)
+		return -ENOTSUP;
+
+	*json_stat = malloc(512);
+	if (!*json_stat)
+		return -ENOMEM;
+
+	pthread_mutex_lock(&c->scrub_lock);
+	for (i = 0; i < BLOB_SCRUB_SLICES; ++i) {
+		const struct blob_scrub_slice *slice = &c->scrub_slices[i];
+
+		if (slice->verified && slice->changed < slice->verified && slice->verified + c->scrub_fresh_time > now)
+			++fresh;
+	}
+
+	len = snprintf(*json_stat, 512, "{\"rate\":%" PRIu64 ",\"fresh_time\":%ld,\"passes\":%" PRIu64 ","
+			"\"last_start\":%lld,\"last_finish\":%lld,\"verified_records\":%" PRIu64 ","
+			"\"verified_bytes\":%" PRIu64 ",\"corrupted_records\":%" PRIu64 ",\"failed_records\":%" PRIu64 ","
+			"\"slices\":%d,\"fresh_slices\":%zu}",
+			c->scrub_rate, c->scrub_fresh_time, c->scrub_passes,
+			(long long)c->scrub_last_start, (long long)c->scrub_last_finish,
+			c->scrub_verified_records, c->scrub_verified_bytes,
+			c->scrub_corrupted_records, c->scrub_failed_records,
+			BLOB_SCRUB_SLICES, fresh);
+	pthread_mutex_unlock(&c->scrub_lock);
+
+	*size = len;
+	return 0;
+}
+
+struct blob_expire_priv {
+	struct eblob_backend_config	*c;
+	uint64_t			now;
+	pthread_mutex_t			lock;
+	struct eblob_key		*keys;
+	size_t				keys_num;
+	size_t				keys_size;
+};
+
+static int blob_expire_iterate_callback(struct eblob_disk_control *dc,
+		struct eblob_ram_control *rctl __unused,
+		void *data, void *priv, void *thread_priv __unused)
+{
+	struct blob_expire_priv *p = priv;
+	struct dnet_ext_list elist;
+	struct eblob_key *keys;
+	int err = 0;
+
+	if (p->c->expire_need_exit)
+		return -EINTR;
+
+	if (!(dc->flags & BLOB_DISK_CTL_EXTHDR) || dc->data_size < sizeof(struct dnet_ext_list_hdr))
+		return 0;
+
+	dnet_ext_hdr_to_list(data, &elist);
+	if (!dnet_ext_list_expired(&elist, p->now))
+		return 0;
+
+	pthread_mutex_lock(&p->lock);
+	if (p->keys_num == p->keys_size) {
+		p->keys_size = p->keys_size ? p->keys_size * 2 : 1000;
+		keys = realloc(p->keys, p->keys_size * sizeof(struct eblob_key));
+		if (!keys) {
+			err = -ENOMEM;
+			goto err_out_unlock;
+		}
+		p->keys = keys;
+	}
+
+	p->keys[p->keys_num++] = dc->key;
+
+err_out_unlock:
+	pthread_mutex_unlock(&p->lock);
+	return err;
+}
+
+/*
+ * Removes the record collected by the scan if it is still expired.
+ * Record could have been rewritten since it was collected, so its extended header is read again under the key lock.
+ * Returns 1 if the record has been removed.
+ */
+static int blob_expire_remove(struct eblob_backend_config *c, struct eblob_key *key)
+{
+	struct eblob_write_control wc;
+	struct dnet_ext_list_hdr ehdr;
+	struct dnet_ext_list elist;
+	struct dnet_id id;
+	int err, removed = 0;
+
+	dnet_setup_id(&id, 0, key->id);
+	dnet_oplock(c->node, &id);
+
+	err = eblob_read_return(c->eblob, key, EBLOB_READ_NOCSUM, &wc);
+	if (err)
+		goto err_out_unlock;
+
+	if (!(wc.flags & BLOB_DISK_CTL_EXTHDR) || wc.total_data_size < sizeof(struct dnet_ext_list_hdr))
+		goto err_out_unlock;
+
+	err = dnet_ext_hdr_read(&ehdr, wc.data_fd, wc.data_offset);
+	if (err)
+		goto err_out_unlock;
+
+	dnet_ext_list_init(&elist);
+	dnet_ext_hdr_to_list(&ehdr, &elist);
+
+	if (dnet_ext_list_expired(&elist, time(NULL))) {
+		blob_remove_expired(c, key);
+		removed = 1;
+	}
+
+	dnet_ext_list_destroy(&elist);
+
+err_out_unlock:
+	dnet_opunlock(c->node, &id);
+	return removed;
+}
+
+/*
+ * Iterates over the whole blob and removes records whose expiration time is over.
+ * Records are removed after iteration, since eblob_remove() can't be called from the iterator.
+ */
+static void blob_expire_scan(struct eblob_backend_config *c)
+{
+	struct blob_expire_priv p;
+	size_t i, removed = 0;
+	int err;
+
+	struct eblob_iterate_control eictl = {
+		.priv = &p,
+		.b = c->eblob,
+		.log = c->data.log,
+		.flags = EBLOB_ITERATE_FLAGS_ALL | EBLOB_ITERATE_FLAGS_READONLY,
+		.iterator_cb = {
+			.iterator = blob_expire_iterate_callback,
+		},
+	};
+
+	memset(&p, 0, sizeof(struct blob_expire_priv));
+	p.c = c;
+	p.now = time(NULL);
+
+	err = pthread_mutex_init(&p.lock, NULL);
+	if (err) {
+		dnet_backend_log(c->blog, DNET_LOG_ERROR, "EBLOB: expire: could not create lock: %d", -err);
+		return;
+	}
+
+	err = eblob_iterate(c->eblob, &eictl);
+
+	for (i = 0; i < p.keys_num && !c->expire_need_exit; ++i) {
+		removed += blob_expire_remove(c, &p.keys[i]);
+	}
+
+	dnet_backend_log(c->blog, err ? DNET_LOG_ERROR : DNET_LOG_INFO,
+			"EBLOB: expire: scan completed: collected: %zu, removed: %zu, status: %d", p.keys_num, removed, err);
+
+	free(p.keys);
+	pthread_mutex_destroy(&p.lock);
+}
+
+static void *blob_expire_thread(void *data)
+{
+	struct eblob_backend_config *c = data;
+	struct timespec ts;
+
+	pthread_mutex_lock(&c->expire_lock);
+	while (!c->expire_need_exit) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += c->expire_scan_timeout;
+
+		pthread_cond_timedwait(&c->expire_wait, &c->expire_lock, &ts);
+		if (c->expire_need_exit)
+			break;
+
+		pthread_mutex_unlock(&c->expire_lock);
+		blob_expire_scan(c);
+		pthread_mutex_lock(&c->expire_lock);
+	}
+	pthread_mutex_unlock(&c->expire_lock);
+
+	return NULL;
+}
+
+static int blob_expire_start(struct eblob_backend_config *c)
+{
+	int err;
+
+	if (c->expire_scan_timeout <= 0)
+		return 0;
+
+	err = pthread_mutex_init(&c->expire_lock, NULL);
+	if (err)
+		goto err_out_exit;
+
+	err = pthread_cond_init(&c->expire_wait, NULL);
+	if (err)
+		goto err_out_lock_destroy;
+
+	err = pthread_create(&c->expire_tid, NULL, blob_expire_thread, c);
+	if (err)
+		goto err_out_cond_destroy;
+
+	c->expire_started = 1;
+	return 0;
+
+err_out_cond_destroy:
+	pthread_cond_destroy(&c->expire_wait);
+err_out_lock_destroy:
+	pthread_mutex_destroy(&c->expire_lock);
+err_out_exit:
+	dnet_backend_log(c->blog, DNET_LOG_ERROR, "blob: could not start expire thread: %d.", -err);
+	return -err;
+}
+
+static void blob_expire_stop(struct eblob_backend_config *c)
+{
+	if (!c->expire_started)
+		return;
+
+	pthread_mutex_lock(&c->expire_lock);
+	c->expire_need_exit = 1;
+	pthread_cond_broadcast(&c->expire_wait);
+	pthread_mutex_unlock(&c->expire_lock);
+
+	pthread_join(c->expire_tid, NULL);
+
+	pthread_cond_destroy(&c->expire_wait);
+	pthread_mutex_destroy(&c->expire_lock);
+	c->expire_started = 0;
+}
+
+struct blob_scrub_priv {
+	struct eblob_backend_config	*c;
+	pthread_mutex_t			lock;
+	struct eblob_key		*keys;
+	size_t				keys_num;
+	size_t				keys_size;
+};
+
+/*
+ * Statistics of the scrubber's pass
+ */
+struct blob_scrub_stat {
+	uint64_t			verified;
+	uint64_t			bytes;
+	uint64_t			corrupted;
+	uint64_t			failed;
+};
+
+static int blob_scrub_iterate_callback(struct eblob_disk_control *dc,
+		struct eblob_ram_control *rctl __unused,
+		void *data __unused, void *priv, void *thread_priv __unused)
+{
+	struct blob_scrub_priv *p = priv;
+	struct eblob_key *keys;
+	int err = 0;
+
+	if (p->c->scrub_need_exit)
+		return -EINTR;
+
+	pthread_mutex_lock(&p->lock);
+	if (p->keys_num == p->keys_size) {
+		p->keys_size = p->keys_size ? p->keys_size * 2 : 1000;
+		keys = realloc(p->keys, p->keys_size * sizeof(struct eblob_key));
+		if (!keys) {
+			err = -ENOMEM;
+			goto err_out_unlock;
+		}
+		p->keys = keys;
+	}
+
+	p->keys[p->keys_num++] = dc->key;
+
+err_out_unlock:
+	pthread_mutex_unlock(&p->lock);
+	return err;
+}
+
+/*
+ * Sleeps until @bytes verified since @start fit into @scrub_rate, returns true if scrubber has to exit
+ */
+static int blob_scrub_throttle(struct eblob_backend_config *c, const struct timespec *start, uint64_t bytes)
+{
+	struct timespec ts;
+	uint64_t elapsed, budget;
+	int need_exit;
+
+	budget = bytes / c->scrub_rate * 1000000 + bytes % c->scrub_rate * 1000000 / c->scrub_rate;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	elapsed = (ts.tv_sec - start->tv_sec) * 1000000ULL + ts.tv_nsec / 1000 - start->tv_nsec / 1000;
+
+	pthread_mutex_lock(&c->scrub_lock);
+	if (budget > elapsed && !c->scrub_need_exit) {
+		budget -= elapsed;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += budget / 1000000;
+		ts.tv_nsec += budget % 1000000 * 1000;
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec += 1;
+			ts.tv_nsec -= 1000000000;
+		}
+
+		pthread_cond_timedwait(&c->scrub_wait, &c->scrub_lock, &ts);
+	}
+	need_exit = c->scrub_need_exit;
+	pthread_mutex_unlock(&c->scrub_lock);
+
+	return need_exit;
+}
+
+/*
+ * Verifies checksum of the record.
+ * Slice of the corrupted record is not fresh, so reads of the record verify checksum and fail with -EILSEQ,
+ * the record is rewritten by client's read recovery from the other groups then.
+ */
+static int blob_scrub_verify(struct eblob_backend_config *c, struct eblob_key *key, uint64_t *size)
+{
+	struct eblob_write_control wc;
+	int err;
+
+	memset(&wc, 0, sizeof(struct eblob_write_control));
+	err = eblob_read_return(c->eblob, key, EBLOB_READ_CSUM, &wc);
+	*size = wc.total_data_size;
+
+	if (err == -EILSEQ) {
+		dnet_backend_log(c->blog, DNET_LOG_ERROR, "%s: EBLOB: scrub: checksum mismatch, "
+				"record is verified by every read until it is rewritten", dnet_dump_id_str(key->id));
+	} else if (err && err != -ENOENT) {
+		dnet_backend_log(c->blog, DNET_LOG_ERROR, "%s: EBLOB: scrub: could not verify record: %s [%d]",
+				dnet_dump_id_str(key->id), strerror(-err), err);
+	}
+
+	return err;
+}
+
+/*
+ * Verifies records of @num slices starting from @first, slices whose records are all intact become fresh.
+ * Keys are collected by the iterator first, since records are read by eblob_read_return() which takes blob's locks.
+ */
+static int blob_scrub_batch(struct eblob_backend_config *c, size_t first, size_t num,
+		const struct timespec *start, struct blob_scrub_stat *st)
+{
+	struct blob_scrub_priv p;
+	struct eblob_index_block range;
+	char intact[BLOB_SCRUB_SLICES];
+	const unsigned int shift = 16 - BLOB_SCRUB_SLICE_BITS;
+	const unsigned int begin = first << shift, end = ((first + num) << shift) - 1;
+	time_t batch_start = time(NULL);
+	uint64_t size;
+	size_t i;
+	int err;
+
+	struct eblob_iterate_control eictl = {
+		.priv = &p,
+		.b = c->eblob,
+		.log = c->data.log,
+		.flags = EBLOB_ITERATE_FLAGS_ALL | EBLOB_ITERATE_FLAGS_READONLY,
+		.iterator_cb = {
+			.iterator = blob_scrub_iterate_callback,
+		},
+		.range = &range,
+		.range_num = 1,
+	};
+
+	memset(&range, 0, sizeof(struct eblob_index_block));
+	memset(range.end_key.id, 0xff, EBLOB_ID_SIZE);
+	range.start_key.id[0] = begin >> 8;
+	range.start_key.id[1] = begin & 0xff;
+	range.end_key.id[0] = end >> 8;
+	range.end_key.id[1] = end & 0xff;
+
+	memset(&p, 0, sizeof(struct blob_scrub_priv));
+	p.c = c;
+
+	err = pthread_mutex_init(&p.lock, NULL);
+	if (err) {
+		dnet_backend_log(c->blog, DNET_LOG_ERROR, "EBLOB: scrub: could not create lock: %d", -err);
+		return -err;
+	}
+
+	err = eblob_iterate(c->eblob, &eictl);
+	if (err) {
+		if (err != -EINTR)
+			dnet_backend_log(c->blog, DNET_LOG_ERROR, "EBLOB: scrub: could not collect records of slices: [%zu, %zu): %d",
+					first, first + num, err);
+		goto err_out_free;
+	}
+
+	memset(intact, 1, num);
+
+	for (i = 0; i < p.keys_num; ++i) {
+		size = 0;
+		err = blob_scrub_verify(c, &p.keys[i], &size);
+		if (!err) {
+			++st->verified;
+		} else if (err == -EILSEQ) {
+			++st->corrupted;
+			intact[blob_scrub_slice(&p.keys[i]) - first] = 0;
+		} else if (err != -ENOENT) {
+			++st->failed;
+			intact[blob_scrub_slice(&p.keys[i]) - first] = 0;
+		}
+
+		st->bytes += size;
+
+		if (blob_scrub_throttle(c, start, st->bytes)) {
+			err = -EINTR;
+			goto err_out_free;
+		}
+	}
+
+	err = 0;
+
+	pthread_mutex_lock(&c->scrub_lock);
+	for (i = 0; i < num; ++i)
+		c->scrub_slices[first + i].verified = intact[i] ? batch_start : 0;
+	pthread_mutex_unlock(&c->scrub_lock);
+
+err_out_free:
+	free(p.keys);
+	pthread_mutex_destroy(&p.lock);
+	return err;
+}
+
+/*
+ * Verifies checksums of all records of the blob at @scrub_rate bytes per second
+ */
+static void blob_scrub_pass(struct eblob_backend_config *c)
+{
+	struct blob_scrub_stat st;
+	struct timespec start;
+	time_t start_time = time(NULL);
+	uint64_t total = eblob_total_elements(c->eblob);
+	size_t first, num = BLOB_SCRUB_SLICES;
+	int err;
+
+	while (num > 1 && total * num / BLOB_SCRUB_SLICES > BLOB_SCRUB_BATCH_SIZE)
+		num >>= 1;
+
+	dnet_backend_log(c->blog, DNET_LOG_INFO, "EBLOB: scrub: pass started: records: %" PRIu64 ", "
+			"slices per batch: %zu, rate: %" PRIu64 " bytes/sec", total, num, c->scrub_rate);
+
+	memset(&st, 0, sizeof(struct blob_scrub_stat));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (first = 0; first < BLOB_SCRUB_SLICES; first += num) {
+		err = blob_scrub_batch(c, first, num, &start, &st);
+		if (err == -EINTR)
+			return;
+	}
+
+	pthread_mutex_lock(&c->scrub_lock);
+	++c->scrub_passes;
+	c->scrub_last_start = start_time;
+	c->scrub_last_finish = time(NULL);
+	c->scrub_verified_records = st.verified;
+	c->scrub_verified_bytes = st.bytes;
+	c->scrub_corrupted_records = st.corrupted;
+	c->scrub_failed_records = st.failed;
+	pthread_mutex_unlock(&c->scrub_lock);
+
+	dnet_backend_log(c->blog, st.corrupted || st.failed ? DNET_LOG_ERROR : DNET_LOG_INFO,
+			"EBLOB: scrub: pass completed: verified: %" PRIu64 ", bytes: %" PRIu64 ", "
+			"corrupted: %" PRIu64 ", failed: %" PRIu64 ", elapsed: %lld sec",
+			st.verified, st.bytes, st.corrupted, st.failed, (long long)(time(NULL) - start_time));
+}
+
+static void *blob_scrub_thread(void *data)
+{
+	struct eblob_backend_config *c = data;
+	struct timespec ts;
+
+	pthread_mutex_lock(&c->scrub_lock);
+	while (!c->scrub_need_exit) {
+		pthread_mutex_unlock(&c->scrub_lock);
+		blob_scrub_pass(c);
+		pthread_mutex_lock(&c->scrub_lock);
+
+		if (c->scrub_need_exit)
+			break;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += c->scrub_interval;
+
+		pthread_cond_timedwait(&c->scrub_wait, &c->scrub_lock, &ts);
+	}
+	pthread_mutex_unlock(&c->scrub_lock);
+
+	return NULL;
+}
+
+static int blob_scrub_start(struct eblob_backend_config *c)
+{
+	int err;
+
+	if (!c->scrub_rate)
+		return 0;
+
+	if (c->scrub_interval <= 0)
+		c->scrub_interval = 24 * 60 * 60;
+
+	c->scrub_slices = calloc(BLOB_SCRUB_SLICES, sizeof(struct blob_scrub_slice));
+	if (!c->scrub_slices) {
+		err = ENOMEM;
+		goto err_out_exit;
+	}
+
+	err = pthread_mutex_init(&c->scrub_lock, NULL);
+	if (err)
+		goto err_out_free_slices;
+
+	err = pthread_cond_init(&c->scrub_wait, NULL);
+	if (err)
+		goto err_out_lock_destroy;
+
+	/* must be set before the thread is started, since it enables tracking of changed records */
+	c->scrub_started = 1;
+
+	err = pthread_create(&c->scrub_tid, NULL, blob_scrub_thread, c);
+	if (err)
+		goto err_out_cond_destroy;
+
+	return 0;
+
+err_out_cond_destroy:
+	c->scrub_started = 0;
+	pthread_cond_destroy(&c->scrub_wait);
+err_out_lock_destroy:
+	pthread_mutex_destroy(&c->scrub_lock);
+err_out_free_slices:
+	free(c->scrub_slices);
+	c->scrub_slices = NULL;
+err_out_exit:
+	dnet_backend_log(c->blog, DNET_LOG_ERROR, "blob: could not start scrub thread: %d.", -err);
+	return -err;
+}
+
+static void blob_scrub_stop(struct eblob_backend_config *c)
+{
+	if (!c->scrub_started)
+		return;
+
+	pthread_mutex_lock(&c->scrub_lock);
+	c->scrub_need_exit = 1;
+	pthread_cond_broadcast(&c->scrub_wait);
+	pthread_mutex_unlock(&c->scrub_lock);
+
+	pthread_join(c->scrub_tid, NULL);
+
+	pthread_cond_destroy(&c->scrub_wait);
+	pthread_mutex_destroy(&c->scrub_lock);
+	free(c->scrub_slices);
+	c->scrub_slices = NULL;
+	c->scrub_started = 0;
+}
+
 static void eblob_backend_cleanup(void *priv)
 {
 	struct eblob_backend_config *c = priv;
 
+	blob_scrub_stop(c);
+	blob_expire_stop(c);
 	eblob_cleanup(c->eblob);
 
 	pthread_mutex_destroy(&c->last_read_lock);
@@ -1038,6 +1770,7 @@ static int dnet_blob_config_init(struct dnet_config_backend *b)
 	int err = 0;
 
 	c->blog = b->log;
+	c->node = b->node;
 
 	if (!c->data.file) {
 		dnet_backend_log(c->blog, DNET_LOG_ERROR, "blob: no data file present. Exiting.");
@@ -1073,7 +1806,16 @@ static int dnet_blob_config_init(struct dnet_config_backend *b)
 
 	c->vm_total = st.vm_total * st.vm_total * 1024 * 1024;
 
+	err = blob_expire_start(c);
+	if (err)
+		goto err_out_eblob_cleanup;
+
+	err = blob_scrub_start(c);
+	if (err)
+		goto err_out_expire_stop;
+
 	b->cb.storage_stat_json = eblob_backend_storage_stat_json;
+	b->cb.scrub_stat_json = eblob_backend_scrub_stat_json;
 	b->cb.total_elements = eblob_backend_total_elements;
 
 	b->cb.command_private = c;
@@ -1088,6 +1830,10 @@ static int dnet_blob_config_init(struct dnet_config_backend *b)
 
 	return 0;
 
+err_out_expire_stop:
+	blob_expire_stop(c);
+err_out_eblob_cleanup:
+	eblob_cleanup(c->eblob);
 err_out_last_read_lock_destroy:
 	pthread_mutex_destroy(&c->last_read_lock);
 err_out_exit:
@@ -1105,6 +1851,10 @@ static struct dnet_config_entry dnet_cfg_entries_blobsystem[] = {
 	{"sync", dnet_blob_set_sync},
 	{"data", dnet_blob_set_data},
 	{"blob_flags", dnet_blob_set_blob_flags},
+	{"expire_scan_timeout", dnet_blob_set_expire_scan_timeout},
+	{"scrub_rate", dnet_blob_set_scrub_rate},
+	{"scrub_interval", dnet_blob_set_scrub_interval},
+	{"scrub_fresh_time", dnet_blob_set_scrub_fresh_time},
 	{"blob_size", dnet_blob_set_blob_size},
 	{"records_in_blob", dnet_blob_set_records_in_blob},
 	{"defrag_timeout", dnet_blob_set_defrag_timeout},
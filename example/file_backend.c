@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <eblob/blob.h>
@@ -363,6 +364,11 @@ static int file_info(struct file_backend_root *r, void *state, struct dnet_cmd *
 		}
 	}
 
+	if (dnet_ext_list_expired(&elist, time(NULL))) {
+		err = -ENOENT;
+		goto err_out_close;
+	}
+
 	err = dnet_send_file_info_ts(state, cmd, fd, 0, -1, &elist.timestamp);
 	if (err)
 		goto err_out_close;
@@ -0,0 +1,637 @@
+/*
+ * 2015+ Copyright (c) Evgeniy Polyakov <zbr@ioremap.net>
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/*
+ * YCSB-like load generator
+ *
+ * Generates mix of reads, inserts, updates and removes of keys chosen by uniform, zipfian
+ * or latest distribution, limits number of requests in flight and optionally throughput.
+ * When target throughput is set requests are sent by fixed schedule (open loop)
+ * and latency is measured from the moment request had to be sent,
+ * so server stalls are not hidden by the generator waiting for replies.
+ *
+ * It can be run against local servers started by dnet_run_servers:
+ *   dnet_load --remote <remote from dnet_run_servers output> --groups 1 --records 100000 --load
+ */
+
+#include <elliptics/session.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace ioremap;
+
+typedef std::chrono::steady_clock clock_type;
+
+/*
+ * Histogram of latencies in microseconds with relative error less than 1%:
+ * values are split into power of two ranges and each range is split into 64 linear sub-buckets,
+ * the same layout as HdrHistogram with 2 significant digits.
+ */
+class latency_histogram {
+public:
+	latency_histogram() {
+		reset();
+	}
+
+	void reset() {
+		for (size_t i = 0; i < buckets_count; ++i)
+			m_buckets[i] = 0;
+		m_count = 0;
+		m_errors = 0;
+		m_sum = 0;
+		m_max = 0;
+	}
+
+	void record(uint64_t value) {
+		m_buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(value, std::memory_order_relaxed);
+
+		uint64_t max = m_max.load(std::memory_order_relaxed);
+		while (value > max && !m_max.compare_exchange_weak(max, value)) {
+		}
+	}
+
+	void record_error() {
+		m_errors.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	uint64_t count() const {
+		return m_count.load();
+	}
+
+	uint64_t errors() const {
+		return m_errors.load();
+	}
+
+	double mean() const {
+		uint64_t count = m_count.load();
+		return count ? (double)m_sum.load() / count : 0;
+	}
+
+	/*
+	 * Standard deviation around mean(), every value is taken as the middle of its bucket
+	 */
+	double stddev() const {
+		const uint64_t count = m_count.load();
+		if (!count)
+			return 0;
+
+		const double avg = mean();
+		double deviation = 0;
+		for (size_t i = 0; i < buckets_count; ++i) {
+			uint64_t bucket = m_buckets[i].load(std::memory_order_relaxed);
+			if (!bucket)
+				continue;
+
+			const uint64_t lowest = i ? highest_value(i - 1) + 1 : 0;
+			const double value = (lowest + std::min(highest_value(i), max())) / 2.;
+			deviation += bucket * (value - avg) * (value - avg);
+		}
+
+		return std::sqrt(deviation / count);
+	}
+
+	uint64_t max() const {
+		return m_max.load();
+	}
+
+	/*
+	 * Returns the highest value which is equivalent to \a percentile (0..100) of recorded values
+	 */
+	uint64_t percentile(double percentile) const {
+		const uint64_t count = m_count.load();
+		if (!count)
+			return 0;
+
+		uint64_t limit = std::max<uint64_t>(1, std::ceil(count * percentile / 100.));
+		uint64_t total = 0;
+		for (size_t i = 0; i < buckets_count; ++i) {
+			total += m_buckets[i].load(std::memory_order_relaxed);
+			if (total >= limit)
+				return std::min(highest_value(i), max());
+		}
+
+		return max();
+	}
+
+	/*
+	 * Writes percentile distribution in HdrHistogram text format
+	 */
+	void dump(std::ostream &out) const {
+		const uint64_t count = m_count.load();
+
+		out << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+
+		uint64_t total = 0;
+		for (size_t i = 0; i < buckets_count && total < count; ++i) {
+			uint64_t bucket = m_buckets[i].load(std::memory_order_relaxed);
+			if (!bucket)
+				continue;
+
+			total += bucket;
+
+			double percentile = (double)total / count;
+			char line[128];
+			if (total < count) {
+				snprintf(line, sizeof(line), "%12.3f %14.12f %10llu %14.2f\n",
+						(double)std::min(highest_value(i), max()), percentile,
+						(unsigned long long)total, 1. / (1. - percentile));
+			} else {
+				snprintf(line, sizeof(line), "%12.3f %14.12f %10llu\n",
+						(double)max(), percentile, (unsigned long long)total);
+			}
+			out << line;
+		}
+
+		char line[128];
+		snprintf(line, sizeof(line), "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n"
+				"#[Max     = %12.3f, Total count    = %12llu]\n",
+				mean(), stddev(), (double)max(), (unsigned long long)count);
+		out << line;
+	}
+
+private:
+	enum {
+		sub_buckets_count = 128,
+		half_sub_buckets_count = sub_buckets_count / 2,
+		buckets_count = sub_buckets_count + 57 * half_sub_buckets_count
+	};
+
+	static size_t index(uint64_t value) {
+		if (value < sub_buckets_count)
+			return value;
+
+		const int shift = 63 - __builtin_clzll(value) - 6;
+		return sub_buckets_count + (shift - 1) * half_sub_buckets_count
+			+ ((value >> shift) - half_sub_buckets_count);
+	}
+
+	static uint64_t highest_value(size_t index) {
+		if (index < sub_buckets_count)
+			return index;
+
+		const int shift = (index - sub_buckets_count) / half_sub_buckets_count + 1;
+		const uint64_t mantissa = (index - sub_buckets_count) % half_sub_buckets_count + half_sub_buckets_count;
+		return ((mantissa + 1) << shift) - 1;
+	}
+
+	std::atomic<uint64_t>	m_buckets[buckets_count];
+	std::atomic<uint64_t>	m_count;
+	std::atomic<uint64_t>	m_errors;
+	std::atomic<uint64_t>	m_sum;
+	std::atomic<uint64_t>	m_max;
+};
+
+/*
+ * Zipfian generator of numbers in [0, items) by Gray et al. "Quickly generating billion-record synthetic databases",
+ * the same algorithm as used by YCSB, 0 is the most popular item
+ */
+class zipfian_generator {
+public:
+	zipfian_generator(uint64_t items, double constant)
+	: m_items(items)
+	, m_theta(constant)
+	, m_zeta2(zeta(2, constant))
+	, m_alpha(1. / (1. - constant))
+	{
+		m_zetan = zeta(items, constant);
+		m_eta = (1. - std::pow(2. / items, 1. - m_theta)) / (1. - m_zeta2 / m_zetan);
+	}
+
+	template <typename Random>
+	uint64_t next(Random &random) {
+		const double u = std::uniform_real_distribution<double>(0, 1)(random);
+		const double uz = u * m_zetan;
+
+		if (uz < 1.)
+			return 0;
+		if (uz < 1. + std::pow(0.5, m_theta))
+			return std::min<uint64_t>(1, m_items - 1);
+
+		uint64_t ret = m_items * std::pow(m_eta * u - m_eta + 1., m_alpha);
+		return std::min(ret, m_items - 1);
+	}
+
+private:
+	static double zeta(uint64_t n, double theta) {
+		double sum = 0;
+		for (uint64_t i = 0; i < n; ++i)
+			sum += 1. / std::pow(i + 1, theta);
+		return sum;
+	}
+
+	uint64_t	m_items;
+	double		m_theta;
+	double		m_zeta2;
+	double		m_alpha;
+	double		m_zetan;
+	double		m_eta;
+};
+
+enum load_operation {
+	op_read = 0,
+	op_insert,
+	op_update,
+	op_remove,
+	op_count
+};
+
+static const char *operation_names[op_count] = {
+	"read", "insert", "update", "remove"
+};
+
+struct load_config {
+	std::string	prefix;
+	uint64_t	records;
+	uint64_t	operations;
+	double		duration;
+	double		proportions[op_count];
+	std::string	distribution;
+	double		zipfian_constant;
+	std::string	size_distribution;
+	uint64_t	size_min;
+	uint64_t	size_max;
+	size_t		concurrency;
+	double		target;
+	double		status_interval;
+	bool		load;
+};
+
+class load_generator {
+public:
+	load_generator(elliptics::session &session, const load_config &config)
+	: m_session(session)
+	, m_config(config)
+	, m_inserted(config.records)
+	, m_inflight(0)
+	, m_random(std::random_device()())
+	, m_data(elliptics::data_pointer::allocate(config.size_max))
+	{
+		for (uint64_t i = 0; i < config.size_max; ++i)
+			m_data.data<char>()[i] = 'a' + i % 26;
+
+		if (config.distribution != "uniform")
+			m_zipfian.reset(new zipfian_generator(config.records, config.zipfian_constant));
+		if (config.size_distribution == "zipfian")
+			m_size_zipfian.reset(new zipfian_generator(config.size_max - config.size_min + 1,
+						config.zipfian_constant));
+	}
+
+	/*
+	 * Inserts all \a records keys, so run phase has something to read and update
+	 */
+	void load() {
+		const clock_type::time_point start = clock_type::now();
+
+		for (uint64_t i = 0; i < m_config.records; ++i)
+			send(op_insert, i, clock_type::now());
+		wait_all();
+
+		report("load", std::chrono::duration<double>(clock_type::now() - start).count());
+		reset();
+	}
+
+	void run() {
+		const clock_type::time_point start = clock_type::now();
+		const clock_type::time_point finish = start + std::chrono::duration_cast<clock_type::duration>(
+				std::chrono::duration<double>(m_config.duration));
+		const auto interval = m_config.target > 0 ? std::chrono::duration_cast<clock_type::duration>(
+				std::chrono::duration<double>(1. / m_config.target)) : clock_type::duration::zero();
+		const auto status_interval = std::chrono::duration_cast<clock_type::duration>(
+				std::chrono::duration<double>(m_config.status_interval));
+
+		clock_type::time_point next_status = start + status_interval;
+		uint64_t last_total = 0;
+
+		for (uint64_t i = 0; !m_config.operations || i < m_config.operations; ++i) {
+			clock_type::time_point now = clock_type::now();
+			if (m_config.duration > 0 && now >= finish)
+				break;
+
+			clock_type::time_point intended = now;
+			if (m_config.target > 0) {
+				intended = start + interval * i;
+				if (intended > now)
+					std::this_thread::sleep_until(intended);
+			}
+
+			if (m_config.status_interval > 0 && now >= next_status) {
+				uint64_t total = completed();
+				std::cout << "status: time: " << std::chrono::duration<double>(now - start).count()
+					<< " s, operations: " << total
+					<< ", throughput: " << (total - last_total) / m_config.status_interval << " ops/s"
+					<< ", in flight: " << m_inflight << std::endl;
+				last_total = total;
+				next_status += status_interval;
+			}
+
+			load_operation op = next_operation();
+			send(op, next_key(op), intended);
+		}
+		wait_all();
+
+		report("run", std::chrono::duration<double>(clock_type::now() - start).count());
+	}
+
+	void dump_histograms(std::ostream &out) const {
+		for (int op = 0; op < op_count; ++op) {
+			if (!m_histograms[op].count())
+				continue;
+
+			out << "# " << operation_names[op] << ", latency in microseconds\n";
+			m_histograms[op].dump(out);
+			out << "\n";
+		}
+	}
+
+private:
+	load_operation next_operation() {
+		double point = std::uniform_real_distribution<double>(0, 1)(m_random);
+		for (int op = 0; op < op_count; ++op) {
+			if (point < m_config.proportions[op])
+				return (load_operation)op;
+			point -= m_config.proportions[op];
+		}
+		return op_read;
+	}
+
+	uint64_t next_key(load_operation op) {
+		if (op == op_insert)
+			return m_inserted++;
+
+		const uint64_t inserted = m_inserted.load();
+
+		if (m_config.distribution == "uniform")
+			return std::uniform_int_distribution<uint64_t>(0, inserted - 1)(m_random);
+
+		const uint64_t key = m_zipfian->next(m_random);
+		if (m_config.distribution == "latest")
+			return inserted - 1 - std::min(key, inserted - 1);
+
+		return key;
+	}
+
+	uint64_t next_size() {
+		if (m_config.size_distribution == "constant")
+			return m_config.size_max;
+		if (m_config.size_distribution == "zipfian")
+			return m_config.size_min + m_size_zipfian->next(m_random);
+
+		return std::uniform_int_distribution<uint64_t>(m_config.size_min, m_config.size_max)(m_random);
+	}
+
+	void send(load_operation op, uint64_t index, clock_type::time_point intended) {
+		{
+			std::unique_lock<std::mutex> guard(m_lock);
+			m_wait.wait(guard, [this] () { return m_inflight < m_config.concurrency; });
+			++m_inflight;
+		}
+
+		const elliptics::key id(m_config.prefix + elliptics::lexical_cast(index));
+		latency_histogram &histogram = m_histograms[op];
+
+		auto on_final = [this, &histogram, intended] (const elliptics::error_info &error) {
+			if (error) {
+				histogram.record_error();
+			} else {
+				histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(
+						clock_type::now() - intended).count());
+			}
+
+			std::unique_lock<std::mutex> guard(m_lock);
+			--m_inflight;
+			m_wait.notify_all();
+		};
+
+		switch (op) {
+		case op_read:
+			m_session.read_data(id, 0, 0).connect(
+				elliptics::async_read_result::result_function(), on_final);
+			break;
+		case op_insert:
+		case op_update:
+			m_session.write_data(id, elliptics::data_pointer::from_raw(m_data.data(), next_size()), 0).connect(
+				elliptics::async_write_result::result_function(), on_final);
+			break;
+		case op_remove:
+			m_session.remove(id).connect(
+				elliptics::async_remove_result::result_function(), on_final);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void wait_all() {
+		std::unique_lock<std::mutex> guard(m_lock);
+		m_wait.wait(guard, [this] () { return m_inflight == 0; });
+	}
+
+	uint64_t completed() const {
+		uint64_t total = 0;
+		for (int op = 0; op < op_count; ++op)
+			total += m_histograms[op].count() + m_histograms[op].errors();
+		return total;
+	}
+
+	void reset() {
+		for (int op = 0; op < op_count; ++op)
+			m_histograms[op].reset();
+	}
+
+	void report(const char *phase, double seconds) const {
+		char line[256];
+
+		snprintf(line, sizeof(line), "%s: time: %.3f s, operations: %llu, throughput: %.1f ops/s",
+				phase, seconds, (unsigned long long)completed(), completed() / seconds);
+		std::cout << line << std::endl;
+
+		for (int op = 0; op < op_count; ++op) {
+			const latency_histogram &h = m_histograms[op];
+			if (!h.count() && !h.errors())
+				continue;
+
+			snprintf(line, sizeof(line), "%s: %-6s: operations: %llu, errors: %llu, latency (us): "
+					"mean: %.1f, p50: %llu, p95: %llu, p99: %llu, p99.9: %llu, max: %llu",
+					phase, operation_names[op],
+					(unsigned long long)h.count(), (unsigned long long)h.errors(), h.mean(),
+					(unsigned long long)h.percentile(50), (unsigned long long)h.percentile(95),
+					(unsigned long long)h.percentile(99), (unsigned long long)h.percentile(99.9),
+					(unsigned long long)h.max());
+			std::cout << line << std::endl;
+		}
+	}
+
+	elliptics::session			&m_session;
+	const load_config			&m_config;
+	std::atomic<uint64_t>			m_inserted;
+
+	std::mutex				m_lock;
+	std::condition_variable			m_wait;
+	size_t					m_inflight;
+
+	std::mt19937_64				m_random;
+	std::unique_ptr<zipfian_generator>	m_zipfian;
+	std::unique_ptr<zipfian_generator>	m_size_zipfian;
+	elliptics::data_pointer			m_data;
+
+	latency_histogram			m_histograms[op_count];
+};
+
+int main(int argc, char *argv[])
+{
+	namespace bpo = boost::program_options;
+
+	bpo::options_description generic("Load generator options");
+
+	load_config config;
+	std::string log_level_name;
+	std::string log, groups, hdr_output;
+	std::vector<std::string> remotes;
+
+	generic.add_options()
+		("help", "This help message")
+		("log", bpo::value<std::string>(&log)->default_value("/dev/stderr"), "Elliptics log file")
+		("log-level", bpo::value<std::string>(&log_level_name)->default_value("error"), "Elliptics log level")
+		("remote", bpo::value<std::vector<std::string>>(&remotes)->composing(),
+			"Elliptics remote node to connect to, can be specified multiple times")
+		("groups", bpo::value<std::string>(&groups), "Elliptics remote groups to work with")
+		("prefix", bpo::value<std::string>(&config.prefix)->default_value("load-"), "Prefix of the keys")
+		("records", bpo::value<uint64_t>(&config.records)->default_value(100000), "Number of keys in the key space")
+		("load", bpo::bool_switch(&config.load), "Insert all records before running the workload")
+		("operations", bpo::value<uint64_t>(&config.operations)->default_value(0),
+			"Number of operations to run, 0 means unlimited")
+		("duration", bpo::value<double>(&config.duration)->default_value(0),
+			"Maximum duration of the workload in seconds, 0 means unlimited")
+		("read-proportion", bpo::value<double>(&config.proportions[op_read])->default_value(0.5),
+			"Proportion of reads")
+		("insert-proportion", bpo::value<double>(&config.proportions[op_insert])->default_value(0),
+			"Proportion of writes of new keys")
+		("update-proportion", bpo::value<double>(&config.proportions[op_update])->default_value(0.5),
+			"Proportion of overwrites of existing keys")
+		("remove-proportion", bpo::value<double>(&config.proportions[op_remove])->default_value(0),
+			"Proportion of removes")
+		("distribution", bpo::value<std::string>(&config.distribution)->default_value("zipfian"),
+			"Distribution of keys: uniform, zipfian or latest")
+		("zipfian-constant", bpo::value<double>(&config.zipfian_constant)->default_value(0.99),
+			"Constant of zipfian distributions")
+		("size-distribution", bpo::value<std::string>(&config.size_distribution)->default_value("constant"),
+			"Distribution of object sizes: constant, uniform or zipfian")
+		("size-min", bpo::value<uint64_t>(&config.size_min)->default_value(1024), "Minimum object size")
+		("size-max", bpo::value<uint64_t>(&config.size_max)->default_value(1024),
+			"Maximum object size, size of objects for constant distribution")
+		("concurrency", bpo::value<size_t>(&config.concurrency)->default_value(64),
+			"Maximum number of requests in flight")
+		("target", bpo::value<double>(&config.target)->default_value(0),
+			"Target throughput in operations per second, 0 means as fast as possible")
+		("status-interval", bpo::value<double>(&config.status_interval)->default_value(10),
+			"Interval of status reports in seconds, 0 disables them")
+		("hdr-output", bpo::value<std::string>(&hdr_output),
+			"File to write latency percentile distributions to in HdrHistogram format")
+		;
+
+	bpo::options_description cmdline_options;
+	cmdline_options.add(generic);
+
+	bpo::variables_map vm;
+	dnet_log_level log_level;
+
+	try {
+		bpo::store(bpo::command_line_parser(argc, argv).options(cmdline_options).run(), vm);
+
+		if (vm.count("help")) {
+			std::cout << generic << std::endl;
+			return 0;
+		}
+
+		bpo::notify(vm);
+
+		log_level = elliptics::file_logger::parse_level(log_level_name);
+
+		if (remotes.empty())
+			throw std::invalid_argument("at least one remote must be specified");
+		if (!config.records)
+			throw std::invalid_argument("records must be positive");
+		if (!config.concurrency)
+			throw std::invalid_argument("concurrency must be positive");
+		if (config.size_min > config.size_max)
+			throw std::invalid_argument("size-min must not be greater than size-max");
+		if (config.distribution != "uniform" && config.distribution != "zipfian" && config.distribution != "latest")
+			throw std::invalid_argument("unknown distribution: " + config.distribution);
+		if (config.size_distribution != "constant" && config.size_distribution != "uniform" &&
+				config.size_distribution != "zipfian")
+			throw std::invalid_argument("unknown size distribution: " + config.size_distribution);
+		if (config.zipfian_constant <= 0 || config.zipfian_constant >= 1)
+			throw std::invalid_argument("zipfian-constant must be in (0, 1)");
+
+		double sum = 0;
+		for (int op = 0; op < op_count; ++op) {
+			if (config.proportions[op] < 0)
+				throw std::invalid_argument(std::string(operation_names[op]) + "-proportion must not be negative");
+			sum += config.proportions[op];
+		}
+		if (sum <= 0)
+			throw std::invalid_argument("sum of proportions must be positive");
+		for (int op = 0; op < op_count; ++op)
+			config.proportions[op] /= sum;
+
+		if (!config.operations && config.duration <= 0)
+			config.operations = config.records;
+	} catch (const std::exception &e) {
+		std::cerr << "Invalid options: " << e.what() << "\n" << generic << std::endl;
+		return -1;
+	}
+
+	elliptics::file_logger logger(log.c_str(), log_level);
+	elliptics::node node(elliptics::logger(logger, blackhole::log::attributes_t()));
+
+	try {
+		for (auto it = remotes.begin(); it != remotes.end(); ++it)
+			node.add_remote(*it);
+
+		elliptics::session session(node);
+		session.set_groups(elliptics::parse_groups(groups.c_str()));
+		session.set_exceptions_policy(elliptics::session::no_exceptions);
+
+		load_generator generator(session, config);
+
+		if (config.load)
+			generator.load();
+
+		generator.run();
+
+		if (!hdr_output.empty()) {
+			std::ofstream out(hdr_output.c_str());
+			generator.dump_histograms(out);
+		}
+	} catch (const std::exception &e) {
+		std::cerr << "Exception caught: " << e.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -83,6 +83,8 @@ struct dnet_config_backend {
 	unsigned long long		storage_free;
 
 	dnet_logger			*log;
+	/* node which owns the backend, set before @init is called */
+	struct dnet_node		*node;
 
 	int				(* init)(struct dnet_config_backend *b);
 	void				(* cleanup)(struct dnet_config_backend *b);
@@ -85,6 +85,28 @@
 
 #define DNET_DEFAULT_CACHE_PAGES_NUMBER 1
 
+#define DNET_DEFAULT_MONITOR_REPORT_CACHE_LIFETIME_MS 0
+
+#define DNET_DEFAULT_LOG_ASYNC_RING_SIZE 4096
+
+#define DNET_DEFAULT_MONITOR_HOT_KEYS_TOP 16
+
+#define DNET_DEFAULT_MONITOR_HOT_KEYS_SKETCH_WIDTH 1024
+
+#define DNET_DEFAULT_MONITOR_HOT_KEYS_WINDOW_MS 10000
+
+#define DNET_DEFAULT_MONITOR_SLOW_REQUESTS_SIZE 256
+
+#define DNET_DEFAULT_MONITOR_SLOW_REQUEST_THRESHOLD_MS 1000
+
+#define DNET_DEFAULT_MONITOR_SLOW_REQUEST_SAMPLE_RATE 0.001
+
+#define DNET_DEFAULT_MONITOR_SERVER_THREADS 2
+
+#define DNET_DEFAULT_MONITOR_SERVER_MAX_CONNECTIONS 64
+
+#define DNET_DEFAULT_MONITOR_SERVER_TIMEOUT_MS 5000
+
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
 #ifndef dnet_offsetof
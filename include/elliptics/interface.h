@@ -173,6 +173,7 @@ int __attribute__((weak)) dnet_send_read_data(void *state, struct dnet_cmd *cmd,
 #define DNET_CFG_NO_CSUM		(1<<3)		/* globally disable checksum verification and update */
 #define DNET_CFG_RANDOMIZE_STATES	(1<<5)		/* randomize states for read requests */
 #define DNET_CFG_KEEPS_IDS_IN_CLUSTER	(1<<6)		/* keeps ids in elliptics cluster */
+#define DNET_CFG_BALANCED_IDS		(1<<7)		/* new ids split the largest ranges of the group instead of being random */
 
 static inline const char *dnet_flags_dump_cfgflags(uint64_t flags)
 {
@@ -184,6 +185,7 @@ static inline const char *dnet_flags_dump_cfgflags(uint64_t flags)
 		{ DNET_CFG_NO_CSUM, "n_ocsum" },
 		{ DNET_CFG_RANDOMIZE_STATES, "randomize_states" },
 		{ DNET_CFG_KEEPS_IDS_IN_CLUSTER, "keeps_ids_in_cluster" },
+		{ DNET_CFG_BALANCED_IDS, "balanced_ids" },
 	};
 
 	dnet_flags_dump_raw(buffer, sizeof(buffer), flags, infos, sizeof(infos) / sizeof(infos[0]));
@@ -222,6 +224,9 @@ struct dnet_backend_callbacks {
 	/* fills storage statistics in json format */
 	int			(* storage_stat_json)(void *priv, char **json_stat, size_t *size);
 
+	/* fills statistics of background verification of stored data in json format, may be NULL */
+	int			(* scrub_stat_json)(void *priv, char **json_stat, size_t *size);
+
 	/* returns total elements at backend */
 	uint64_t	(* total_elements)(void *priv);
 
@@ -383,6 +388,12 @@ void dnet_session_set_direct_backend(struct dnet_session *s, uint32_t backend_id
 void dnet_session_set_user_flags(struct dnet_session *s, uint64_t user_flags);
 uint64_t dnet_session_get_user_flags(struct dnet_session *s);
 
+/*
+ * Objects written by the session expire @ttl seconds after the write, zero means they never expire
+ */
+void dnet_session_set_ttl(struct dnet_session *s, uint64_t ttl);
+uint64_t dnet_session_get_ttl(struct dnet_session *s);
+
 void dnet_session_set_timeout(struct dnet_session *s, long wait_timeout);
 struct timespec *dnet_session_get_timeout(struct dnet_session *s);
 
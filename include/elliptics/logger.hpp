@@ -18,6 +18,8 @@
 #include <blackhole/formatter/map/value.hpp>
 #include <blackhole/defaults/severity.hpp>
 
+#include <memory>
+
 #ifdef BOOST_BIND_NO_PLACEHOLDERS_SET_BY_ELLIPTICS
 # undef BOOST_BIND_NO_PLACEHOLDERS_SET_BY_ELLIPTICS
 # undef BOOST_BIND_NO_PLACEHOLDERS
@@ -57,6 +59,16 @@ typedef ioremap::elliptics::log_level dnet_log_level;
 
 #define ELLIPTICS_LOG_LEVEL ioremap::elliptics::log_level
 
+/*
+ * Asynchronous logging mode: records of all loggers which write to @logger are formatted
+ * and written by background thread, which shares ownership of @logger,
+ * each thread keeps up to @ring_size not yet written records, the others are dropped.
+ * Records of other loggers are written synchronously.
+ * dnet_log_async_stop() writes all remaining records, it must be called
+ * after all logging threads are stopped.
+ */
+int dnet_log_async_start(const std::shared_ptr<ioremap::elliptics::logger_base> &logger, size_t ring_size);
+
 extern "C" {
 #else
 typedef struct cpp_ioremap_elliptics_logger dnet_logger;
@@ -90,6 +102,10 @@ void dnet_log_write(dnet_logger *logger, dnet_logger_record *record, const char
 void dnet_log_write_err(dnet_logger *logger, dnet_logger_record *record, int err, const char *format, ...) __attribute__ ((format(printf, 4, 5)));
 void dnet_log_close_record(dnet_logger_record *record);
 
+void dnet_log_async_stop();
+int dnet_log_async_enabled();
+uint64_t dnet_log_async_dropped();
+
 #undef ELLIPTICS_LOG_LEVEL
 
 #ifdef __cplusplus
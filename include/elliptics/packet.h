@@ -89,6 +89,9 @@ enum dnet_commands {
 #define DNET_MONITOR_BACKEND		(1<<4)				/* backend statistics */
 #define DNET_MONITOR_PROCFS			(1<<6)				/* virtual memory statistics */
 #define DNET_MONITOR_STATS			(1<<7)				/* statistics gathered by handystats */
+#define DNET_MONITOR_HOT_KEYS		(1<<8)				/* most requested keys of each backend */
+#define DNET_MONITOR_REQUEST_STAGES	(1<<9)				/* time spent by requests at each stage of processing */
+#define DNET_MONITOR_SLOW_REQUESTS	(1<<10)				/* the last slow and randomly sampled requests */
 #define DNET_MONITOR_ALL			(-1)				/* all available statistics */
 
 enum dnet_backend_command {
@@ -98,6 +101,7 @@ enum dnet_backend_command {
 	DNET_BACKEND_SET_IDS,
 	DNET_BACKEND_READ_ONLY,
 	DNET_BACKEND_WRITEABLE,
+	DNET_BACKEND_MIGRATE_IDS,	/* set ids and copy data of received key ranges from their previous owners */
 };
 
 enum dnet_backend_state {
@@ -369,6 +373,23 @@ static inline void dnet_convert_addr_cmd(struct dnet_addr_cmd *acmd)
 	dnet_convert_cmd(&acmd->cmd);
 }
 
+/*
+ * Versioned route list request.
+ * Request carries @version of the route list received from the node before, zero means nothing was received.
+ * Node replies only with addresses of states added after that version and places its current version
+ * right after the addresses. Requests without this structure receive the whole route list without version.
+ */
+struct dnet_route_list_version
+{
+	uint64_t		version;
+	uint64_t		reserved[3];
+} __attribute__ ((packed));
+
+static inline void dnet_convert_route_list_version(struct dnet_route_list_version *v)
+{
+	v->version = dnet_bswap64(v->version);
+}
+
 static inline int dnet_addr_cmp(const struct dnet_addr *a1, const struct dnet_addr *a2)
 {
 	if (a1->family != a2->family)
@@ -479,6 +500,27 @@ static inline void dnet_convert_list(struct dnet_list *l)
  */
 #define DNET_IO_FLAGS_WRITE_NO_FILE_INFO	(1<<14)
 
+/*
+ * DNET_IO_FLAGS_REPLICATE
+ *
+ * Write is sent only to the first group. Node which receives it stores the object
+ * and writes it to the rest groups listed in struct dnet_io_replicas,
+ * which is placed between dnet_io_attr and data.
+ * Result of every group is returned as separate reply with DNET_FLAGS_MORE,
+ * the last reply without DNET_FLAGS_MORE only completes the transaction.
+ */
+#define DNET_IO_FLAGS_REPLICATE		(1<<15)
+
+/*
+ * DNET_IO_FLAGS_READ_RANGES
+ *
+ * Read several ranges of one object in a single request. Ranges are listed in struct dnet_io_ranges,
+ * which follows dnet_io_attr, offset and size of dnet_io_attr are ignored.
+ * Single reply contains dnet_io_attr, struct dnet_io_ranges with ranges actually read
+ * (they are cut by the object's size) and data of these ranges one after another.
+ */
+#define DNET_IO_FLAGS_READ_RANGES	(1<<16)
+
 static inline const char *dnet_flags_dump_ioflags(uint64_t flags)
 {
 	static __thread char buffer[256];
@@ -498,6 +540,8 @@ static inline const char *dnet_flags_dump_ioflags(uint64_t flags)
 		{ DNET_IO_FLAGS_COMPARE_AND_SWAP, "cas" },
 		{ DNET_IO_FLAGS_CHECKSUM, "checksum" },
 		{ DNET_IO_FLAGS_WRITE_NO_FILE_INFO, "no_file_info" },
+		{ DNET_IO_FLAGS_REPLICATE, "replicate" },
+		{ DNET_IO_FLAGS_READ_RANGES, "read_ranges" },
 	};
 
 	dnet_flags_dump_raw(buffer, sizeof(buffer), flags, infos, sizeof(infos) / sizeof(infos[0]));
@@ -736,7 +780,11 @@ struct dnet_io_attr
 	 */
 	uint64_t		total_size;
 
-	uint64_t		reserved1;
+	/*
+	 * Absolute expiration time of the object in seconds since epoch, zero means object never expires.
+	 * It is stored in extended header on write and returned by read. Expired object is treated as absent.
+	 */
+	uint64_t		expire;
 	uint32_t		reserved2;
 
 	uint32_t		flags;
@@ -752,10 +800,57 @@ static inline void dnet_convert_io_attr(struct dnet_io_attr *a)
 	a->flags = dnet_bswap32(a->flags);
 	a->offset = dnet_bswap64(a->offset);
 	a->size = dnet_bswap64(a->size);
+	a->expire = dnet_bswap64(a->expire);
 
 	dnet_convert_time(&a->timestamp);
 }
 
+/*
+ * Groups which have to receive replicated write, see DNET_IO_FLAGS_REPLICATE.
+ * Every group id has to be converted by dnet_bswap32() separately.
+ */
+struct dnet_io_replicas
+{
+	uint32_t		num;
+	uint32_t		reserved;
+	int			groups[0];
+} __attribute__ ((packed));
+
+static inline void dnet_convert_io_replicas(struct dnet_io_replicas *r)
+{
+	r->num = dnet_bswap32(r->num);
+}
+
+/*
+ * Range of the object, zero @size means the rest of the object, see DNET_IO_FLAGS_READ_RANGES.
+ */
+struct dnet_io_range
+{
+	uint64_t		offset;
+	uint64_t		size;
+} __attribute__ ((packed));
+
+struct dnet_io_ranges
+{
+	uint32_t		num;
+	uint32_t		reserved;
+	struct dnet_io_range	ranges[0];
+} __attribute__ ((packed));
+
+/*
+ * Every range has to be converted by dnet_convert_io_range() separately.
+ */
+static inline void dnet_convert_io_ranges(struct dnet_io_ranges *r)
+{
+	r->num = dnet_bswap32(r->num);
+}
+
+static inline void dnet_convert_io_range(struct dnet_io_range *r)
+{
+	r->offset = dnet_bswap64(r->offset);
+	r->size = dnet_bswap64(r->size);
+}
+
 struct dnet_io_notification
 {
 	struct dnet_addr		addr;
@@ -895,7 +990,8 @@ struct dnet_ext_list_hdr {
 	uint32_t		size;		/* Size of all extensions */
 	struct dnet_time	timestamp;	/* Time stamp of record */
 	uint64_t		flags;		/* Custom flags for this record */
-	uint64_t		__pad2[2];	/* For future use (should be NULLed) */
+	uint64_t		expire;		/* Expiration time of record in seconds, 0 - never */
+	uint64_t		__pad2[1];	/* For future use (should be NULLed) */
 } __attribute__ ((packed));
 
 /*! In-memory extension conatiner */
@@ -904,10 +1000,17 @@ struct dnet_ext_list {
 	uint32_t		size;		/* Total size of extensions */
 	uint64_t		flags;		/* Custom flags for this record */
 	struct dnet_time	timestamp;	/* TS of header */
+	uint64_t		expire;		/* Expiration time of record in seconds, 0 - never */
 	struct dnet_ext		**exts;		/* Array of pointers to extensions */
 	void			*data;		/* Pointer to original data before extraction */
 };
 
+/*! Returns true if record described by \a elist has expired by \a now (seconds since epoch) */
+static inline int dnet_ext_list_expired(const struct dnet_ext_list *elist, uint64_t now)
+{
+	return elist->expire && elist->expire <= now;
+}
+
 /*! Types of extensions */
 enum {
 	DNET_EXTENSION_FIRST,		/* Assert */
@@ -1095,12 +1198,14 @@ static inline void dnet_convert_defrag_ctl(struct dnet_defrag_ctl *ctl)
 struct dnet_monitor_stat_request {
 	uint64_t	categories;
 	int			reserved_int; // reserved for packing
-	uint64_t	reserved[4];
+	uint64_t	since_version; // if not zero, only values changed since this report version are returned
+	uint64_t	reserved[3];
 } __attribute__ ((packed));
 
 static inline void dnet_convert_monitor_stat_request(struct dnet_monitor_stat_request *r)
 {
 	r->categories = dnet_bswap32(r->categories);
+	r->since_version = dnet_bswap64(r->since_version);
 }
 
 #ifdef __cplusplus
@@ -130,6 +130,8 @@ class read_result_entry : public callback_result_entry
 
 		struct dnet_io_attr *io_attribute() const;
 		data_pointer file() const;
+		// data of every range of DNET_IO_FLAGS_READ_RANGES read, the whole file() otherwise
+		std::vector<data_pointer> ranges() const;
 };
 
 class lookup_result_entry : public callback_result_entry
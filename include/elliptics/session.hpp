@@ -370,6 +370,17 @@ class session
 		 */
 		uint64_t		get_user_flags() const;
 
+		/*!
+		 * Sets lifetime \a ttl in seconds of objects written by the session.
+		 * Expired objects are treated as absent and removed by the server.
+		 * If set to zero (default), objects never expire.
+		 */
+		void			set_ttl(uint64_t ttl);
+		/*!
+		 * Gets lifetime of objects written by the session.
+		 */
+		uint64_t		get_ttl() const;
+
 		/*!
 		 * Set/get transaction timeout
 		 */
@@ -426,6 +437,15 @@ class session
 		 */
 		async_read_result read_data(const key &id, uint64_t offset, uint64_t size);
 
+		/*!
+		 * Reads several \a ranges of the object by the key \a id in a single request.
+		 * Zero size of the range means the rest of the object, ranges are cut by the object's size.
+		 *
+		 * Returns async_read_result with single entry, its ranges() are data of every range
+		 * and file() is data of all ranges one after another.
+		 */
+		async_read_result read_ranges(const key &id, const std::vector<dnet_io_range> &ranges);
+
 		/*!
 		 * Filters the list \a groups and leaves only ones with the latest
 		 * data at key \a id.
@@ -546,6 +566,31 @@ class session
 		 */
 		async_write_result write_cache(const key &id, const argument_data &file, long timeout);
 
+		/*!
+		 * Writes data \a file as the striped object by the key \a id.
+		 *
+		 * Data is split into stripes of \a stripe_size bytes, which are written in parallel
+		 * by keys derived from \a id and spread over the whole key space. Small manifest
+		 * with the object's layout is written by \a id after all stripes are written,
+		 * so the object is read with full cluster's bandwidth instead of the one of a single node.
+		 *
+		 * Returns async_write_result of the manifest write.
+		 *
+		 * \note Striped object has to be read by read_striped and removed by remove_striped.
+		 *       If any stripe is not written the manifest is not written either.
+		 *       Every write puts stripes by its own keys, stripes of the previous version
+		 *       are removed after the new manifest is written to all groups.
+		 */
+		async_write_result write_striped(const key &id, const data_pointer &file, uint64_t stripe_size);
+
+		/*!
+		 * Reads the striped object written by write_striped by the key \a id.
+		 * Stripes are read in parallel.
+		 *
+		 * Returns async_read_result with single entry which contains the whole object.
+		 */
+		async_read_result read_striped(const key &id);
+
 		/*!
 		 * Returns address (ip and port pair) of remote node where
 		 * data with key \a id may be in group \a group_id.
@@ -587,6 +632,13 @@ class session
 		 */
 		async_remove_result remove(const key &id);
 
+		/*!
+		 * Removes the striped object by the key \a id: all its stripes and then the manifest.
+		 *
+		 * Returns async_remove_result of the manifest removal.
+		 */
+		async_remove_result remove_striped(const key &id);
+
 		/*!
 		 * Removes vector of keys from all server nodes.
 		 * Returns async_remove_result.
@@ -603,6 +655,12 @@ class session
 		 */
 		async_monitor_stat_result monitor_stat(const address &addr, uint64_t categories);
 
+		/*!
+		 * Queries monitor statistics information from the server node specified by \a id.
+		 * Only values changed since report with version \a since_version are returned.
+		 */
+		async_monitor_stat_result monitor_stat(const address &addr, uint64_t categories, uint64_t since_version);
+
 		/*!
 		 * Returns the number of session states.
 		 */
@@ -624,6 +682,11 @@ class session
 		async_backend_control_result disable_backend(const address &addr, uint32_t backend_id);
 		async_backend_control_result start_defrag(const address &addr, uint32_t backend_id);
 		async_backend_control_result set_backend_ids(const address &addr, uint32_t backend_id, const std::vector<dnet_raw_id> &ids);
+		/*!
+		 * Sets \a ids of the backend like set_backend_ids(), but the backend copies objects of the received key ranges
+		 * from their previous owners in background and proxies reads which miss in these ranges until they are copied.
+		 */
+		async_backend_control_result migrate_backend_ids(const address &addr, uint32_t backend_id, const std::vector<dnet_raw_id> &ids);
 		async_backend_control_result make_readonly(const address &addr, uint32_t backend_id);
 		async_backend_control_result make_writable(const address &addr, uint32_t backend_id);
 		async_backend_status_result request_backends_status(const address &addr);
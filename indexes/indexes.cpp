@@ -471,6 +471,10 @@ static bool entry_time_less_than(const dnet_index_entry &first, const dnet_index
 		(first.time.tsec == second.time.tsec && first.time.tnsec < second.time.tnsec);
 }
 
+} /* namespace */
+
+namespace ioremap { namespace elliptics {
+
 /*!
  * Update data-object table for certain secondary index.
  *
@@ -589,6 +593,10 @@ data_pointer convert_index_table(dnet_node *node, dnet_id *cmd_id, const dnet_in
 	return std::move(new_buffer);
 }
 
+}} /* namespace ioremap::elliptics */
+
+namespace {
+
 int process_internal_indexes_entry(struct dnet_backend_io *backend, dnet_node *node, const dnet_indexes_request &request,
 	dnet_indexes_request_entry &entry, std::vector<dnet_indexes_reply_entry> * &removed)
 {
@@ -1,18 +1,95 @@
 #include "elliptics.h"
+#include "migration.h"
 #include "../monitor/monitor.hpp"
 #include "../example/config.hpp"
 #include "../bindings/cpp/functional_p.h"
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
+#include <vector>
 
 #include <fcntl.h>
+#include <sched.h>
 
-static int dnet_ids_generate(struct dnet_node *n, const char *file, unsigned long long storage_free)
+/*
+ * Position of the id in the ring, the first 8 bytes of the id are precise enough to compare key-space shares
+ */
+static uint64_t dnet_id_position(const dnet_raw_id &id)
+{
+	uint64_t position = 0;
+	for (size_t i = 0; i < sizeof(position); ++i)
+		position = (position << 8) | id.id[i];
+	return position;
+}
+
+static void dnet_id_set_position(dnet_raw_id &id, uint64_t position)
+{
+	for (size_t i = sizeof(position); i > 0; --i) {
+		id.id[i - 1] = position & 0xff;
+		position >>= 8;
+	}
+}
+
+/*
+ * Places @ids into the middles of the largest ranges of the group's ring.
+ * Every id is generated per fixed amount of storage, so splitting the largest range each time
+ * keeps key-space shares of the group's backends proportional to their capacity.
+ * Only the position is changed, the rest of the random bytes are kept to avoid collisions.
+ */
+static void dnet_ids_balance(struct dnet_node *n, int group_id, std::vector<dnet_raw_id> &ids)
+{
+	std::vector<uint64_t> positions;
+	struct dnet_group *g;
+
+	pthread_mutex_lock(&n->state_lock);
+	list_for_each_entry(g, &n->group_list, group_entry) {
+		if (g->group_id != static_cast<unsigned int>(group_id))
+			continue;
+
+		positions.reserve(g->id_num + ids.size());
+		for (int i = 0; i < g->id_num; ++i)
+			positions.push_back(dnet_id_position(g->ids[i].raw));
+		break;
+	}
+	pthread_mutex_unlock(&n->state_lock);
+
+	const size_t known = positions.size();
+
+	for (auto it = ids.begin(); it != ids.end(); ++it) {
+		if (positions.empty()) {
+			positions.push_back(dnet_id_position(*it));
+			continue;
+		}
+
+		std::sort(positions.begin(), positions.end());
+
+		/* the range of the last id wraps around the ring, it is the whole ring if there is the only id */
+		uint64_t start = positions.back();
+		uint64_t gap = positions.front() - positions.back();
+		if (positions.size() == 1)
+			gap = ~0ULL;
+
+		for (size_t i = 1; i < positions.size(); ++i) {
+			if (positions[i] - positions[i - 1] > gap) {
+				start = positions[i - 1];
+				gap = positions[i] - positions[i - 1];
+			}
+		}
+
+		const uint64_t position = start + gap / 2;
+		dnet_id_set_position(*it, position);
+		positions.push_back(position);
+	}
+
+	dnet_log(n, DNET_LOG_INFO, "balanced %zu new ids in group %d with %zu known ids", ids.size(), group_id, known);
+}
+
+static int dnet_ids_generate(struct dnet_node *n, const char *file, unsigned long long storage_free, int group_id)
 {
 	const unsigned long long size_per_id = 100 * 1024 * 1024 * 1024ULL;
 	const size_t num = storage_free / size_per_id + 1;
-	dnet_raw_id tmp;
+	std::vector<dnet_raw_id> ids(num);
 	const char *random_source = "/dev/urandom";
 	int err = 0;
 
@@ -25,6 +102,17 @@ static int dnet_ids_generate(struct dnet_node *n, const char *file, unsigned lon
 		goto err_out_exit;
 	}
 
+	for (size_t i = 0; i < num; ++i) {
+		if (!in.read(reinterpret_cast<char *>(ids[i].id), sizeof(ids[i].id))) {
+			err = -errno;
+			dnet_log_err(n, "failed to read id from '%s'", random_source);
+			goto err_out_exit;
+		}
+	}
+
+	if (n->flags & DNET_CFG_BALANCED_IDS)
+		dnet_ids_balance(n, group_id, ids);
+
 	out.open(file, std::ofstream::binary | std::ofstream::trunc);
 	if (!out) {
 		err = -errno;
@@ -33,13 +121,7 @@ static int dnet_ids_generate(struct dnet_node *n, const char *file, unsigned lon
 	}
 
 	for (size_t i = 0; i < num; ++i) {
-		if (!in.read(reinterpret_cast<char *>(tmp.id), sizeof(tmp.id))) {
-			err = -errno;
-			dnet_log_err(n, "failed to read id from '%s'", random_source);
-			goto err_out_unlink;
-		}
-
-		if (!out.write(reinterpret_cast<char *>(tmp.id), sizeof(tmp.id))) {
+		if (!out.write(reinterpret_cast<char *>(ids[i].id), sizeof(ids[i].id))) {
 			err = -errno;
 			dnet_log_err(n, "failed to write id into ids file '%s'", file);
 			goto err_out_unlink;
@@ -55,7 +137,8 @@ err_out_exit:
 	return err;
 }
 
-static struct dnet_raw_id *dnet_ids_init(struct dnet_node *n, const char *hdir, int *id_num, unsigned long long storage_free, struct dnet_addr *cfg_addrs, size_t backend_id)
+static struct dnet_raw_id *dnet_ids_init(struct dnet_node *n, const char *hdir, int *id_num, unsigned long long storage_free,
+		struct dnet_addr *cfg_addrs, size_t backend_id, int group_id)
 {
 	int fd, err, num;
 	const char *file = "ids";
@@ -73,7 +156,7 @@ again:
 			if (n->flags & DNET_CFG_KEEPS_IDS_IN_CLUSTER)
 				err = dnet_ids_update(n, 1, path, cfg_addrs, backend_id);
 			if (err)
-				err = dnet_ids_generate(n, path, storage_free);
+				err = dnet_ids_generate(n, path, storage_free, group_id);
 
 			if (err)
 				goto err_out_exit;
@@ -145,10 +228,87 @@ static const char *elapsed(const dnet_time &start)
 	return buffer;
 }
 
+static int dnet_set_affinity(pthread_t tid, const std::vector<int> &cpus)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	for (auto it = cpus.begin(); it != cpus.end(); ++it)
+		CPU_SET(*it, &set);
+
+	return -pthread_setaffinity_np(tid, sizeof(set), &set);
+}
+
+int dnet_thread_bind(struct dnet_node *node, pthread_t tid, int pool, ssize_t backend_id)
+{
+	if (!node->config_data)
+		return 0;
+
+	const auto &data = *static_cast<ioremap::elliptics::config::config_data *>(node->config_data);
+	const auto &backends = data.backends->backends;
+	const std::vector<int> *cpus = &data.io_thread_cpus;
+
+	if (pool == DNET_THREAD_POOL_NET) {
+		cpus = &data.net_thread_cpus;
+	} else if (backend_id >= 0 && static_cast<size_t>(backend_id) < backends.size()) {
+		if (!backends[backend_id].cpus.empty())
+			cpus = &backends[backend_id].cpus;
+	}
+
+	if (cpus->empty())
+		return 0;
+
+	int err = dnet_set_affinity(tid, *cpus);
+	if (err) {
+		dnet_log(node, DNET_LOG_ERROR, "failed to bind %s thread of backend: %zd to %zu cpus: %s [%d]",
+			pool == DNET_THREAD_POOL_NET ? "net" : "io", backend_id, cpus->size(), strerror(-err), err);
+	}
+
+	return err;
+}
+
+/*
+ * Binds calling thread to backend's CPUs while backend is being initialized,
+ * so backend's structures and cache are allocated from memory of its NUMA node
+ * and threads started by the backend inherit its CPUs
+ */
+class backend_init_affinity
+{
+public:
+	backend_init_affinity() : m_bound(false)
+	{
+	}
+
+	~backend_init_affinity()
+	{
+		if (m_bound)
+			pthread_setaffinity_np(pthread_self(), sizeof(m_previous), &m_previous);
+	}
+
+	void bind(const std::vector<int> &cpus)
+	{
+		if (cpus.empty() || m_bound)
+			return;
+
+		if (pthread_getaffinity_np(pthread_self(), sizeof(m_previous), &m_previous))
+			return;
+
+		m_bound = (dnet_set_affinity(pthread_self(), cpus) == 0);
+	}
+
+private:
+	backend_init_affinity(const backend_init_affinity &) = delete;
+	backend_init_affinity &operator =(const backend_init_affinity &) = delete;
+
+	bool m_bound;
+	cpu_set_t m_previous;
+};
+
 int dnet_backend_init(struct dnet_node *node, size_t backend_id, unsigned *state)
 {
 	int ids_num;
 	struct dnet_raw_id *ids;
+	backend_init_affinity affinity;
 
 	auto &backends = node->config_data->backends->backends;
 	if (backends.size() <= backend_id) {
@@ -218,10 +378,13 @@ int dnet_backend_init(struct dnet_node *node, size_t backend_id, unsigned *state
 		goto err_out_exit;
 	}
 
+	affinity.bind(backend.cpus);
+
 	backend.config = backend.config_template;
 	backend.data.assign(backend.data.size(), '\0');
 	backend.config.data = backend.data.data();
 	backend.config.log = backend.log.get();
+	backend.config.node = node;
 
 	backend_io = &node->io->backends[backend_id];
 	backend_io->need_exit = 0;
@@ -262,7 +425,7 @@ int dnet_backend_init(struct dnet_node *node, size_t backend_id, unsigned *state
 	}
 
 	ids_num = 0;
-	ids = dnet_ids_init(node, backend.history.c_str(), &ids_num, backend.config.storage_free, node->addrs, backend_id);
+	ids = dnet_ids_init(node, backend.history.c_str(), &ids_num, backend.config.storage_free, node->addrs, backend_id, backend.group);
 	err = dnet_route_list_enable_backend(node->route, backend_id, backend.group, ids, ids_num);
 	free(ids);
 
@@ -334,12 +497,22 @@ int dnet_backend_cleanup(struct dnet_node *node, size_t backend_id, unsigned *st
 	if (backend_io)
 		backend_io->need_exit = 1;
 
+	dnet_defrag_scheduler_remove(node->defrag, backend_id);
+
+	/* migration writes through backend's io pool, so it is stopped first */
+	if (backend_io && backend_io->migration)
+		reinterpret_cast<dnet_backend_migration *>(backend_io->migration)->stop();
+
 	if (node->route)
 		dnet_route_list_disable_backend(node->route, backend_id);
 
-	if (backend_io)
+	if (backend_io) {
 		dnet_backend_io_cleanup(node, backend_io);
 
+		delete reinterpret_cast<dnet_backend_migration *>(backend_io->migration);
+		backend_io->migration = NULL;
+	}
+
 	dnet_cache_cleanup(backend.cache);
 	if (backend_io)
 		backend_io->cb = NULL;
@@ -494,6 +667,37 @@ static int dnet_backend_set_ids(dnet_node *node, uint32_t backend_id, dnet_raw_i
 	return err;
 }
 
+/*
+ * Sets new ids of the backend and starts migration of key ranges which it receives with them.
+ * Disabled backend does not own any keys, so its ids are only set.
+ */
+static int dnet_backend_migrate_ids(dnet_node *node, uint32_t backend_id, dnet_raw_id *ids, uint32_t ids_count)
+{
+	auto &backends = node->config_data->backends->backends;
+	if (backend_id >= backends.size()) {
+		return -EINVAL;
+	}
+
+	dnet_backend_info &backend = backends[backend_id];
+	dnet_backend_io &io = node->io->backends[backend_id];
+
+	const std::vector<dnet_ring_entry> old_ring = dnet_group_ring(node, backend.group);
+
+	int err = dnet_backend_set_ids(node, backend_id, ids, ids_count);
+	if (err)
+		return err;
+
+	std::lock_guard<std::mutex> guard(*backend.state_mutex);
+	if (backend.state != DNET_BACKEND_ENABLED)
+		return 0;
+
+	if (!io.migration)
+		io.migration = new dnet_backend_migration(node, backend_id, backend.group, backend.migration_rate);
+
+	reinterpret_cast<dnet_backend_migration *>(io.migration)->start(old_ring, dnet_group_ring(node, backend.group));
+	return 0;
+}
+
 void backend_fill_status_nolock(struct dnet_node *node, struct dnet_backend_status *status, size_t backend_id)
 {
 	if (!status)
@@ -558,15 +762,20 @@ static int dnet_cmd_backend_control_dangerous(struct dnet_net_state *st, struct
 		err = dnet_backend_cleanup(node, control->backend_id, &state);
 		break;
 	case DNET_BACKEND_START_DEFRAG:
-		if (cb.defrag_start) {
-			err = cb.defrag_start(cb.command_private);
-		} else {
+		if (!cb.defrag_start) {
 			err = -ENOTSUP;
+		} else if (backend.defrag_config) {
+			err = dnet_defrag_scheduler_add(node->defrag, control->backend_id);
+		} else {
+			err = cb.defrag_start(cb.command_private);
 		}
 		break;
 	case DNET_BACKEND_SET_IDS:
 		err = dnet_backend_set_ids(st->n, control->backend_id, control->ids, control->ids_count);
 		break;
+	case DNET_BACKEND_MIGRATE_IDS:
+		err = dnet_backend_migrate_ids(st->n, control->backend_id, control->ids, control->ids_count);
+		break;
 	case DNET_BACKEND_READ_ONLY:
 		if (io.read_only) {
 			err = -EALREADY;
@@ -709,6 +918,14 @@ void dnet_backend_info::parse(ioremap::elliptics::config::config_data *data, con
 
 	io_thread_num = backend.at("io_thread_num", data->cfg_state.io_thread_num);
 	nonblocking_io_thread_num = backend.at("nonblocking_io_thread_num", data->cfg_state.nonblocking_io_thread_num);
+	cpus = ioremap::elliptics::config::parse_cpus(backend, "");
+	migration_rate = backend.at<uint64_t>("migration_rate", 64 * 1024 * 1024);
+
+	if (backend.has("defrag")) {
+		defrag_config = dnet_defrag_config::parse(backend.at("defrag"), backend.at<uint32_t>("backend_id"));
+	} else {
+		defrag_config.reset();
+	}
 
 	for (int i = 0; i < config.num; ++i) {
 		dnet_config_entry &entry = config.ent[i];
@@ -3,6 +3,9 @@
 
 #include <elliptics/backends.h>
 
+#include <pthread.h>
+#include <sys/types.h>
+
 #ifdef __cplusplus
 
 #include <string>
@@ -31,6 +34,53 @@ struct cache_config
 
 }}
 
+namespace ioremap { namespace monitor {
+
+struct monitor_config
+{
+	/* How long generated reports are reused for the same categories, in milliseconds, 0 disables caching */
+	unsigned		report_cache_lifetime;
+	/* Number of the most requested keys tracked per backend and command, 0 disables tracking */
+	size_t			hot_keys_top;
+	/* Number of counters in each row of hot keys count-min sketch */
+	size_t			hot_keys_sketch_width;
+	/* Period of hot keys statistics collection, in milliseconds */
+	unsigned		hot_keys_window;
+	/* Number of the last slow or sampled requests kept in monitor, 0 disables capturing */
+	size_t			slow_requests_size;
+	/* Requests which took at least this time are captured, in milliseconds, 0 captures only sampled requests */
+	unsigned		slow_request_threshold;
+	/* Part of all requests which are captured regardless of their latency */
+	double			slow_request_sample_rate;
+	/* Number of threads which serve monitor HTTP requests */
+	size_t			server_threads;
+	/* Maximum number of simultaneously served monitor connections, the others get 503 reply */
+	size_t			server_max_connections;
+	/* Monitor connection is closed if it has not made any progress during this time, in milliseconds */
+	unsigned		server_timeout;
+
+	static std::unique_ptr<monitor_config> parse(const ioremap::elliptics::config::config &monitor);
+};
+
+}}
+
+/*
+ * Scheduling of backend's defragmentation, backends without it are defragmented right on request
+ */
+struct dnet_defrag_config
+{
+	/* backends placed on the same disk are defragmented one by one and share its bandwidth */
+	std::string		disk;
+	/* average speed of defragmentation IO of the disk, in bytes per second, 0 means unlimited */
+	uint64_t		bandwidth;
+	/* defragmentation is postponed while more requests wait in backend's io queues */
+	size_t			max_queue_size;
+	/* defragmentation is postponed while average request time of the backend is higher, in milliseconds, 0 disables the check */
+	unsigned		max_latency;
+
+	static std::unique_ptr<dnet_defrag_config> parse(const ioremap::elliptics::config::config &defrag, uint32_t backend_id);
+};
+
 /**
  * This structure holds config value read from config file
  * @entry.key contains config key, @value_template holds value for given key
@@ -60,7 +110,7 @@ struct dnet_backend_info
 		log(new dnet_logger(logger, make_attributes(backend_id))),
 		group(0), cache(NULL), enable_at_start(false),
 		state_mutex(new std::mutex), state(DNET_BACKEND_DISABLED),
-		io_thread_num(0), nonblocking_io_thread_num(0)
+		io_thread_num(0), nonblocking_io_thread_num(0), migration_rate(0)
 	{
 		dnet_empty_time(&last_start);
 		last_start_err = 0;
@@ -85,7 +135,10 @@ struct dnet_backend_info
 		data(std::move(other.data)),
 		cache_config(std::move(other.cache_config)),
 		io_thread_num(other.io_thread_num),
-		nonblocking_io_thread_num(other.nonblocking_io_thread_num)
+		nonblocking_io_thread_num(other.nonblocking_io_thread_num),
+		cpus(std::move(other.cpus)),
+		migration_rate(other.migration_rate),
+		defrag_config(std::move(other.defrag_config))
 	{
 	}
 
@@ -107,6 +160,9 @@ struct dnet_backend_info
 		cache_config = std::move(other.cache_config);
 		io_thread_num = other.io_thread_num;
 		nonblocking_io_thread_num = other.nonblocking_io_thread_num;
+		cpus = std::move(other.cpus);
+		migration_rate = other.migration_rate;
+		defrag_config = std::move(other.defrag_config);
 
 		return *this;
 	}
@@ -132,6 +188,11 @@ struct dnet_backend_info
 	std::unique_ptr<ioremap::cache::cache_config> cache_config;
 	int io_thread_num;
 	int nonblocking_io_thread_num;
+	/* CPUs which backend's io and cache threads are bound to, node's io_thread_cpus are used if it is empty */
+	std::vector<int> cpus;
+	/* Maximum speed of copying data of key ranges received with new ids, in bytes per second, 0 means unlimited */
+	uint64_t migration_rate;
+	std::unique_ptr<dnet_defrag_config> defrag_config;
 };
 
 struct dnet_backend_info_list
@@ -165,6 +226,18 @@ void backend_fill_status_nolock(struct dnet_node *node, struct dnet_backend_stat
  */
 void backend_fill_status(struct dnet_node *node, struct dnet_backend_status *status, size_t backend_id);
 
+enum dnet_thread_pool {
+	DNET_THREAD_POOL_NET = 0,
+	DNET_THREAD_POOL_IO,
+};
+
+/*
+ * Binds thread \a tid of \a pool to CPUs configured for it,
+ * \a backend_id is -1 for threads which do not belong to any backend.
+ * Defined by server library only, so client library checks whether it is present.
+ */
+int __attribute__((weak)) dnet_thread_bind(struct dnet_node *node, pthread_t tid, int pool, ssize_t backend_id);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -0,0 +1,373 @@
+/*
+ * Copyright 2008+ Evgeniy Polyakov <zbr@ioremap.net>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Coalescing of identical reads.
+ *
+ * The first read of the key (leader) registers a flight before it takes the key lock.
+ * Identical reads (same backend, key, command flags, offset, size and io flags) which arrive
+ * while the flight is open are not executed, they are attached to the flight as waiters and
+ * io thread moves on. When leader sends its read reply, the flight is closed and the same reply
+ * (with waiter's transaction) is queued to every waiter: data is read and checksummed only once.
+ *
+ * Flight is closed at the latest before the leader releases the key lock, so a write which is
+ * acknowledged before a read has been sent is always visible to that read.
+ */
+
+#include <sys/types.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "elliptics.h"
+
+#include "elliptics/packet.h"
+#include "elliptics/interface.h"
+
+struct dnet_read_waiter {
+	struct list_head	entry;
+	struct dnet_net_state	*st;
+	struct dnet_cmd		cmd;
+	/* io attributes as they were received, in network byte order */
+	struct dnet_io_attr	io;
+	/* copy of the leader's reply has been queued */
+	int			served;
+	/* queued reply was not the final one, transaction is completed by ack */
+	int			more;
+};
+
+struct dnet_read_flight {
+	struct rb_node		flight_entry;
+	struct dnet_backend_io	*backend;
+	struct dnet_net_state	*st;
+	/* command being executed by the leader and the copy of its header taken before execution */
+	struct dnet_cmd		*cmd;
+	struct dnet_cmd		orig;
+	struct dnet_io_attr	io;
+	struct list_head	waiters;
+	/* flight is in the node's tree and accepts new waiters */
+	int			open;
+	/* result of the leader's command */
+	int			err;
+};
+
+/* flight led by the command which is being executed by this thread */
+static __thread struct dnet_read_flight *dnet_read_flight_current;
+
+#define dnet_read_flight_cmp_field(a, b)	\
+	do {					\
+		if ((a) < (b))			\
+			return -1;		\
+		if ((a) > (b))			\
+			return 1;		\
+	} while (0)
+
+/*
+ * Orders flights by the attributes identical reads share,
+ * key goes first, so reads of different keys never compare the rest.
+ */
+static int dnet_read_flight_cmp(const struct dnet_read_flight *flight, const struct dnet_backend_io *backend,
+		const struct dnet_cmd *cmd, const struct dnet_io_attr *io)
+{
+	int cmp;
+
+	cmp = dnet_id_cmp(&flight->orig.id, &cmd->id);
+	if (cmp)
+		return cmp;
+
+	dnet_read_flight_cmp_field(flight->orig.id.group_id, cmd->id.group_id);
+	dnet_read_flight_cmp_field((uintptr_t)flight->backend, (uintptr_t)backend);
+	dnet_read_flight_cmp_field(flight->orig.flags & ~DNET_FLAGS_TRACE_BIT, cmd->flags & ~DNET_FLAGS_TRACE_BIT);
+
+	cmp = memcmp(flight->io.id, io->id, DNET_ID_SIZE);
+	if (cmp)
+		return cmp;
+
+	dnet_read_flight_cmp_field(flight->io.flags, io->flags);
+	dnet_read_flight_cmp_field(flight->io.offset, io->offset);
+	dnet_read_flight_cmp_field(flight->io.size, io->size);
+
+	return 0;
+}
+
+static struct dnet_read_flight *dnet_read_flight_search_nolock(struct dnet_node *n, struct dnet_backend_io *backend,
+		struct dnet_cmd *cmd, struct dnet_io_attr *io)
+{
+	struct rb_node *node = n->locks->read_flight_tree.rb_node;
+	struct dnet_read_flight *flight;
+	int cmp;
+
+	while (node) {
+		flight = rb_entry(node, struct dnet_read_flight, flight_entry);
+
+		cmp = dnet_read_flight_cmp(flight, backend, cmd, io);
+		if (cmp < 0)
+			node = node->rb_left;
+		else if (cmp > 0)
+			node = node->rb_right;
+		else
+			return flight;
+	}
+
+	return NULL;
+}
+
+/* only one flight with given attributes is open at a time, since identical reads join it */
+static void dnet_read_flight_insert_nolock(struct dnet_node *n, struct dnet_read_flight *a)
+{
+	struct rb_root *root = &n->locks->read_flight_tree;
+	struct rb_node **node = &root->rb_node, *parent = NULL;
+	struct dnet_read_flight *t;
+
+	while (*node) {
+		parent = *node;
+
+		t = rb_entry(parent, struct dnet_read_flight, flight_entry);
+
+		if (dnet_read_flight_cmp(t, a->backend, &a->orig, &a->io) < 0)
+			node = &parent->rb_left;
+		else
+			node = &parent->rb_right;
+	}
+
+	rb_link_node(&a->flight_entry, parent, node);
+	rb_insert_color(&a->flight_entry, root);
+}
+
+int dnet_read_flight_join(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data,
+		struct dnet_read_flight **leader)
+{
+	struct dnet_node *n = st->n;
+	struct dnet_read_flight *flight;
+	struct dnet_read_waiter *w;
+	struct dnet_io_attr io;
+
+	*leader = NULL;
+
+	if (!n->coalesce_reads || !n->locks || !backend || cmd->cmd != DNET_CMD_READ ||
+			(cmd->flags & (DNET_FLAGS_NOLOCK | DNET_FLAGS_REPLY)) || cmd->size != sizeof(struct dnet_io_attr))
+		return 0;
+
+	memcpy(&io, data, sizeof(struct dnet_io_attr));
+	dnet_convert_io_attr(&io);
+
+	if (io.flags & DNET_IO_FLAGS_SKIP_SENDING)
+		return 0;
+
+	pthread_mutex_lock(&n->locks->read_flight_lock);
+
+	flight = dnet_read_flight_search_nolock(n, backend, cmd, &io);
+	if (flight) {
+		/* read which can not wait for the flight is executed on its own */
+		w = malloc(sizeof(struct dnet_read_waiter));
+		if (!w)
+			goto err_out_unlock;
+
+		w->st = dnet_state_get(st);
+		w->cmd = *cmd;
+		memcpy(&w->io, data, sizeof(struct dnet_io_attr));
+		w->served = 0;
+		w->more = 0;
+
+		list_add_tail(&w->entry, &flight->waiters);
+		pthread_mutex_unlock(&n->locks->read_flight_lock);
+
+		dnet_log(n, DNET_LOG_NOTICE, "%s: %s: client: %s, trans: %llu, coalesced with read of trans: %llu",
+				dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), dnet_state_dump_addr(st),
+				(unsigned long long)cmd->trans, (unsigned long long)flight->orig.trans);
+		return 1;
+	}
+
+	flight = malloc(sizeof(struct dnet_read_flight));
+	if (flight) {
+		flight->backend = backend;
+		flight->st = st;
+		flight->cmd = cmd;
+		flight->orig = *cmd;
+		flight->io = io;
+		flight->open = 1;
+		flight->err = 0;
+		INIT_LIST_HEAD(&flight->waiters);
+
+		dnet_read_flight_insert_nolock(n, flight);
+	}
+
+	pthread_mutex_unlock(&n->locks->read_flight_lock);
+
+	*leader = dnet_read_flight_current = flight;
+	return 0;
+
+err_out_unlock:
+	pthread_mutex_unlock(&n->locks->read_flight_lock);
+	return 0;
+}
+
+void dnet_read_flight_close(struct dnet_node *n, struct dnet_read_flight *flight)
+{
+	pthread_mutex_lock(&n->locks->read_flight_lock);
+	if (flight->open) {
+		rb_erase(&flight->flight_entry, &n->locks->read_flight_tree);
+		flight->open = 0;
+	}
+	pthread_mutex_unlock(&n->locks->read_flight_lock);
+
+	if (dnet_read_flight_current == flight)
+		dnet_read_flight_current = NULL;
+}
+
+/*
+ * Reply is already in network byte order, only transaction and flags of the waiter differ.
+ * File descriptor is duplicated, since every queued reply closes its own one.
+ */
+static void dnet_read_waiter_send(struct dnet_read_waiter *w, const struct dnet_cmd *reply, uint64_t hsize,
+		void *data, int fd, uint64_t offset, uint64_t size, int on_exit)
+{
+	struct dnet_cmd *c;
+	uint64_t flags;
+	int wfd, err;
+
+	c = malloc(hsize);
+	if (!c)
+		return;
+
+	memcpy(c, reply, hsize);
+
+	w->more = !!(dnet_bswap64(reply->flags) & DNET_FLAGS_MORE);
+	flags = (w->cmd.flags & ~DNET_FLAGS_NEED_ACK) | DNET_FLAGS_REPLY | (w->more ? DNET_FLAGS_MORE : 0);
+
+	c->flags = dnet_bswap64(flags);
+	c->trans = dnet_bswap64(w->cmd.trans);
+
+	if (data) {
+		err = dnet_send_data(w->st, c, hsize, data, size);
+	} else {
+		wfd = dup(fd);
+		if (wfd < 0) {
+			err = -errno;
+			goto err_out_free;
+		}
+
+		err = dnet_send_fd(w->st, c, hsize, wfd, offset, size,
+				DNET_IO_REQ_FLAGS_CLOSE | (on_exit & DNET_IO_REQ_FLAGS_CACHE_FORGET));
+		if (err)
+			close(wfd);
+	}
+
+	if (!err)
+		w->served = 1;
+
+err_out_free:
+	free(c);
+}
+
+void dnet_read_flight_reply(struct dnet_net_state *st, struct dnet_cmd *cmd, const struct dnet_cmd *reply, uint64_t hsize,
+		void *data, int fd, uint64_t offset, uint64_t size, int on_exit)
+{
+	struct dnet_read_flight *flight = dnet_read_flight_current;
+	struct dnet_read_waiter *w;
+
+	if (!flight || flight->st != st || flight->cmd != cmd)
+		return;
+
+	/* waiters attached from now on would not get this reply */
+	dnet_read_flight_close(st->n, flight);
+
+	list_for_each_entry(w, &flight->waiters, entry) {
+		dnet_read_waiter_send(w, reply, hsize, data, fd, offset, size, on_exit);
+	}
+}
+
+void dnet_read_flight_status(struct dnet_net_state *st, struct dnet_cmd *cmd, int err)
+{
+	struct dnet_read_flight *flight = dnet_read_flight_current;
+
+	if (flight && flight->st == st && flight->cmd == cmd)
+		flight->err = err;
+}
+
+/*
+ * Waiter is scheduled to io pool as if it was just received,
+ * so leader's thread does not execute reads of all waiters one by one.
+ */
+static int dnet_read_waiter_schedule(struct dnet_node *n, struct dnet_read_waiter *w)
+{
+	struct dnet_io_req *r;
+
+	r = malloc(sizeof(struct dnet_io_req) + sizeof(struct dnet_cmd) + sizeof(struct dnet_io_attr));
+	if (!r)
+		return -ENOMEM;
+	memset(r, 0, sizeof(struct dnet_io_req));
+
+	r->header = r + 1;
+	r->hsize = sizeof(struct dnet_cmd);
+	memcpy(r->header, &w->cmd, sizeof(struct dnet_cmd));
+
+	r->data = r->header + sizeof(struct dnet_cmd);
+	r->dsize = sizeof(struct dnet_io_attr);
+	memcpy(r->data, &w->io, sizeof(struct dnet_io_attr));
+
+	r->st = dnet_state_get(w->st);
+	r->time.recv_start = r->time.recv_finish = dnet_time_monotonic_us();
+
+	dnet_schedule_io(n, r);
+	return 0;
+}
+
+void dnet_read_flight_complete(struct dnet_node *n, struct dnet_read_flight *flight)
+{
+	struct dnet_read_waiter *w, *tmp;
+	int served = 0, failed = 0, executed = 0, err;
+
+	list_for_each_entry_safe(w, tmp, &flight->waiters, entry) {
+		list_del(&w->entry);
+
+		if (w->served) {
+			++served;
+			if (w->more) {
+				w->cmd.flags |= DNET_FLAGS_NEED_ACK;
+				dnet_send_ack(w->st, &w->cmd, flight->err, 0);
+			}
+		} else if (flight->err) {
+			++failed;
+			w->cmd.flags |= DNET_FLAGS_NEED_ACK;
+			dnet_send_ack(w->st, &w->cmd, flight->err, 0);
+		} else {
+			/* leader has not sent read reply itself (for example it was proxied), so waiter is executed on its own */
+			++executed;
+			err = dnet_read_waiter_schedule(n, w);
+			if (err) {
+				w->cmd.flags |= DNET_FLAGS_NEED_ACK;
+				dnet_send_ack(w->st, &w->cmd, err, 0);
+			}
+		}
+
+		dnet_state_put(w->st);
+		free(w);
+	}
+
+	if (served || failed || executed) {
+		dnet_log(n, DNET_LOG_INFO, "%s: %s: coalesced reads: served: %d, failed: %d, scheduled separately: %d, err: %d",
+				dnet_dump_id(&flight->orig.id), dnet_cmd_string(flight->orig.cmd), served, failed, executed, flight->err);
+	}
+
+	free(flight);
+}
@@ -0,0 +1,311 @@
+#include "defrag.h"
+#include "elliptics.h"
+#include "../example/config.hpp"
+
+#include "rapidjson/document.h"
+
+#include <algorithm>
+
+/* postponed defragmentation is retried after this time, which is doubled on every next postpone */
+static const std::chrono::seconds dnet_defrag_backoff_min(10);
+static const std::chrono::seconds dnet_defrag_backoff_max(600);
+/* average request time of the backend which has not served requests for this time is not taken into account */
+static const uint64_t dnet_defrag_request_time_lifetime = 10 * 1000000;
+
+std::unique_ptr<dnet_defrag_config> dnet_defrag_config::parse(const ioremap::elliptics::config::config &defrag, uint32_t backend_id)
+{
+	dnet_defrag_config config;
+	config.disk = defrag.at("disk", "backend_" + std::to_string(backend_id));
+	config.bandwidth = defrag.at<uint64_t>("bandwidth", 0);
+	config.max_queue_size = defrag.at<size_t>("max_queue_size", 16);
+	config.max_latency = defrag.at<unsigned>("max_latency", 100);
+	return blackhole::utils::make_unique<dnet_defrag_config>(config);
+}
+
+/*
+ * Defragmentation rewrites the whole data of the backend in the worst case,
+ * its size is taken from backend's storage statistics
+ */
+static uint64_t dnet_defrag_estimate_size(const dnet_backend_callbacks &cb)
+{
+	char *json_stat = NULL;
+	size_t size = 0;
+	uint64_t base_size = 0;
+
+	if (!cb.storage_stat_json || cb.storage_stat_json(cb.command_private, &json_stat, &size) || !json_stat || !size) {
+		free(json_stat);
+		return 0;
+	}
+
+	rapidjson::Document stat;
+	stat.Parse<0>(json_stat);
+
+	if (!stat.HasParseError() && stat.IsObject() && stat.HasMember("summary_stats")) {
+		const rapidjson::Value &summary = stat["summary_stats"];
+		if (summary.IsObject() && summary.HasMember("base_size") && summary["base_size"].IsUint64())
+			base_size = summary["base_size"].GetUint64();
+	}
+
+	free(json_stat);
+	return base_size;
+}
+
+dnet_defrag_scheduler::dnet_defrag_scheduler(dnet_node *node, size_t concurrency)
+: m_node(node)
+, m_concurrency(concurrency ? concurrency : 1)
+, m_need_exit(false)
+{
+	m_thread = std::thread(&dnet_defrag_scheduler::run, this);
+}
+
+dnet_defrag_scheduler::~dnet_defrag_scheduler()
+{
+	{
+		std::unique_lock<std::mutex> guard(m_lock);
+		m_need_exit = true;
+	}
+	m_wait.notify_all();
+
+	m_thread.join();
+}
+
+int dnet_defrag_scheduler::schedule(size_t backend_id)
+{
+	auto &backends = m_node->config_data->backends->backends;
+	if (backend_id >= backends.size())
+		return -EINVAL;
+
+	dnet_backend_info &backend = backends[backend_id];
+
+	task t;
+	t.backend_id = backend_id;
+	t.running = false;
+	t.not_before = clock::now();
+	t.backoff = dnet_defrag_backoff_min;
+	t.size = 0;
+
+	{
+		std::lock_guard<std::mutex> guard(*backend.state_mutex);
+		if (backend.state != DNET_BACKEND_ENABLED || !backend.defrag_config)
+			return -EINVAL;
+
+		t.disk = backend.defrag_config->disk;
+		t.bandwidth = backend.defrag_config->bandwidth;
+		t.max_queue_size = backend.defrag_config->max_queue_size;
+		t.max_latency = backend.defrag_config->max_latency;
+	}
+
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	auto it = std::find_if(m_tasks.begin(), m_tasks.end(), [backend_id] (const task &other) {
+		return other.backend_id == backend_id;
+	});
+	if (it != m_tasks.end())
+		return -EALREADY;
+
+	m_tasks.push_back(t);
+	m_wait.notify_all();
+
+	dnet_log(m_node, DNET_LOG_INFO, "defrag: backend: %zu, defragmentation is queued, disk: %s, queued: %zu",
+		backend_id, t.disk.c_str(), m_tasks.size());
+	return 0;
+}
+
+void dnet_defrag_scheduler::cancel(size_t backend_id)
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	m_tasks.erase(std::remove_if(m_tasks.begin(), m_tasks.end(), [backend_id] (const task &t) {
+		return t.backend_id == backend_id;
+	}), m_tasks.end());
+}
+
+/*
+ * Returns false if defragmentation of the backend is over
+ */
+bool dnet_defrag_scheduler::check_running(task &t, clock::time_point now)
+{
+	dnet_backend_info &backend = m_node->config_data->backends->backends[t.backend_id];
+	int status = DNET_BACKEND_DEFRAG_NOT_STARTED;
+
+	{
+		std::lock_guard<std::mutex> guard(*backend.state_mutex);
+		if (backend.state != DNET_BACKEND_ENABLED)
+			return false;
+
+		const dnet_backend_callbacks &cb = backend.config.cb;
+		if (cb.defrag_status)
+			status = cb.defrag_status(cb.command_private);
+	}
+
+	if (status == DNET_BACKEND_DEFRAG_IN_PROGRESS)
+		return true;
+
+	auto budget = clock::duration::zero();
+	if (t.bandwidth) {
+		budget = std::chrono::duration_cast<clock::duration>(std::chrono::microseconds(t.size / t.bandwidth * 1000000 +
+			t.size % t.bandwidth * 1000000 / t.bandwidth));
+		m_disk_ready[t.disk] = t.started + budget;
+	}
+
+	dnet_log(m_node, DNET_LOG_INFO, "defrag: backend: %zu, defragmentation is completed, disk: %s, "
+			"estimated size: %llu, elapsed: %lld sec, disk is not defragmented for %lld sec",
+		t.backend_id, t.disk.c_str(), (unsigned long long)t.size,
+		(long long)std::chrono::duration_cast<std::chrono::seconds>(now - t.started).count(),
+		(long long)std::chrono::duration_cast<std::chrono::seconds>(std::max(t.started + budget - now, clock::duration::zero())).count());
+	return false;
+}
+
+/*
+ * Disk is defragmented by one backend at a time and only after the previous defragmentation fits into its bandwidth
+ */
+bool dnet_defrag_scheduler::can_start(const task &t, clock::time_point now)
+{
+	if (now < t.not_before)
+		return false;
+
+	for (auto it = m_tasks.begin(); it != m_tasks.end(); ++it) {
+		if (it->running && it->disk == t.disk)
+			return false;
+	}
+
+	auto ready = m_disk_ready.find(t.disk);
+	return ready == m_disk_ready.end() || ready->second <= now;
+}
+
+bool dnet_defrag_scheduler::overloaded(const task &t)
+{
+	dnet_backend_io *io = dnet_backend_io_get(m_node, t.backend_id);
+	if (!io)
+		return false;
+
+	const uint64_t queue_size = dnet_backend_io_queue_size(io);
+	uint64_t request_time = io->request_time_avg;
+	if (dnet_time_monotonic_us() > io->request_time_update + dnet_defrag_request_time_lifetime)
+		request_time = 0;
+
+	dnet_backend_io_put(io);
+
+	if (queue_size <= t.max_queue_size && (!t.max_latency || request_time <= t.max_latency * 1000ULL))
+		return false;
+
+	dnet_log(m_node, DNET_LOG_NOTICE, "defrag: backend: %zu, defragmentation is postponed for %lld sec, "
+			"io queue size: %llu, average request time: %llu usecs",
+		t.backend_id, (long long)std::chrono::duration_cast<std::chrono::seconds>(t.backoff).count(),
+		(unsigned long long)queue_size, (unsigned long long)request_time);
+	return true;
+}
+
+int dnet_defrag_scheduler::start(task &t)
+{
+	dnet_backend_info &backend = m_node->config_data->backends->backends[t.backend_id];
+	int err = -ENOTSUP;
+
+	{
+		std::lock_guard<std::mutex> guard(*backend.state_mutex);
+		if (backend.state != DNET_BACKEND_ENABLED)
+			return -EINVAL;
+
+		const dnet_backend_callbacks &cb = backend.config.cb;
+		if (cb.defrag_start) {
+			t.size = dnet_defrag_estimate_size(cb);
+
+			/* defragmentation started by the backend itself is accounted the same way */
+			if (cb.defrag_status && cb.defrag_status(cb.command_private) == DNET_BACKEND_DEFRAG_IN_PROGRESS)
+				err = 0;
+			else
+				err = cb.defrag_start(cb.command_private);
+		}
+	}
+
+	if (err) {
+		dnet_log(m_node, DNET_LOG_ERROR, "defrag: backend: %zu, failed to start defragmentation: %s [%d]",
+			t.backend_id, strerror(-err), err);
+		return err;
+	}
+
+	t.running = true;
+	t.started = clock::now();
+
+	dnet_log(m_node, DNET_LOG_INFO, "defrag: backend: %zu, defragmentation is started, disk: %s, estimated size: %llu",
+		t.backend_id, t.disk.c_str(), (unsigned long long)t.size);
+	return 0;
+}
+
+void dnet_defrag_scheduler::run()
+{
+	dnet_set_name("dnet_defrag");
+
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	while (!m_need_exit) {
+		const clock::time_point now = clock::now();
+		size_t running = 0;
+
+		for (auto it = m_tasks.begin(); it != m_tasks.end();) {
+			if (it->running && !check_running(*it, now)) {
+				it = m_tasks.erase(it);
+				continue;
+			}
+
+			running += it->running;
+			++it;
+		}
+
+		for (auto it = m_tasks.begin(); it != m_tasks.end() && running < m_concurrency;) {
+			if (it->running || !can_start(*it, now)) {
+				++it;
+				continue;
+			}
+
+			if (overloaded(*it)) {
+				it->not_before = now + it->backoff;
+				it->backoff = std::min<clock::duration>(it->backoff * 2, dnet_defrag_backoff_max);
+				++it;
+				continue;
+			}
+
+			if (start(*it)) {
+				it = m_tasks.erase(it);
+				continue;
+			}
+
+			++running;
+			++it;
+		}
+
+		m_wait.wait_for(guard, std::chrono::seconds(1));
+	}
+}
+
+dnet_defrag_scheduler *dnet_defrag_scheduler_create(struct dnet_node *node, int concurrency)
+{
+	try {
+		return new dnet_defrag_scheduler(node, concurrency > 0 ? concurrency : 1);
+	} catch (...) {
+		return NULL;
+	}
+}
+
+void dnet_defrag_scheduler_destroy(dnet_defrag_scheduler *scheduler)
+{
+	delete scheduler;
+}
+
+int dnet_defrag_scheduler_add(dnet_defrag_scheduler *scheduler, size_t backend_id)
+{
+	if (!scheduler)
+		return -ENOTSUP;
+
+	try {
+		return scheduler->schedule(backend_id);
+	} catch (std::bad_alloc &) {
+		return -ENOMEM;
+	}
+}
+
+void dnet_defrag_scheduler_remove(dnet_defrag_scheduler *scheduler, size_t backend_id)
+{
+	if (scheduler)
+		scheduler->cancel(backend_id);
+}
@@ -0,0 +1,94 @@
+#ifndef IOREMAP_ELLIPTICS_DEFRAG_H
+#define IOREMAP_ELLIPTICS_DEFRAG_H
+
+#include <elliptics/packet.h>
+#include <elliptics/interface.h>
+
+#ifdef __cplusplus
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Starts defragmentation of backends which have defrag section in their config.
+ *
+ * Backend's defragmentation is started only when its io queues and request latency are below
+ * configured limits, otherwise it is postponed with growing backoff. Backends placed on the same
+ * disk are defragmented one by one and the next defragmentation of the disk is not started until
+ * the previous one fits into disk's bandwidth budget. No more than @concurrency backends of the node
+ * are defragmented simultaneously.
+ */
+class dnet_defrag_scheduler
+{
+public:
+	dnet_defrag_scheduler(dnet_node *node, size_t concurrency);
+	~dnet_defrag_scheduler();
+
+	int schedule(size_t backend_id);
+	void cancel(size_t backend_id);
+
+private:
+	dnet_defrag_scheduler(const dnet_defrag_scheduler &) = delete;
+	dnet_defrag_scheduler &operator =(const dnet_defrag_scheduler &) = delete;
+
+	typedef std::chrono::steady_clock clock;
+
+	struct task
+	{
+		size_t			backend_id;
+		std::string		disk;
+		uint64_t		bandwidth;
+		size_t			max_queue_size;
+		unsigned		max_latency;
+		bool			running;
+		clock::time_point	not_before;
+		clock::duration		backoff;
+		clock::time_point	started;
+		/* estimated number of bytes rewritten by defragmentation */
+		uint64_t		size;
+	};
+
+	void run();
+	bool check_running(task &t, clock::time_point now);
+	bool can_start(const task &t, clock::time_point now);
+	bool overloaded(const task &t);
+	int start(task &t);
+
+	dnet_node		*m_node;
+	const size_t		m_concurrency;
+
+	std::mutex		m_lock;
+	std::condition_variable	m_wait;
+	bool			m_need_exit;
+	std::vector<task>	m_tasks;
+	/* disk can not be defragmented again until this time to keep its bandwidth budget */
+	std::map<std::string, clock::time_point> m_disk_ready;
+	std::thread		m_thread;
+};
+
+extern "C" {
+#else // __cplusplus
+typedef struct dnet_defrag_scheduler_t dnet_defrag_scheduler;
+#endif // __cplusplus
+
+dnet_defrag_scheduler *dnet_defrag_scheduler_create(struct dnet_node *node, int concurrency);
+void dnet_defrag_scheduler_destroy(dnet_defrag_scheduler *scheduler);
+
+/*
+ * Queues defragmentation of @backend_id, returns -EALREADY if it is already queued or running
+ */
+int dnet_defrag_scheduler_add(dnet_defrag_scheduler *scheduler, size_t backend_id);
+/*
+ * Forgets queued or running defragmentation of @backend_id, called when backend is being disabled
+ */
+void dnet_defrag_scheduler_remove(dnet_defrag_scheduler *scheduler, size_t backend_id);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // IOREMAP_ELLIPTICS_DEFRAG_H
@@ -33,9 +33,11 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "elliptics.h"
+#include "migration.h"
 #include "monitor/monitor.h"
 
 #include "elliptics/packet.h"
@@ -72,7 +74,7 @@ int dnet_remove_local(struct dnet_backend_io *backend, struct dnet_node *n, stru
 
 }
 
-static int dnet_cmd_route_list(struct dnet_net_state *orig, struct dnet_cmd *cmd)
+static int dnet_cmd_route_list(struct dnet_net_state *orig, struct dnet_cmd *cmd, void *data)
 {
 	// HANDY_TIMER_SCOPE("io_pool.process_cmd_route_list", dnet_get_id());
 
@@ -80,18 +82,36 @@ static int dnet_cmd_route_list(struct dnet_net_state *orig, struct dnet_cmd *cmd
 	struct dnet_net_state *st;
 	struct dnet_addr_cmd *acmd = NULL;
 	struct dnet_addr *addrs = NULL;
+	struct dnet_route_list_version *request = data, *reply;
+	uint64_t version = 0;
+	int versioned = 0;
 	size_t total_size;
 	size_t states_num = 0;
 	int err;
 
+	if (cmd->size >= sizeof(struct dnet_route_list_version)) {
+		dnet_convert_route_list_version(request);
+		version = request->version;
+		versioned = 1;
+	}
+
 	pthread_mutex_lock(&n->state_lock);
+
+	/* requester knows newer version than we have, it can't be trusted, send the whole route list */
+	if (version > n->route_version)
+		version = 0;
+
 	list_for_each_entry(st, &n->dht_state_list, node_entry) {
 		if (dnet_addr_equal(&st->addr, &orig->addr) || !st->addrs)
 			continue;
+		if (version && st->route_version <= version)
+			continue;
 		++states_num;
 	}
 
 	total_size = sizeof(struct dnet_addr_cmd) + states_num * n->addr_num * sizeof(struct dnet_addr);
+	if (versioned)
+		total_size += sizeof(struct dnet_route_list_version);
 	acmd = malloc(total_size);
 
 	if (!acmd) {
@@ -111,7 +131,8 @@ static int dnet_cmd_route_list(struct dnet_net_state *orig, struct dnet_cmd *cmd
 	dnet_server_convert_dnet_addr_raw(&orig->addr, orig_addr_str, dump_size);
 
 	list_for_each_entry(st, &n->dht_state_list, node_entry) {
-		int skip = dnet_addr_equal(&st->addr, &orig->addr) || !st->addrs;
+		int skip = dnet_addr_equal(&st->addr, &orig->addr) || !st->addrs ||
+			(version && st->route_version <= version);
 
 		if (!st->addrs)
 			snprintf(first_addr_str, sizeof(first_addr_str), "no-address");
@@ -138,7 +159,17 @@ static int dnet_cmd_route_list(struct dnet_net_state *orig, struct dnet_cmd *cmd
 		memcpy(addrs, st->addrs, n->addr_num * sizeof(struct dnet_addr));
 		addrs += n->addr_num;
 	}
+
+	if (versioned) {
+		reply = (struct dnet_route_list_version *)addrs;
+		reply->version = n->route_version;
+		dnet_convert_route_list_version(reply);
+	}
 	pthread_mutex_unlock(&n->state_lock);
+
+	dnet_log(n, DNET_LOG_INFO, "route-list: request-from: %s, known version: %llu, sent states: %zu",
+			orig_addr_str, (unsigned long long)version, states_num);
+
 	memcpy(&acmd->cmd.id, &cmd->id, sizeof(struct dnet_id));
 	acmd->cmd.size = total_size - sizeof(struct dnet_cmd);
 
@@ -285,44 +316,55 @@ int dnet_send_ack(struct dnet_net_state *st, struct dnet_cmd *cmd, int err, int
 	return err;
 }
 
-int dnet_send_reply(void *state, struct dnet_cmd *cmd, const void *odata, unsigned int size, int more)
+/*
+ * Sends reply which consists of \a header and \a data placed into different buffers.
+ * Header (which is usually small) is glued with reply command,
+ * while data is referenced by send request as is, so it is copied only once into send queue.
+ */
+int dnet_send_reply_data(void *state, struct dnet_cmd *cmd, const void *header, unsigned int hsize,
+		const void *data, unsigned int dsize, int more)
 {
 	struct dnet_net_state *st = state;
-	struct dnet_cmd *c;
-	void *data;
+	struct dnet_cmd *c, reply;
 	int err;
 
-	c = malloc(sizeof(struct dnet_cmd) + size);
-	if (!c)
-		return -ENOMEM;
+	c = &reply;
+	if (hsize) {
+		c = malloc(sizeof(struct dnet_cmd) + hsize);
+		if (!c)
+			return -ENOMEM;
 
-	memset(c, 0, sizeof(struct dnet_cmd) + size);
+		memcpy(c + 1, header, hsize);
+	}
 
-	data = c + 1;
 	*c = *cmd;
 
 	if ((cmd->flags & DNET_FLAGS_NEED_ACK) || more)
 		c->flags |= DNET_FLAGS_MORE;
 
-	c->size = size;
+	c->size = hsize + dsize;
 	c->flags |= DNET_FLAGS_REPLY;
 
-	if (size)
-		memcpy(data, odata, size);
-
 	dnet_log(st->n, DNET_LOG_NOTICE, "%s: %s: reply -> %s: trans: %lld, size: %u, cflags: %s",
 		dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), dnet_server_convert_dnet_addr(&st->addr),
 		(unsigned long long)c->trans,
-		size, dnet_flags_dump_cflags(c->flags));
+		hsize + dsize, dnet_flags_dump_cflags(c->flags));
 
 	dnet_convert_cmd(c);
 
-	err = dnet_send(st, c, sizeof(struct dnet_cmd) + size);
-	free(c);
+	err = dnet_send_data(st, c, sizeof(struct dnet_cmd) + hsize, (void *)data, dsize);
+
+	if (c != &reply)
+		free(c);
 
 	return err;
 }
 
+int dnet_send_reply(void *state, struct dnet_cmd *cmd, const void *odata, unsigned int size, int more)
+{
+	return dnet_send_reply_data(state, cmd, NULL, 0, odata, size, more);
+}
+
 /*
  * Queue replies to send queue wrt high and low watermark limits.
  * This is usefull to avoid memory bloat (and hence OOM) when data gets queued
@@ -463,6 +505,10 @@ static int dnet_iterator_callback_common(void *priv, struct dnet_raw_id *key,
 
 key_range_found:
 
+	/* Expired records are treated as absent */
+	if (dnet_ext_list_expired(elist, time(NULL)))
+		goto key_skipped;
+
 	/* If DNET_IFLAGS_TS_RANGE is set... */
 	if (ipriv->req->flags & DNET_IFLAGS_TS_RANGE) {
 		/* ...skip ts not in ts range */
@@ -869,7 +915,7 @@ static int dnet_process_cmd_without_backend_raw(struct dnet_net_state *st, struc
 			err = dnet_route_list_join(st, cmd, data);
 			break;
 		case DNET_CMD_ROUTE_LIST:
-			err = dnet_cmd_route_list(st, cmd);
+			err = dnet_cmd_route_list(st, cmd, data);
 			break;
 		case DNET_CMD_EXEC:
 			err = dnet_cmd_exec(st, cmd, data);
@@ -891,12 +937,52 @@ static int dnet_process_cmd_without_backend_raw(struct dnet_net_state *st, struc
 	return err;
 }
 
+/*
+ * Ranges of DNET_IO_FLAGS_READ_RANGES read follow its io attributes, they are converted in place.
+ * Backend reads the whole object and ranges are cut from it when reply is sent.
+ */
+static int dnet_read_ranges_prepare(struct dnet_net_state *st, struct dnet_cmd *cmd, struct dnet_io_attr *io)
+{
+	struct dnet_io_ranges *ranges = (struct dnet_io_ranges *)(io + 1);
+	uint64_t size = cmd->size - sizeof(struct dnet_io_attr);
+	uint32_t i;
+
+	if (size < sizeof(struct dnet_io_ranges))
+		goto err_out_invalid;
+
+	dnet_convert_io_ranges(ranges);
+
+	if (!ranges->num || (size - sizeof(struct dnet_io_ranges)) / sizeof(struct dnet_io_range) < ranges->num)
+		goto err_out_invalid;
+
+	for (i = 0; i < ranges->num; ++i)
+		dnet_convert_io_range(&ranges->ranges[i]);
+
+	io->offset = 0;
+	io->size = 0;
+	return 0;
+
+err_out_invalid:
+	dnet_log(st->n, DNET_LOG_ERROR, "%s: %s: invalid ranges: cmd-size: %llu",
+			dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), (unsigned long long)cmd->size);
+	return -EINVAL;
+}
+
+/*
+ * Command is being executed inline by network thread, read which misses in cache is not executed then,
+ * @dnet_cmd_inline_missed is set instead and the command is scheduled to io pool
+ */
+static __thread int dnet_cmd_inline_running;
+static __thread int dnet_cmd_inline_missed;
+
 static int dnet_process_cmd_with_backend_raw(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data, int *handled_in_cache)
 {
 	int err = 0;
 	unsigned long long size = cmd->size;
 	struct dnet_node *n = st->n;
 	struct dnet_io_attr *io = NULL;
+	struct dnet_io_attr proxy_io;
+	int proxy = 0;
 
 	switch (cmd->cmd) {
 		case DNET_CMD_ITERATOR:
@@ -954,8 +1040,28 @@ static int dnet_process_cmd_with_backend_raw(struct dnet_backend_io *backend, st
 			if (n->flags & DNET_CFG_NO_CSUM)
 				io->flags |= DNET_IO_FLAGS_NOCSUM;
 
+			if ((cmd->cmd == DNET_CMD_READ) && (io->flags & DNET_IO_FLAGS_READ_RANGES)) {
+				err = dnet_read_ranges_prepare(st, cmd, io);
+				if (err)
+					break;
+			}
+
 			if (!(io->flags & DNET_IO_FLAGS_NOCACHE)) {
+				uint64_t flags = io->flags;
+
+				/* network thread must not populate cache from disk */
+				if (dnet_cmd_inline_running)
+					io->flags = (io->flags & ~DNET_IO_FLAGS_CACHE) | DNET_IO_FLAGS_CACHE_ONLY;
+
 				err = dnet_cmd_cache_io(backend, st, cmd, io, data + sizeof(struct dnet_io_attr));
+				io->flags = flags;
+
+				if (err == -ENOTSUP && dnet_cmd_inline_running) {
+					/* io attributes are left as they were received, since command will be executed again */
+					dnet_convert_io_attr(io);
+					dnet_cmd_inline_missed = 1;
+					break;
+				}
 
 				if (err != -ENOTSUP) {
 					*handled_in_cache = 1;
@@ -973,6 +1079,12 @@ static int dnet_process_cmd_with_backend_raw(struct dnet_backend_io *backend, st
 			if (io->flags & DNET_IO_FLAGS_CACHE_ONLY)
 				break;
 
+			/* keep io attributes for the case read misses in range which is being migrated to this backend */
+			if (backend->migration && cmd->cmd == DNET_CMD_READ && !(io->flags & DNET_IO_FLAGS_READ_RANGES)) {
+				memcpy(&proxy_io, io, sizeof(struct dnet_io_attr));
+				proxy = 1;
+			}
+
 			dnet_convert_io_attr(io);
 		default:
 			if (cmd->cmd == DNET_CMD_LOOKUP && !(cmd->flags & DNET_FLAGS_NOCACHE)) {
@@ -999,16 +1111,46 @@ static int dnet_process_cmd_with_backend_raw(struct dnet_backend_io *backend, st
 				cmd->flags |= DNET_FLAGS_NEED_ACK;
 			}
 
+			if (err == -ENOENT && proxy)
+				err = dnet_backend_migration_proxy(backend, st, cmd, &proxy_io);
+
 			if (!err && (cmd->cmd == DNET_CMD_WRITE)) {
 				dnet_update_notify(st, cmd, data);
 			}
 			break;
 	}
 
+	/* key removed by client must not be recreated by migration of its range */
+	if (cmd->cmd == DNET_CMD_DEL && backend->migration && (!err || err == -ENOENT))
+		dnet_backend_migration_removed(backend, cmd);
+
 	return err;
 }
 
-int dnet_process_cmd_raw(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data, int recursive)
+/*
+ * Returns size of data read or written by IO command
+ */
+static uint64_t dnet_cmd_io_data_size(struct dnet_cmd *cmd, void *data)
+{
+	struct dnet_io_attr *io = data;
+
+	if (cmd->size < sizeof(struct dnet_io_attr))
+		return 0;
+
+	switch (cmd->cmd) {
+		case DNET_CMD_WRITE:
+			return cmd->size - sizeof(struct dnet_io_attr);
+		case DNET_CMD_READ:
+			return io->size;
+		default:
+			return 0;
+	}
+}
+
+/*
+ * Executes command, key of the command has to be already locked if it was needed
+ */
+static int dnet_process_cmd_locked(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data, int recursive)
 {
 	int err = 0;
 	struct dnet_node *n = st->n;
@@ -1026,10 +1168,6 @@ int dnet_process_cmd_raw(struct dnet_backend_io *backend, struct dnet_net_state
 	sprintf(timer_name,  "io_pool.process_cmd.%s%s", dnet_cmd_string(cmd->cmd), recursive ? ".recursive" : "");
 	HANDY_TIMER_SCOPE(timer_name, dnet_get_id());
 
-	if (!(cmd->flags & DNET_FLAGS_NOLOCK)) {
-		dnet_oplock(n, &cmd->id);
-	}
-
 	gettimeofday(&start, NULL);
 
 	err = dnet_process_cmd_without_backend_raw(st, cmd, data);
@@ -1037,6 +1175,10 @@ int dnet_process_cmd_raw(struct dnet_backend_io *backend, struct dnet_net_state
 		err = dnet_process_cmd_with_backend_raw(backend, st, cmd, data, &handled_in_cache);
 	}
 
+	/* nothing has been sent, command is executed by io pool */
+	if (dnet_cmd_inline_missed)
+		return err;
+
 	dnet_stat_inc(st->stat, cmd->cmd, err);
 	if (st->__join_state == DNET_JOIN)
 		dnet_counter_inc(n, cmd->cmd, err);
@@ -1047,6 +1189,9 @@ int dnet_process_cmd_raw(struct dnet_backend_io *backend, struct dnet_net_state
 
 	diff = DIFF(start, end);
 	monitor_command_counter(n, cmd->cmd, tid, err, handled_in_cache, io ? io->size : 0, diff);
+	if (backend && (cmd->cmd == DNET_CMD_READ || cmd->cmd == DNET_CMD_WRITE))
+		monitor_hot_keys_update(n, backend->backend_id, cmd->cmd,
+				(struct dnet_raw_id *)cmd->id.id, dnet_cmd_io_data_size(cmd, data));
 
 	if (((cmd->cmd == DNET_CMD_READ) || (cmd->cmd == DNET_CMD_WRITE)) && io) {
 		char time_str[64];
@@ -1077,11 +1222,226 @@ int dnet_process_cmd_raw(struct dnet_backend_io *backend, struct dnet_net_state
 				tid, dnet_flags_dump_cflags(cmd->flags), diff, err);
 	}
 
-	err = dnet_send_ack(st, cmd, err, recursive);
+	dnet_read_flight_status(st, cmd, err);
+
+	return dnet_send_ack(st, cmd, err, recursive);
+}
+
+int dnet_process_cmd_raw(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data, int recursive)
+{
+	struct dnet_node *n = st->n;
+	struct dnet_read_flight *flight = NULL;
+	int err;
+
+	if (!recursive && dnet_read_flight_join(backend, st, cmd, data, &flight))
+		return 0;
+
+	if (!(cmd->flags & DNET_FLAGS_NOLOCK)) {
+		dnet_oplock(n, &cmd->id);
+	}
+
+	err = dnet_process_cmd_locked(backend, st, cmd, data, recursive);
+
+	/* reads joining after the key is unlocked could miss writes which are executed after this read */
+	if (flight)
+		dnet_read_flight_close(n, flight);
+
+	if (!(cmd->flags & DNET_FLAGS_NOLOCK))
+		dnet_opunlock(n, &cmd->id);
+
+	if (flight)
+		dnet_read_flight_complete(n, flight);
+
+	return err;
+}
+
+/*
+ * Returns non-zero if command does not need to wait for disk or other nodes:
+ * commands which only read node's state and reads of objects which are present in cache
+ */
+static int dnet_cmd_inline(struct dnet_backend_io *backend, struct dnet_cmd *cmd, void *data)
+{
+	struct dnet_io_attr io;
+
+	switch (cmd->cmd) {
+	case DNET_CMD_AUTH:
+	case DNET_CMD_STATUS:
+	case DNET_CMD_REVERSE_LOOKUP:
+	case DNET_CMD_ROUTE_LIST:
+	case DNET_CMD_BACKEND_STATUS:
+		return 1;
+	case DNET_CMD_READ:
+		if (!backend || !backend->cache || cmd->size < sizeof(struct dnet_io_attr))
+			return 0;
+
+		/* io attributes are converted in place when command is executed */
+		memcpy(&io, data, sizeof(struct dnet_io_attr));
+		dnet_convert_io_attr(&io);
+
+		/* ranges are prepared in place, so such read can not be returned to io pool after cache miss */
+		if (io.flags & (DNET_IO_FLAGS_NOCACHE | DNET_IO_FLAGS_READ_RANGES))
+			return 0;
+
+		return dnet_cmd_cache_contains(backend, io.id);
+	default:
+		return 0;
+	}
+}
+
+int dnet_process_cmd_inline(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data)
+{
+	struct dnet_node *n = st->n;
+	int err, missed;
+
+	if (!dnet_cmd_inline(backend, cmd, data))
+		return 1;
+
+	/*
+	 * Network thread must not sleep on the key locked by io thread,
+	 * such command will be executed by io pool after the lock is released
+	 */
+	if (!(cmd->flags & DNET_FLAGS_NOLOCK) && dnet_optrylock(n, &cmd->id))
+		return 1;
+
+	dnet_cmd_inline_running = 1;
+
+	err = dnet_process_cmd_locked(backend, st, cmd, data, 0);
+
+	missed = dnet_cmd_inline_missed;
+	dnet_cmd_inline_running = 0;
+	dnet_cmd_inline_missed = 0;
 
 	if (!(cmd->flags & DNET_FLAGS_NOLOCK))
 		dnet_opunlock(n, &cmd->id);
 
+	/* object has been evicted from cache after the check */
+	if (missed)
+		return 1;
+
+	return err < 0 ? err : 0;
+}
+
+/*
+ * Range is cut by the object's size, zero size means the rest of the object
+ */
+static uint64_t dnet_read_range_size(const struct dnet_io_range *r, uint64_t object_size)
+{
+	uint64_t rest = object_size - r->offset;
+
+	return (r->size && r->size < rest) ? r->size : rest;
+}
+
+/*
+ * Sends reply to DNET_IO_FLAGS_READ_RANGES read. Backend has passed the whole object:
+ * @data or @offset in @fd points to its beginning and @io->size is its size.
+ * Every range is sent directly from the file, object is looked up only once.
+ */
+static int dnet_send_read_ranges(struct dnet_net_state *st, struct dnet_cmd *cmd, struct dnet_io_attr *io, void *data,
+		int fd, uint64_t offset, int on_exit)
+{
+	struct dnet_node *n = st->n;
+	struct dnet_io_ranges *req = (struct dnet_io_ranges *)(io + 1);
+	struct dnet_io_ranges *ranges;
+	struct dnet_io_range *file_ranges = NULL;
+	struct dnet_io_attr *rio;
+	struct dnet_cmd *c;
+	const uint64_t object_size = io->size;
+	const uint32_t num = req->num;
+	uint64_t hsize, size = 0, pos;
+	uint32_t i;
+	int err;
+
+	/* checksum of the whole object is not what has been requested */
+	if (io->flags & DNET_IO_FLAGS_CHECKSUM) {
+		err = -ENOTSUP;
+		goto err_out_exit;
+	}
+
+	hsize = sizeof(struct dnet_cmd) + sizeof(struct dnet_io_attr) + sizeof(struct dnet_io_ranges) +
+		num * sizeof(struct dnet_io_range);
+
+	for (i = 0; i < num; ++i) {
+		if (req->ranges[i].offset && req->ranges[i].offset >= object_size) {
+			err = -E2BIG;
+			goto err_out_exit;
+		}
+
+		size += dnet_read_range_size(&req->ranges[i], object_size);
+	}
+
+	/* data from memory is copied into reply, ranges of the file are sent by sendfile() */
+	c = malloc(hsize + (data ? size : 0));
+	if (!c) {
+		err = -ENOMEM;
+		goto err_out_exit;
+	}
+
+	if (!data) {
+		file_ranges = malloc(num * sizeof(struct dnet_io_range));
+		if (!file_ranges) {
+			err = -ENOMEM;
+			goto err_out_free;
+		}
+	}
+
+	memset(c, 0, hsize);
+
+	rio = (struct dnet_io_attr *)(c + 1);
+	ranges = (struct dnet_io_ranges *)(rio + 1);
+
+	dnet_setup_id(&c->id, cmd->id.group_id, io->id);
+
+	c->flags = cmd->flags & ~(DNET_FLAGS_NEED_ACK);
+	if (cmd->flags & DNET_FLAGS_NEED_ACK)
+		c->flags |= DNET_FLAGS_MORE;
+	c->flags |= DNET_FLAGS_REPLY;
+
+	c->size = hsize - sizeof(struct dnet_cmd) + size;
+	c->trans = cmd->trans;
+	c->cmd = DNET_CMD_READ;
+	c->backend_id = cmd->backend_id;
+
+	memcpy(rio, io, sizeof(struct dnet_io_attr));
+	rio->offset = 0;
+	rio->size = size;
+
+	ranges->num = num;
+
+	for (i = 0, pos = hsize; i < num; ++i) {
+		struct dnet_io_range *r = &ranges->ranges[i];
+
+		r->offset = req->ranges[i].offset;
+		r->size = dnet_read_range_size(&req->ranges[i], object_size);
+
+		if (data) {
+			memcpy((char *)c + pos, (char *)data + r->offset, r->size);
+			pos += r->size;
+		} else {
+			file_ranges[i].offset = offset + r->offset;
+			file_ranges[i].size = r->size;
+		}
+
+		dnet_convert_io_range(r);
+	}
+
+	dnet_convert_io_ranges(ranges);
+	dnet_convert_cmd(c);
+	dnet_convert_io_attr(rio);
+
+	if (data)
+		err = dnet_send(st, c, hsize + size);
+	else
+		err = dnet_send_fd_ranges(st, c, hsize, fd, file_ranges, num, on_exit);
+
+	dnet_log(n, DNET_LOG_INFO, "%s: %s: reply: cflags: %s, ioflags: %s, ranges: %u, size: %llu, object-size: %llu, err: %d",
+			dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd),
+			dnet_flags_dump_cflags(cmd->flags), dnet_flags_dump_ioflags(io->flags),
+			num, (unsigned long long)size, (unsigned long long)object_size, err);
+
+	free(file_ranges);
+err_out_free:
+	free(c);
+err_out_exit:
 	return err;
 }
 
@@ -1106,6 +1466,9 @@ int dnet_send_read_data(void *state, struct dnet_cmd *cmd, struct dnet_io_attr *
 	if (io->flags & DNET_IO_FLAGS_SKIP_SENDING)
 		return 0;
 
+	if ((cmd->cmd == DNET_CMD_READ) && (io->flags & DNET_IO_FLAGS_READ_RANGES))
+		return dnet_send_read_ranges(st, cmd, io, data, fd, offset, on_exit);
+
 	gettimeofday(&start_tv, NULL);
 
 	c = malloc(hsize);
@@ -1148,6 +1511,12 @@ int dnet_send_read_data(void *state, struct dnet_cmd *cmd, struct dnet_io_attr *
 
 	gettimeofday(&csum_tv, NULL);
 
+	/*
+	 * Identical reads which have been waiting for this one get the same reply,
+	 * it is queued before ours, since file descriptor may be closed right after our reply is sent
+	 */
+	dnet_read_flight_reply(st, cmd, c, hsize, data, fd, offset, rio->size, on_exit);
+
 	if (data)
 		err = dnet_send_data(st, c, hsize, data, rio->size);
 	else
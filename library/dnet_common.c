@@ -220,6 +220,11 @@ int dnet_copy_addrs(struct dnet_net_state *nst, struct dnet_addr *addrs, int add
 
 	nst->addr_num = addr_num;
 	memcpy(nst->addrs, addrs, addr_num * sizeof(struct dnet_addr));
+	/*
+	 * Route list replies skip states without addresses, so state gets its version only now,
+	 * otherwise requester could receive newer version without this state and never ask for it again
+	 */
+	nst->route_version = ++n->route_version;
 
 	pthread_mutex_unlock(&n->state_lock);
 
@@ -257,9 +262,10 @@ int dnet_recv_route_list(struct dnet_net_state *st, int (*complete)(struct dnet_
 	struct dnet_node *n = st->n;
 	struct dnet_trans *t;
 	struct dnet_cmd *cmd;
+	struct dnet_route_list_version *version;
 	int err;
 
-	t = dnet_trans_alloc(n, sizeof(struct dnet_cmd));
+	t = dnet_trans_alloc(n, sizeof(struct dnet_cmd) + sizeof(struct dnet_route_list_version));
 	if (!t) {
 		err = -ENOMEM;
 		goto err_out_exit;
@@ -269,9 +275,15 @@ int dnet_recv_route_list(struct dnet_net_state *st, int (*complete)(struct dnet_
 	t->priv = priv;
 
 	cmd = (struct dnet_cmd *)(t + 1);
+	version = (struct dnet_route_list_version *)(cmd + 1);
 
 	cmd->flags = DNET_FLAGS_NEED_ACK | DNET_FLAGS_DIRECT | DNET_FLAGS_NOLOCK;
 	cmd->status = 0;
+	cmd->size = sizeof(struct dnet_route_list_version);
+
+	memset(version, 0, sizeof(struct dnet_route_list_version));
+	version->version = st->remote_route_version;
+	dnet_convert_route_list_version(version);
 
 	memcpy(&t->cmd, cmd, sizeof(struct dnet_cmd));
 
@@ -282,13 +294,13 @@ int dnet_recv_route_list(struct dnet_net_state *st, int (*complete)(struct dnet_
 
 	dnet_convert_cmd(cmd);
 
-	dnet_log(n, DNET_LOG_DEBUG, "%s: list route request to %s.", dnet_dump_id(&cmd->id),
-		dnet_server_convert_dnet_addr(&st->addr));
+	dnet_log(n, DNET_LOG_DEBUG, "%s: list route request to %s, known version: %llu.", dnet_dump_id(&cmd->id),
+		dnet_server_convert_dnet_addr(&st->addr), (unsigned long long)st->remote_route_version);
 
 	memset(&req, 0, sizeof(req));
 	req.st = st;
 	req.header = cmd;
-	req.hsize = sizeof(struct dnet_cmd);
+	req.hsize = sizeof(struct dnet_cmd) + sizeof(struct dnet_route_list_version);
 
 	err = dnet_trans_send(t, &req);
 	if (err)
@@ -343,15 +355,37 @@ void dnet_io_trans_alloc_send(struct dnet_session *s, struct dnet_io_control *ct
 	struct dnet_io_req req;
 	struct dnet_trans *t = NULL;
 	struct dnet_io_attr *io;
+	struct dnet_io_replicas *replicas;
+	const struct dnet_io_ranges *ranges = NULL;
+	struct dnet_io_ranges *rranges;
 	struct dnet_cmd *cmd;
 	struct dnet_addr *request_addr = NULL;
 	uint64_t size = ctl->io.size;
 	uint64_t tsize = sizeof(struct dnet_io_attr) + sizeof(struct dnet_cmd);
-	int err;
+	uint64_t rsize = 0;
+	int err, i;
 
 	if (ctl->cmd == DNET_CMD_READ)
 		size = 0;
 
+	/* groups of replicated write are placed right after io attributes */
+	if ((ctl->cmd == DNET_CMD_WRITE) && (ctl->io.flags & DNET_IO_FLAGS_REPLICATE)) {
+		rsize = sizeof(struct dnet_io_replicas) + s->group_num * sizeof(int);
+		tsize += rsize;
+	}
+
+	/* ranges of multi-range read are passed in ctl->data in host byte order and are placed right after io attributes */
+	if ((ctl->cmd == DNET_CMD_READ) && (ctl->io.flags & DNET_IO_FLAGS_READ_RANGES)) {
+		ranges = ctl->data;
+		if (!ranges) {
+			err = -EINVAL;
+			goto err_out_complete;
+		}
+
+		rsize = sizeof(struct dnet_io_ranges) + (uint64_t)ranges->num * sizeof(struct dnet_io_range);
+		tsize += rsize;
+	}
+
 	t = dnet_trans_alloc(n, tsize);
 	t->wait_ts = *dnet_session_get_timeout(s);
 	if (!t) {
@@ -370,6 +404,32 @@ void dnet_io_trans_alloc_send(struct dnet_session *s, struct dnet_io_control *ct
 	t->command = cmd->cmd;
 
 	memcpy(io, &ctl->io, sizeof(struct dnet_io_attr));
+
+	if (ranges) {
+		rranges = (struct dnet_io_ranges *)(io + 1);
+		memcpy(rranges, ranges, rsize);
+
+		for (i = 0; i < (int)ranges->num; ++i)
+			dnet_convert_io_range(&rranges->ranges[i]);
+		dnet_convert_io_ranges(rranges);
+
+		cmd->size += rsize;
+	} else if (rsize) {
+		replicas = (struct dnet_io_replicas *)(io + 1);
+		memset(replicas, 0, rsize);
+
+		for (i = 0; i < s->group_num; ++i) {
+			if ((uint32_t)s->groups[i] != ctl->id.group_id)
+				replicas->groups[replicas->num++] = dnet_bswap32(s->groups[i]);
+		}
+
+		rsize = sizeof(struct dnet_io_replicas) + replicas->num * sizeof(int);
+		tsize = sizeof(struct dnet_io_attr) + sizeof(struct dnet_cmd) + rsize;
+		cmd->size += rsize;
+
+		dnet_convert_io_replicas(replicas);
+	}
+
 	memcpy(&t->cmd, cmd, sizeof(struct dnet_cmd));
 
 	if ((s->cflags & DNET_FLAGS_DIRECT) == 0) {
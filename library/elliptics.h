@@ -48,6 +48,7 @@ typedef unsigned short u_short;
 #include "atomic.h"
 #include "lock.h"
 #include "route.h"
+#include "defrag.h"
 #include "backend.h"
 
 #include "elliptics/packet.h"
@@ -108,6 +109,35 @@ extern __thread uint64_t trace_id;
 	DNET_LOG_PRINT_ERR(-errno, format, ##a) \
 	DNET_LOG_END()
 
+/*
+ * Timestamps of request processing stages in microseconds of monotonic clock.
+ * They are filled for requests received from network and copied
+ * to the final reply queued while the request is being processed,
+ * so stages are reported to monitor once the final reply is sent.
+ */
+struct dnet_io_req_time {
+	uint64_t		recv_start;	/* first byte of the request has been received */
+	uint64_t		recv_finish;	/* the whole request has been received and queued into io pool */
+	uint64_t		process_start;	/* request has been taken by io thread */
+	uint64_t		process_finish;	/* final reply has been queued for sending */
+
+	int			backend_id;
+	/* final reply has been queued while the request was being processed */
+	int			replied;
+
+	/* header of the request and total size of replies queued for it */
+	struct dnet_cmd		cmd;
+	uint64_t		reply_size;
+};
+
+static inline uint64_t dnet_time_monotonic_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 struct dnet_io_req {
 	struct list_head	req_entry;
 
@@ -123,6 +153,13 @@ struct dnet_io_req {
 	int			fd;
 	off_t			local_offset;
 	size_t			fsize;
+
+	struct dnet_io_req_time	time;
+
+	/* data was sent with MSG_ZEROCOPY and its pages may still be used by the kernel */
+	int			zerocopy;
+	/* sequence number of the first zerocopy send() which was not issued for this request */
+	uint32_t		zerocopy_end;
 };
 
 /*
@@ -174,6 +211,11 @@ struct dnet_net_state
 	int			__join_state;
 	int			__ids_sent;
 
+	/* version of the node's route list when addresses of this state were copied */
+	uint64_t		route_version;
+	/* version of the route list received from this state */
+	uint64_t		remote_route_version;
+
 	/* all address of the given node */
 	int			addr_num;
 	struct dnet_addr	*addrs;
@@ -189,6 +231,8 @@ struct dnet_net_state
 	uint64_t		rcv_end;
 	unsigned int		rcv_flags;
 	void			*rcv_data;
+	/* time when the first byte of currently received command has arrived */
+	uint64_t		rcv_start;
 
 	int			epoll_fd;
 	size_t			send_offset;
@@ -202,6 +246,14 @@ struct dnet_net_state
 	/* Number of queued requests in send queue from iterator */
 	atomic_t		send_queue_size;
 
+	/* MSG_ZEROCOPY is enabled on write_s */
+	int			zerocopy;
+	/* number of zerocopy send() calls issued and completed, completions are reported in order */
+	uint32_t		zerocopy_sent;
+	uint32_t		zerocopy_completed;
+	/* sent requests waiting for zerocopy completion, protected by send_lock */
+	struct list_head	zerocopy_list;
+
 	pthread_mutex_t		trans_lock;
 	struct rb_root		trans_root;
 	struct rb_root		timer_root;
@@ -346,6 +398,7 @@ static inline void dnet_wait_put(struct dnet_wait *w)
 
 struct dnet_notify_bucket
 {
+	/* list of struct dnet_notify_key */
 	struct list_head		notify_list;
 	pthread_rwlock_t		notify_lock;
 };
@@ -469,6 +522,8 @@ struct dnet_work_pool {
 	pthread_mutex_t		lock;
 	pthread_cond_t		wait;
 	struct dnet_work_io	*wio_list;
+	/* number of references to the backend taken by dnet_backend_io_get() */
+	atomic_t		inline_refs;
 };
 
 struct dnet_work_pool_place
@@ -492,6 +547,15 @@ struct dnet_backend_io
 	struct dnet_io_pool		pool;
 	struct dnet_backend_callbacks	*cb;
 	void				*cache;
+	/* migration of key ranges received with new ids, NULL if ids have never been migrated */
+	void				*migration;
+	/*
+	 * Moving average of time requests spend in backend from receiving till the end of processing
+	 * and the last time it was updated, in microseconds. Updated without locks, it is only a hint
+	 * for background tasks like defragmentation scheduling.
+	 */
+	uint64_t			request_time_avg;
+	uint64_t			request_time_update;
 };
 
 struct dnet_io {
@@ -517,13 +581,26 @@ struct dnet_io {
 
 int dnet_state_accept_process(struct dnet_net_state *st, struct epoll_event *ev);
 int dnet_state_net_process(struct dnet_net_state *st, struct epoll_event *ev);
+void dnet_io_bind(struct dnet_node *n);
 int dnet_backend_io_init(struct dnet_node *n, struct dnet_backend_io *io, int io_thread_num, int nonblocking_io_thread_num);
 void dnet_backend_io_cleanup(struct dnet_node *n, struct dnet_backend_io *io);
+/*
+ * Pins running backend, so it is not stopped until dnet_backend_io_put() is called.
+ * Used to execute commands outside of backend's io pool, returns NULL if backend is not running.
+ */
+struct dnet_backend_io *dnet_backend_io_get(struct dnet_node *n, ssize_t backend_id);
+void dnet_backend_io_put(struct dnet_backend_io *io);
+/*
+ * Returns number of requests waiting in blocking and nonblocking io queues of the backend
+ */
+uint64_t dnet_backend_io_queue_size(struct dnet_backend_io *io);
 int dnet_io_init(struct dnet_node *n, struct dnet_config *cfg);
 int dnet_server_io_init(struct dnet_node *n);
 void dnet_io_exit(struct dnet_node *n);
 
 void dnet_io_req_free(struct dnet_io_req *r);
+void dnet_io_req_time_inherit(struct dnet_io_req *r);
+void dnet_io_req_time_report(struct dnet_net_state *st, struct dnet_io_req *r);
 
 struct dnet_locks_entry {
 	struct rb_node		lock_tree_entry;
@@ -539,6 +616,9 @@ struct dnet_locks {
 	struct list_head	lock_list;
 	struct rb_root		lock_tree;
 	pthread_mutex_t		lock;
+	/* open dnet_read_flight entries keyed by read attributes, protected by read_flight_lock */
+	struct rb_root		read_flight_tree;
+	pthread_mutex_t		read_flight_lock;
 };
 
 void dnet_locks_destroy(struct dnet_node *n);
@@ -558,6 +638,10 @@ struct dnet_config_data {
 	struct dnet_config cfg_state;
 	int daemon_mode;
 	int parallel_start;
+	uint64_t zerocopy_threshold;
+	int inline_commands;
+	int defrag_concurrency;
+	int coalesce_reads;
 
 	dnet_backend_info_list *backends;
 };
@@ -588,6 +672,8 @@ struct dnet_node
 	struct list_head	empty_state_list;
 	/* hosts server states, i.e. those who joined network */
 	struct list_head	dht_state_list;
+	/* increased under @state_lock every time addresses of new state are copied, see dnet_copy_addrs() */
+	uint64_t		route_version;
 
 	/* hosts all states added to given node */
 	struct list_head	storage_state_list;
@@ -595,6 +681,7 @@ struct dnet_node
 	atomic_t		trans;
 
 	dnet_route_list		*route;
+	dnet_defrag_scheduler	*defrag;
 	struct dnet_net_state	*st;
 
 	int			error;
@@ -620,6 +707,13 @@ struct dnet_node
 	unsigned int		notify_hash_size;
 	struct dnet_notify_bucket	*notify_hash;
 
+	/* subscriptions with pending notifications, they are sent by notify thread */
+	pthread_mutex_t		notify_queue_lock;
+	pthread_cond_t		notify_queue_wait;
+	struct list_head	notify_queue;
+	pthread_t		notify_tid;
+	int			notify_need_exit;
+
 	pthread_mutex_t		reconnect_lock;
 	struct list_head	reconnect_list;
 	int			reconnect_num;
@@ -660,6 +754,18 @@ struct dnet_node
 	int			server_prio;
 	int			client_prio;
 
+	/* in-memory reply data of at least this size is sent with MSG_ZEROCOPY, 0 disables it */
+	uint64_t		zerocopy_threshold;
+
+	/*
+	 * Commands which do not need to wait for disk (cache hits, route list, statistics)
+	 * are executed by network thread which has received them
+	 */
+	int			inline_commands;
+
+	/* identical reads of the same key which are executed concurrently share single backend read */
+	int			coalesce_reads;
+
 	struct dnet_locks	*locks;
 	/*
 	 * List of dnet_iterator.
@@ -689,6 +795,8 @@ struct dnet_session {
 
 	uint64_t		cflags;
 	uint64_t		user_flags;
+	/* lifetime of written objects in seconds, zero means objects never expire */
+	uint64_t		ttl;
 	trace_id_t		trace_id;
 	uint32_t		ioflags;
 
@@ -750,6 +858,30 @@ static inline void dnet_counter_set(struct dnet_node *n, int counter, int err, i
 
 struct dnet_trans;
 int __attribute__((weak)) dnet_process_cmd_raw(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data, int recursive);
+/*
+ * Executes command only if it can be completed without blocking,
+ * returns positive value if command was not executed and has to be scheduled to io pool
+ */
+int __attribute__((weak)) dnet_process_cmd_inline(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data);
+/*
+ * Coalescing of identical reads, see coalesce.c.
+ * dnet_read_flight_join() returns 1 if read has been attached to the identical one being executed,
+ * its reply is sent by that read then. Otherwise @leader is set to the flight which has to be closed
+ * before the key is unlocked and completed after that.
+ */
+struct dnet_read_flight;
+int dnet_read_flight_join(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data,
+		struct dnet_read_flight **leader);
+void dnet_read_flight_reply(struct dnet_net_state *st, struct dnet_cmd *cmd, const struct dnet_cmd *reply, uint64_t hsize,
+		void *data, int fd, uint64_t offset, uint64_t size, int on_exit);
+void dnet_read_flight_status(struct dnet_net_state *st, struct dnet_cmd *cmd, int err);
+void dnet_read_flight_close(struct dnet_node *n, struct dnet_read_flight *flight);
+void dnet_read_flight_complete(struct dnet_node *n, struct dnet_read_flight *flight);
+
+/*
+ * Executes write with DNET_IO_FLAGS_REPLICATE: stores object locally and writes it to the rest groups
+ */
+int __attribute__((weak)) dnet_process_replicate(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data);
 int dnet_process_recv(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_io_req *r);
 
 int dnet_recv(struct dnet_net_state *st, void *data, unsigned int size);
@@ -768,6 +900,8 @@ int dnet_send_request(struct dnet_net_state *st, struct dnet_io_req *r);
  */
 int __attribute__((weak)) dnet_send_ack(struct dnet_net_state *st, struct dnet_cmd *cmd, int err, int recursive);
 int __attribute__((weak)) dnet_send_reply(void *state, struct dnet_cmd *cmd, const void *odata, unsigned int size, int more);
+int __attribute__((weak)) dnet_send_reply_data(void *state, struct dnet_cmd *cmd, const void *header, unsigned int hsize,
+		const void *data, unsigned int dsize, int more);
 int __attribute__((weak)) dnet_send_reply_threshold(void *state, struct dnet_cmd *cmd, const void *odata, unsigned int size, int more);
 void dnet_schedule_io(struct dnet_node *n, struct dnet_io_req *r);
 
@@ -851,9 +985,16 @@ int dnet_recv_list(struct dnet_node *n, struct dnet_net_state *st);
 
 ssize_t dnet_send_fd(struct dnet_net_state *st, void *header, uint64_t hsize,
 		int fd, uint64_t offset, uint64_t dsize, int on_exit);
+/*
+ * Sends @header followed by @num ranges of @fd, offsets of @ranges are offsets in the file
+ */
+ssize_t dnet_send_fd_ranges(struct dnet_net_state *st, void *header, uint64_t hsize,
+		int fd, const struct dnet_io_range *ranges, uint32_t num, int on_exit);
 ssize_t dnet_send_data(struct dnet_net_state *st, void *header, uint64_t hsize, void *data, uint64_t dsize);
 ssize_t dnet_send(struct dnet_net_state *st, void *data, uint64_t size);
 ssize_t dnet_send_nolock(struct dnet_net_state *st, void *data, uint64_t size);
+void dnet_io_req_sent(struct dnet_net_state *st, struct dnet_io_req *r);
+int dnet_state_zerocopy_complete(struct dnet_net_state *st);
 
 struct dnet_addr_storage
 {
@@ -895,6 +1036,8 @@ void *dnet_cache_init(struct dnet_node *n, struct dnet_backend_io *backend, cons
 void dnet_cache_cleanup(void *);
 int dnet_cmd_cache_io(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, struct dnet_io_attr *io, char *data);
 int dnet_cmd_cache_lookup(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd);
+/* returns non-zero if object @id can be read from cache without touching the disk */
+int dnet_cmd_cache_contains(struct dnet_backend_io *backend, const unsigned char *id);
 
 int dnet_indexes_init(struct dnet_node *, struct dnet_config *);
 void dnet_indexes_cleanup(struct dnet_node *);
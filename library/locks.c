@@ -61,6 +61,7 @@ int dnet_locks_init(struct dnet_node *n, int num)
 
 	INIT_LIST_HEAD(&n->locks->lock_list);
 	n->locks->lock_tree = RB_ROOT;
+	n->locks->read_flight_tree = RB_ROOT;
 
 	err = pthread_mutex_init(&n->locks->lock, NULL);
 	if (err) {
@@ -70,6 +71,14 @@ int dnet_locks_init(struct dnet_node *n, int num)
 		goto err_out_destroy;
 	}
 
+	err = pthread_mutex_init(&n->locks->read_flight_lock, NULL);
+	if (err) {
+		err = -err;
+		dnet_log(n, DNET_LOG_ERROR, "Could not create read flight lock: %s [%d]", strerror(-err), err);
+
+		goto err_out_destroy;
+	}
+
 	entry = (struct dnet_locks_entry *) (n->locks + 1);
 
 	for (i = 0; i < num; ++i, ++entry) {
@@ -277,6 +286,10 @@ int dnet_optrylock(struct dnet_node *n, struct dnet_id *key)
 
 	pthread_mutex_unlock(&entry->lock);
 
+	/* drop reference taken by dnet_oplock_ensure(), lock is owned by someone else */
+	if (err)
+		dnet_oplock_take(n, key);
+
 	return err;
 }
 
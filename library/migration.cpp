@@ -0,0 +1,555 @@
+#include "migration.h"
+#include "elliptics.h"
+
+#include <elliptics/session.hpp>
+
+#include <algorithm>
+
+static bool dnet_raw_id_less(const dnet_raw_id &lhs, const dnet_raw_id &rhs)
+{
+	return dnet_id_cmp_str(lhs.id, rhs.id) < 0;
+}
+
+static bool dnet_raw_id_equal(const dnet_raw_id &lhs, const dnet_raw_id &rhs)
+{
+	return dnet_id_cmp_str(lhs.id, rhs.id) == 0;
+}
+
+/*
+ * Returns id which precedes @id in the ring
+ */
+static dnet_raw_id dnet_raw_id_prev(dnet_raw_id id)
+{
+	for (int i = DNET_ID_SIZE - 1; i >= 0; --i) {
+		if (id.id[i]-- != 0)
+			break;
+	}
+	return id;
+}
+
+std::vector<dnet_ring_entry> dnet_group_ring(dnet_node *node, int group_id)
+{
+	std::vector<dnet_ring_entry> ring;
+	struct dnet_group *g;
+
+	dnet_pthread_lock_guard guard(node->state_lock);
+
+	list_for_each_entry(g, &node->group_list, group_entry) {
+		if (g->group_id != static_cast<unsigned int>(group_id))
+			continue;
+
+		ring.resize(g->id_num);
+		for (int i = 0; i < g->id_num; ++i) {
+			dnet_ring_entry &entry = ring[i];
+			entry.id = g->ids[i].raw;
+			entry.addr = g->ids[i].idc->st->addr;
+			entry.backend_id = g->ids[i].idc->backend_id;
+			entry.local = g->ids[i].idc->st == node->st;
+		}
+		break;
+	}
+
+	return ring;
+}
+
+/*
+ * Key belongs to the largest id which is not greater than the key, keys less than any id belong to the largest id
+ */
+static const dnet_ring_entry *dnet_ring_owner(const std::vector<dnet_ring_entry> &ring, const dnet_raw_id &id)
+{
+	if (ring.empty())
+		return NULL;
+
+	auto it = std::upper_bound(ring.begin(), ring.end(), id, [] (const dnet_raw_id &id, const dnet_ring_entry &entry) {
+		return dnet_raw_id_less(id, entry.id);
+	});
+
+	if (it == ring.begin())
+		return &ring.back();
+	return &*(it - 1);
+}
+
+/*
+ * Ring is split by ids of both rings, every part has single owner in each of them.
+ * Parts owned by @backend_id of this node in @new_ring and by anyone else in @old_ring are migrated.
+ */
+static std::vector<dnet_migration_range> dnet_migration_ranges(const std::vector<dnet_ring_entry> &old_ring,
+		const std::vector<dnet_ring_entry> &new_ring, size_t backend_id)
+{
+	std::vector<dnet_migration_range> ranges;
+	std::vector<dnet_raw_id> bounds;
+
+	if (old_ring.empty() || new_ring.empty())
+		return ranges;
+
+	bounds.reserve(old_ring.size() + new_ring.size());
+	for (auto it = old_ring.begin(); it != old_ring.end(); ++it)
+		bounds.push_back(it->id);
+	for (auto it = new_ring.begin(); it != new_ring.end(); ++it)
+		bounds.push_back(it->id);
+
+	std::sort(bounds.begin(), bounds.end(), dnet_raw_id_less);
+	bounds.erase(std::unique(bounds.begin(), bounds.end(), dnet_raw_id_equal), bounds.end());
+
+	auto is_ours = [backend_id] (const dnet_ring_entry *entry) {
+		return entry->local && static_cast<size_t>(entry->backend_id) == backend_id;
+	};
+
+	for (size_t i = 0; i < bounds.size(); ++i) {
+		const dnet_ring_entry *owner = dnet_ring_owner(new_ring, bounds[i]);
+		const dnet_ring_entry *previous = dnet_ring_owner(old_ring, bounds[i]);
+
+		if (!is_ours(owner) || is_ours(previous))
+			continue;
+
+		dnet_migration_range range;
+		range.begin = bounds[i];
+		range.addr = previous->addr;
+		range.backend_id = previous->backend_id;
+		range.local = previous->local;
+
+		if (i + 1 < bounds.size()) {
+			range.end = dnet_raw_id_prev(bounds[i + 1]);
+			ranges.push_back(range);
+			continue;
+		}
+
+		/* the last part wraps around the ring */
+		memset(range.end.id, 0xff, DNET_ID_SIZE);
+		ranges.push_back(range);
+
+		memset(range.begin.id, 0, DNET_ID_SIZE);
+		if (!dnet_raw_id_equal(range.begin, bounds[0])) {
+			range.end = dnet_raw_id_prev(bounds[0]);
+			ranges.push_back(range);
+		}
+	}
+
+	return ranges;
+}
+
+dnet_backend_migration::dnet_backend_migration(dnet_node *node, size_t backend_id, int group_id, uint64_t rate)
+: m_node(node)
+, m_backend_id(backend_id)
+, m_group_id(group_id)
+, m_rate(rate)
+, m_need_exit(false)
+, m_copied_bytes(0)
+{
+}
+
+dnet_backend_migration::~dnet_backend_migration()
+{
+	stop();
+}
+
+void dnet_backend_migration::start(const std::vector<dnet_ring_entry> &old_ring, const std::vector<dnet_ring_entry> &new_ring)
+{
+	stop();
+
+	std::vector<dnet_migration_range> ranges = dnet_migration_ranges(old_ring, new_ring, m_backend_id);
+
+	dnet_log(m_node, DNET_LOG_INFO, "migration: backend: %zu, group: %d, starting migration of %zu ranges, rate: %llu bytes/sec",
+		m_backend_id, m_group_id, ranges.size(), (unsigned long long)m_rate);
+
+	if (ranges.empty())
+		return;
+
+	std::unique_lock<std::mutex> guard(m_lock);
+	m_ranges = ranges;
+	m_removed.clear();
+	m_need_exit = false;
+	m_start = std::chrono::steady_clock::now();
+	m_copied_bytes = 0;
+	m_thread = std::thread(&dnet_backend_migration::run, this, std::move(ranges));
+}
+
+void dnet_backend_migration::stop()
+{
+	{
+		std::unique_lock<std::mutex> guard(m_lock);
+		m_need_exit = true;
+	}
+	m_wait.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	std::unique_lock<std::mutex> guard(m_lock);
+	if (!m_ranges.empty()) {
+		dnet_log(m_node, DNET_LOG_ERROR, "migration: backend: %zu, stopped, %zu ranges are not migrated",
+			m_backend_id, m_ranges.size());
+		m_ranges.clear();
+	}
+	m_removed.clear();
+}
+
+bool dnet_backend_migration::find(const dnet_raw_id &id, dnet_migration_range &range)
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	for (auto it = m_ranges.begin(); it != m_ranges.end(); ++it) {
+		if (dnet_raw_id_less(id, it->begin) || dnet_raw_id_less(it->end, id))
+			continue;
+
+		range = *it;
+		return true;
+	}
+
+	return false;
+}
+
+void dnet_backend_migration::removed(const dnet_raw_id &id)
+{
+	dnet_migration_range range;
+	if (!find(id, range))
+		return;
+
+	std::unique_lock<std::mutex> guard(m_lock);
+	m_removed.insert(id);
+}
+
+bool dnet_backend_migration::is_removed(const dnet_raw_id &id)
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+	return m_removed.count(id) != 0;
+}
+
+bool dnet_backend_migration::need_exit()
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+	return m_need_exit;
+}
+
+/*
+ * Sleeps until @size more bytes fit into migration rate, returns false if migration has to be stopped
+ */
+bool dnet_backend_migration::throttle(uint64_t size)
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	m_copied_bytes += size;
+	if (!m_rate)
+		return !m_need_exit;
+
+	const uint64_t usecs = m_copied_bytes / m_rate * 1000000 + m_copied_bytes % m_rate * 1000000 / m_rate;
+	const auto deadline = m_start + std::chrono::microseconds(usecs);
+
+	m_wait.wait_until(guard, deadline, [this] () { return m_need_exit; });
+	return !m_need_exit;
+}
+
+void dnet_backend_migration::run(std::vector<dnet_migration_range> ranges)
+{
+	while (!ranges.empty()) {
+		const dnet_migration_range owner = ranges.front();
+
+		auto it = std::stable_partition(ranges.begin(), ranges.end(), [&owner] (const dnet_migration_range &range) {
+			return range.backend_id == owner.backend_id && dnet_addr_equal(&range.addr, &owner.addr);
+		});
+
+		std::vector<dnet_migration_range> owner_ranges(ranges.begin(), it);
+		ranges.erase(ranges.begin(), it);
+
+		if (!migrate_owner(owner_ranges))
+			return;
+
+		complete_owner(owner);
+	}
+
+	dnet_log(m_node, DNET_LOG_INFO, "migration: backend: %zu, completed, copied: %llu bytes",
+		m_backend_id, (unsigned long long)m_copied_bytes);
+}
+
+/*
+ * Previous owner's ranges are not proxied anymore, its keys are either copied or were not found
+ */
+void dnet_backend_migration::complete_owner(const dnet_migration_range &owner)
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	m_ranges.erase(std::remove_if(m_ranges.begin(), m_ranges.end(), [&owner] (const dnet_migration_range &range) {
+		return range.backend_id == owner.backend_id && dnet_addr_equal(&range.addr, &owner.addr);
+	}), m_ranges.end());
+
+	/* removals of keys from completed ranges do not have to be remembered anymore */
+	for (auto it = m_removed.begin(); it != m_removed.end();) {
+		const bool migrating = std::any_of(m_ranges.begin(), m_ranges.end(), [&it] (const dnet_migration_range &range) {
+			return !dnet_raw_id_less(*it, range.begin) && !dnet_raw_id_less(range.end, *it);
+		});
+
+		if (migrating)
+			++it;
+		else
+			m_removed.erase(it++);
+	}
+}
+
+/*
+ * Collects keys of @ranges at their previous owner and copies them one by one.
+ * Objects are written only if there is no such key at the backend, since it may have been already
+ * written by client after the ownership was changed, and if the key was not removed by client.
+ */
+bool dnet_backend_migration::migrate_owner(const std::vector<dnet_migration_range> &ranges)
+{
+	using namespace ioremap::elliptics;
+
+	const dnet_migration_range &owner = ranges.front();
+	char owner_addr[128];
+	dnet_server_convert_dnet_addr_raw(&owner.addr, owner_addr, sizeof(owner_addr));
+
+	session sess(m_node);
+	sess.set_exceptions_policy(session::no_exceptions);
+	sess.set_groups(std::vector<int>(1, m_group_id));
+
+	session remote = sess.clone();
+	remote.set_direct_id(address(owner.addr), owner.backend_id);
+
+	session local = sess.clone();
+	local.set_direct_id(address(m_node->st->addr), m_backend_id);
+	/* key is locked by migration while it checks removals and writes the object */
+	local.set_cflags(local.get_cflags() | DNET_FLAGS_NOLOCK);
+	local.set_ioflags(DNET_IO_FLAGS_NOCACHE | DNET_IO_FLAGS_COMPARE_AND_SWAP);
+
+	std::vector<dnet_iterator_range> iterator_ranges(ranges.size());
+	for (size_t i = 0; i < ranges.size(); ++i) {
+		iterator_ranges[i].key_begin = ranges[i].begin;
+		iterator_ranges[i].key_end = ranges[i].end;
+	}
+
+	dnet_id id;
+	dnet_setup_id(&id, m_group_id, owner.begin.id);
+
+	std::vector<dnet_raw_id> keys;
+	uint64_t iterator_id = 0;
+
+	auto iterator = remote.start_iterator(key(id), iterator_ranges, DNET_ITYPE_NETWORK, DNET_IFLAGS_KEY_RANGE);
+	for (auto it = iterator.begin(); it != iterator.end(); ++it) {
+		if (it->error())
+			continue;
+
+		const dnet_iterator_response *response = it->reply();
+		iterator_id = response->id;
+
+		if (response->status == 0)
+			keys.push_back(response->key);
+
+		if (need_exit()) {
+			remote.cancel_iterator(key(id), iterator_id).wait();
+			return false;
+		}
+	}
+
+	if (iterator.error()) {
+		dnet_log(m_node, DNET_LOG_ERROR, "migration: backend: %zu, failed to iterate %zu ranges of backend: %d at %s: %s",
+			m_backend_id, ranges.size(), owner.backend_id, owner_addr, iterator.error().message().c_str());
+		return !need_exit();
+	}
+
+	size_t copied = 0, skipped = 0, removed = 0, failed = 0;
+
+	for (auto it = keys.begin(); it != keys.end(); ++it) {
+		dnet_setup_id(&id, m_group_id, it->id);
+
+		if (is_removed(*it)) {
+			++removed;
+			continue;
+		}
+
+		auto read = remote.read_data(key(id), 0, 0);
+		read.wait();
+		if (read.error()) {
+			if (read.error().code() != -ENOENT)
+				++failed;
+			continue;
+		}
+
+		const read_result_entry entry = read.get_one();
+		const data_pointer file = entry.file();
+
+		dnet_io_attr io;
+		memset(&io, 0, sizeof(io));
+		memcpy(io.id, it->id, DNET_ID_SIZE);
+		io.timestamp = entry.io_attribute()->timestamp;
+		io.user_flags = entry.io_attribute()->user_flags;
+		io.expire = entry.io_attribute()->expire;
+
+		/*
+		 * Zero parent write succeeds if there is no such key, including the key removed by client,
+		 * so removal is checked under the key lock which client removal also takes
+		 */
+		dnet_oplock(m_node, &id);
+
+		if (is_removed(*it)) {
+			dnet_opunlock(m_node, &id);
+			++removed;
+			continue;
+		}
+
+		auto write = local.write_data(io, file);
+		write.wait();
+
+		dnet_opunlock(m_node, &id);
+
+		/* zero parent checksum does not match any existing object, so newer object is not overwritten */
+		if (write.error().code() == -EBADFD)
+			++skipped;
+		else if (write.error())
+			++failed;
+		else
+			++copied;
+
+		if (!throttle(file.size()))
+			return false;
+	}
+
+	dnet_log(m_node, failed ? DNET_LOG_ERROR : DNET_LOG_INFO,
+		"migration: backend: %zu, migrated %zu ranges of backend: %d at %s: keys: %zu, copied: %zu, already present: %zu, removed: %zu, failed: %zu",
+		m_backend_id, ranges.size(), owner.backend_id, owner_addr, keys.size(), copied, skipped, removed, failed);
+
+	return !need_exit();
+}
+
+struct dnet_migration_proxy
+{
+	struct dnet_net_state	*st;
+	struct dnet_cmd		cmd;
+	int			completed;
+};
+
+/*
+ * Relays replies of the previous owner to the client as replies to its original transaction
+ */
+static int dnet_migration_proxy_complete(struct dnet_addr *addr __unused, struct dnet_cmd *cmd, void *priv)
+{
+	dnet_migration_proxy *proxy = reinterpret_cast<dnet_migration_proxy *>(priv);
+	dnet_cmd reply = proxy->cmd;
+
+	if (is_trans_destroyed(cmd)) {
+		if (!proxy->completed) {
+			int err = cmd ? cmd->status : -ETIMEDOUT;
+			dnet_send_ack(proxy->st, &reply, err ? err : -ETIMEDOUT, 0);
+		}
+
+		dnet_state_put(proxy->st);
+		free(proxy);
+		return 0;
+	}
+
+	const int more = !!(cmd->flags & DNET_FLAGS_MORE);
+	if (!more)
+		proxy->completed = 1;
+
+	reply.status = cmd->status;
+	reply.flags &= ~DNET_FLAGS_NEED_ACK;
+
+	return dnet_send_reply_data(proxy->st, &reply, cmd + 1, cmd->size, NULL, 0, more);
+}
+
+/*
+ * Previous owner is a backend of this node: read is executed by it right here,
+ * key is already locked by the original command
+ */
+static int dnet_migration_proxy_local(struct dnet_net_state *st, struct dnet_cmd *cmd, const struct dnet_io_attr *io,
+		const dnet_migration_range &range)
+{
+	dnet_backend_io *owner = dnet_backend_io_get(st->n, range.backend_id);
+	if (!owner)
+		return -ENOENT;
+
+	dnet_cmd local_cmd = *cmd;
+	local_cmd.flags |= DNET_FLAGS_NOLOCK | DNET_FLAGS_NEED_ACK;
+	local_cmd.backend_id = range.backend_id;
+
+	dnet_io_attr local_io = *io;
+	dnet_convert_io_attr(&local_io);
+
+	dnet_process_cmd_raw(owner, st, &local_cmd, &local_io, 0);
+	dnet_backend_io_put(owner);
+
+	cmd->flags &= ~DNET_FLAGS_NEED_ACK;
+	return 0;
+}
+
+void dnet_backend_migration_removed(struct dnet_backend_io *backend, struct dnet_cmd *cmd)
+{
+	dnet_backend_migration *migration = reinterpret_cast<dnet_backend_migration *>(backend->migration);
+
+	if (!migration)
+		return;
+
+	try {
+		migration->removed(*reinterpret_cast<const dnet_raw_id *>(cmd->id.id));
+	} catch (...) {
+	}
+}
+
+int dnet_backend_migration_proxy(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd,
+		const struct dnet_io_attr *io)
+{
+	dnet_backend_migration *migration = reinterpret_cast<dnet_backend_migration *>(backend->migration);
+	dnet_node *n = st->n;
+	dnet_migration_range range;
+
+	/* direct requests are addressed to this backend exactly, migration also reads previous owners this way */
+	if (!migration || (cmd->flags & DNET_FLAGS_DIRECT))
+		return -ENOENT;
+
+	if (!migration->find(*reinterpret_cast<const dnet_raw_id *>(io->id), range))
+		return -ENOENT;
+
+	dnet_log(n, DNET_LOG_NOTICE, "%s: migration: backend: %zu, proxying read to previous owner: %s, backend: %d",
+		dnet_dump_id(&cmd->id), backend->backend_id, dnet_server_convert_dnet_addr(&range.addr), range.backend_id);
+
+	if (range.local)
+		return dnet_migration_proxy_local(st, cmd, io, range);
+
+	dnet_net_state *owner = dnet_state_search_by_addr(n, &range.addr);
+	if (!owner)
+		return -ENOENT;
+
+	int err = -ENOMEM;
+	dnet_session *s = NULL;
+	dnet_trans_control ctl;
+	dnet_io_attr proxy_io = *io;
+
+	dnet_migration_proxy *proxy = reinterpret_cast<dnet_migration_proxy *>(malloc(sizeof(dnet_migration_proxy)));
+	if (!proxy)
+		goto err_out_put;
+
+	s = dnet_session_create(n);
+	if (!s) {
+		free(proxy);
+		goto err_out_put;
+	}
+	dnet_session_set_trace_id(s, cmd->trace_id);
+	dnet_session_set_direct_backend(s, range.backend_id);
+
+	proxy->st = dnet_state_get(st);
+	proxy->cmd = *cmd;
+	proxy->cmd.flags |= DNET_FLAGS_NEED_ACK;
+	proxy->completed = 0;
+
+	dnet_convert_io_attr(&proxy_io);
+
+	memset(&ctl, 0, sizeof(ctl));
+	memcpy(&ctl.id, &cmd->id, sizeof(dnet_id));
+	ctl.cmd = cmd->cmd;
+	ctl.cflags = DNET_FLAGS_NEED_ACK | DNET_FLAGS_DIRECT | DNET_FLAGS_DIRECT_BACKEND |
+		(cmd->flags & (DNET_FLAGS_NOCACHE | DNET_FLAGS_TRACE_BIT));
+	ctl.data = &proxy_io;
+	ctl.size = sizeof(dnet_io_attr);
+	ctl.complete = dnet_migration_proxy_complete;
+	ctl.priv = proxy;
+
+	/* reply is sent by completion callback even if request could not be sent */
+	dnet_trans_alloc_send_state(s, owner, &ctl);
+	dnet_session_destroy(s);
+
+	cmd->flags &= ~DNET_FLAGS_NEED_ACK;
+	err = 0;
+
+err_out_put:
+	dnet_state_put(owner);
+	return err;
+}
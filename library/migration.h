@@ -0,0 +1,123 @@
+#ifndef IOREMAP_ELLIPTICS_MIGRATION_H
+#define IOREMAP_ELLIPTICS_MIGRATION_H
+
+#include <elliptics/packet.h>
+#include <elliptics/interface.h>
+
+#ifdef __cplusplus
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+/*
+ * Owner of the part of the group's ring which starts at @id
+ */
+struct dnet_ring_entry
+{
+	dnet_raw_id		id;
+	dnet_addr		addr;
+	int			backend_id;
+	/* owner is a backend of this node */
+	bool			local;
+};
+
+/*
+ * Range of keys [@begin, @end] which is owned by the migrating backend now
+ * and which belonged to backend @backend_id at @addr before its ids were changed
+ */
+struct dnet_migration_range
+{
+	dnet_raw_id		begin;
+	dnet_raw_id		end;
+	dnet_addr		addr;
+	int			backend_id;
+	bool			local;
+};
+
+/*
+ * Returns ring of @group_id sorted by ids as it is seen by the node
+ */
+std::vector<dnet_ring_entry> dnet_group_ring(dnet_node *node, int group_id);
+
+/*
+ * Copies objects of key ranges received by the backend with its new ids from their previous owners.
+ * Copying is done by background thread at @rate bytes per second, ranges which are not copied yet
+ * are reported by find(), so reads which miss in these ranges are proxied to the previous owners.
+ */
+class dnet_backend_migration
+{
+public:
+	dnet_backend_migration(dnet_node *node, size_t backend_id, int group_id, uint64_t rate);
+	~dnet_backend_migration();
+
+	/*
+	 * Stops current migration and starts the new one for the difference between @old_ring and @new_ring
+	 */
+	void start(const std::vector<dnet_ring_entry> &old_ring, const std::vector<dnet_ring_entry> &new_ring);
+	void stop();
+
+	bool find(const dnet_raw_id &id, dnet_migration_range &range);
+
+	/*
+	 * Remembers that key @id was removed by client, so it is not copied if its range is not migrated yet
+	 */
+	void removed(const dnet_raw_id &id);
+
+private:
+	dnet_backend_migration(const dnet_backend_migration &) = delete;
+	dnet_backend_migration &operator =(const dnet_backend_migration &) = delete;
+
+	void run(std::vector<dnet_migration_range> ranges);
+	bool migrate_owner(const std::vector<dnet_migration_range> &ranges);
+	void complete_owner(const dnet_migration_range &owner);
+	bool need_exit();
+	bool throttle(uint64_t size);
+	bool is_removed(const dnet_raw_id &id);
+
+	struct raw_id_less {
+		bool operator() (const dnet_raw_id &lhs, const dnet_raw_id &rhs) const {
+			return dnet_id_cmp_str(lhs.id, rhs.id) < 0;
+		}
+	};
+
+	dnet_node		*m_node;
+	const size_t		m_backend_id;
+	const int		m_group_id;
+	const uint64_t		m_rate;
+
+	std::mutex		m_lock;
+	std::condition_variable	m_wait;
+	std::vector<dnet_migration_range> m_ranges;
+	/* keys of not yet migrated ranges which were removed by clients */
+	std::set<dnet_raw_id, raw_id_less> m_removed;
+	bool			m_need_exit;
+	std::thread		m_thread;
+
+	std::chrono::steady_clock::time_point m_start;
+	uint64_t		m_copied_bytes;
+};
+
+extern "C" {
+#endif // __cplusplus
+
+/*
+ * Sends read @cmd which missed at @backend to the previous owner of the key if its range is still being migrated.
+ * Returns zero if request was proxied, reply is sent to @st by the previous owner then, -ENOENT otherwise.
+ */
+int dnet_backend_migration_proxy(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd,
+		const struct dnet_io_attr *io);
+
+/*
+ * Called under the key lock when @cmd removed the key from @backend,
+ * so the key is not recreated by the migration of its range
+ */
+void dnet_backend_migration_removed(struct dnet_backend_io *backend, struct dnet_cmd *cmd);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // IOREMAP_ELLIPTICS_MIGRATION_H
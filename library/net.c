@@ -30,6 +30,11 @@
 
 #include <netinet/tcp.h>
 
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define DNET_HAVE_ZEROCOPY
+#endif
+
 #include "elliptics.h"
 #include "elliptics/packet.h"
 #include "elliptics/interface.h"
@@ -190,6 +195,8 @@ static int dnet_io_req_queue(struct dnet_net_state *st, struct dnet_io_req *orig
 		goto err_out_exit;
 	}
 
+	dnet_io_req_time_inherit(r);
+
 	pthread_mutex_lock(&st->send_lock);
 	list_add_tail(&r->req_entry, &st->send_list);
 
@@ -294,6 +301,162 @@ ssize_t dnet_send_nolock(struct dnet_net_state *st, void *data, uint64_t size)
 	return err;
 }
 
+/*
+ * Sends data of request \a r with MSG_ZEROCOPY, the request must not be freed
+ * until completions of all its send() calls are read by dnet_state_zerocopy_complete()
+ */
+static ssize_t dnet_send_zerocopy_nolock(struct dnet_net_state *st, struct dnet_io_req *r, void *data, uint64_t size)
+{
+#ifdef DNET_HAVE_ZEROCOPY
+	ssize_t err = 0;
+	struct dnet_node *n = st->n;
+
+	while (size) {
+		err = send(st->write_s, data, size, MSG_ZEROCOPY);
+		if (err < 0) {
+			err = -errno;
+
+			/* Limit of memory locked for zerocopy sends is reached, the rest is copied */
+			if (err == -ENOBUFS)
+				return dnet_send_nolock(st, data, size);
+
+			if (err != -EAGAIN)
+				dnet_log_err(n, "Failed to send zerocopy packet: size: %llu, socket: %d",
+					(unsigned long long)size, st->write_s);
+			break;
+		}
+
+		if (err == 0) {
+			dnet_log(n, DNET_LOG_ERROR, "Peer %s has dropped the connection: socket: %d.", dnet_state_dump_addr(st), st->write_s);
+			err = -ECONNRESET;
+			break;
+		}
+
+		/* every successful zerocopy send() gets the next sequence number in completion notifications */
+		r->zerocopy = 1;
+		r->zerocopy_end = ++st->zerocopy_sent;
+
+		data += err;
+		size -= err;
+		st->send_offset += err;
+
+		err = 0;
+	}
+
+	return err;
+#else
+	(void) r;
+	return dnet_send_nolock(st, data, size);
+#endif
+}
+
+static int dnet_io_req_zerocopy_completed(struct dnet_net_state *st, struct dnet_io_req *r)
+{
+	return !r->zerocopy || (int32_t)(r->zerocopy_end - st->zerocopy_completed) <= 0;
+}
+
+/*
+ * Frees completely sent request,
+ * requests sent with MSG_ZEROCOPY are kept until the kernel releases their pages
+ */
+void dnet_io_req_sent(struct dnet_net_state *st, struct dnet_io_req *r)
+{
+	if (!dnet_io_req_zerocopy_completed(st, r)) {
+		pthread_mutex_lock(&st->send_lock);
+		list_add_tail(&r->req_entry, &st->zerocopy_list);
+		pthread_mutex_unlock(&st->send_lock);
+		return;
+	}
+
+	dnet_io_req_free(r);
+}
+
+/*
+ * Reads MSG_ZEROCOPY completion notifications from the error queue of the socket
+ * and frees requests which pages are not used by the kernel anymore.
+ * Returns number of read notifications, it is zero if zerocopy is not enabled for the state.
+ */
+int dnet_state_zerocopy_complete(struct dnet_net_state *st)
+{
+#ifdef DNET_HAVE_ZEROCOPY
+	struct dnet_io_req *r, *tmp;
+	struct sock_extended_err *serr;
+	struct cmsghdr *cm;
+	struct msghdr msg;
+	char control[128];
+	int num = 0;
+
+	if (!st->zerocopy)
+		return 0;
+
+	while (1) {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		if (recvmsg(st->write_s, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			return -errno;
+		}
+
+		for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+			if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+					!(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+				continue;
+
+			serr = (struct sock_extended_err *)CMSG_DATA(cm);
+			if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+
+			/* notification covers send() calls from ee_info to ee_data inclusive */
+			if ((int32_t)(serr->ee_data + 1 - st->zerocopy_completed) > 0)
+				st->zerocopy_completed = serr->ee_data + 1;
+			++num;
+		}
+	}
+
+	if (num) {
+		pthread_mutex_lock(&st->send_lock);
+		list_for_each_entry_safe(r, tmp, &st->zerocopy_list, req_entry) {
+			if (!dnet_io_req_zerocopy_completed(st, r))
+				break;
+
+			list_del(&r->req_entry);
+			dnet_io_req_free(r);
+		}
+		pthread_mutex_unlock(&st->send_lock);
+	}
+
+	return num;
+#else
+	(void) st;
+	return 0;
+#endif
+}
+
+static void dnet_state_setup_zerocopy(struct dnet_net_state *st)
+{
+#ifdef DNET_HAVE_ZEROCOPY
+	struct dnet_node *n = st->n;
+	int enable = 1;
+
+	if (!n->zerocopy_threshold || st->accept_s >= 0 || st->write_s < 0)
+		return;
+
+	if (setsockopt(st->write_s, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) < 0) {
+		dnet_log(n, DNET_LOG_NOTICE, "%s: zerocopy sends are not supported: %s [%d]",
+				dnet_server_convert_dnet_addr(&st->addr), strerror(errno), -errno);
+		return;
+	}
+
+	st->zerocopy = 1;
+#else
+	(void) st;
+#endif
+}
+
 ssize_t dnet_send(struct dnet_net_state *st, void *data, uint64_t size)
 {
 	struct dnet_io_req r;
@@ -359,6 +522,78 @@ ssize_t dnet_send_fd(struct dnet_net_state *st, void *header, uint64_t hsize,
 	return dnet_io_req_queue(st, &r);
 }
 
+/*
+ * Every range is sent by its own request, requests are put into send list under single lock,
+ * so replies of other transactions can not get between them.
+ * Only the last request closes @fd, since it is shared by all ranges.
+ */
+ssize_t dnet_send_fd_ranges(struct dnet_net_state *st, void *header, uint64_t hsize,
+		int fd, const struct dnet_io_range *ranges, uint32_t num, int on_exit)
+{
+	struct dnet_io_req req, *r, *tmp, *last = NULL;
+	LIST_HEAD(head);
+	uint32_t i;
+	int err = 0;
+
+	memset(&req, 0, sizeof(req));
+	req.header = header;
+	req.hsize = hsize;
+	req.fd = -1;
+
+	r = dnet_io_req_copy(st, &req);
+	if (!r) {
+		err = -ENOMEM;
+		goto err_out_exit;
+	}
+	list_add_tail(&r->req_entry, &head);
+
+	for (i = 0; i < num; ++i) {
+		if (!ranges[i].size)
+			continue;
+
+		memset(&req, 0, sizeof(req));
+		req.fd = fd;
+		req.on_exit = on_exit & ~DNET_IO_REQ_FLAGS_CLOSE;
+		req.local_offset = ranges[i].offset;
+		req.fsize = ranges[i].size;
+
+		last = dnet_io_req_copy(st, &req);
+		if (!last) {
+			err = -ENOMEM;
+			goto err_out_free;
+		}
+		list_add_tail(&last->req_entry, &head);
+	}
+
+	if (last)
+		last->on_exit |= on_exit & DNET_IO_REQ_FLAGS_CLOSE;
+	else if (on_exit & DNET_IO_REQ_FLAGS_CLOSE)
+		close(fd);
+
+	/* reply time is inherited by the header, which is the only request with the command */
+	r = list_first_entry(&head, struct dnet_io_req, req_entry);
+	dnet_io_req_time_inherit(r);
+
+	pthread_mutex_lock(&st->send_lock);
+	list_for_each_entry_safe(r, tmp, &head, req_entry) {
+		list_move_tail(&r->req_entry, &st->send_list);
+	}
+
+	if (!st->__need_exit)
+		dnet_schedule_send(st);
+	pthread_mutex_unlock(&st->send_lock);
+
+	return 0;
+
+err_out_free:
+	list_for_each_entry_safe(r, tmp, &head, req_entry) {
+		list_del(&r->req_entry);
+		free(r);
+	}
+err_out_exit:
+	return err;
+}
+
 static void dnet_trans_timestamp(struct dnet_net_state *st, struct dnet_trans *t)
 {
 	struct timespec *wait_ts = t->wait_ts.tv_sec ? &t->wait_ts : &st->n->wait_ts;
@@ -594,6 +829,19 @@ static int dnet_process_control(struct dnet_net_state *st, struct dnet_cmd *cmd,
 	}
 }
 
+/*
+ * Returns non-zero for write which has to be replicated by this node, io attributes are still in network byte order
+ */
+static int dnet_cmd_replicate(struct dnet_cmd *cmd, void *data)
+{
+	struct dnet_io_attr *io = data;
+
+	if (cmd->cmd != DNET_CMD_WRITE || cmd->size < sizeof(struct dnet_io_attr) || !dnet_process_replicate)
+		return 0;
+
+	return !!(dnet_bswap32(io->flags) & DNET_IO_FLAGS_REPLICATE);
+}
+
 int dnet_process_recv(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_io_req *r)
 {
 	int err = 0;
@@ -645,6 +893,7 @@ int dnet_process_recv(struct dnet_backend_io *backend, struct dnet_net_state *st
 					local_io->user_flags = recv_io->user_flags;
 					local_io->total_size = recv_io->total_size;
 					local_io->timestamp = recv_io->timestamp;
+					local_io->expire = recv_io->expire;
 
 					dnet_convert_io_attr(local_io);
 				}
@@ -682,7 +931,10 @@ int dnet_process_recv(struct dnet_backend_io *backend, struct dnet_net_state *st
 	if (!forward_state || forward_state == st || forward_state == n->st) {
 		dnet_state_put(forward_state);
 
-		err = dnet_process_cmd_raw(backend, st, cmd, r->data, 0);
+		if (dnet_cmd_replicate(cmd, r->data))
+			err = dnet_process_replicate(backend, st, cmd, r->data);
+		else
+			err = dnet_process_cmd_raw(backend, st, cmd, r->data, 0);
 		goto out;
 	}
 
@@ -722,6 +974,19 @@ err_out_exit:
 
 void dnet_state_remove_nolock(struct dnet_net_state *st)
 {
+	struct dnet_net_state *tmp;
+
+	/*
+	 * Nodes which have already reported removed state will not send it again within route list update,
+	 * so the whole route list is requested from every node next time
+	 */
+	if (st->route_version) {
+		list_for_each_entry(tmp, &st->n->dht_state_list, node_entry) {
+			tmp->remote_route_version = 0;
+		}
+		st->route_version = 0;
+	}
+
 	list_del_init(&st->node_entry);
 	list_del_init(&st->storage_state_entry);
 	dnet_idc_destroy_nolock(st);
@@ -932,6 +1197,7 @@ int dnet_state_micro_init(struct dnet_net_state *st,
 	}
 
 	INIT_LIST_HEAD(&st->send_list);
+	INIT_LIST_HEAD(&st->zerocopy_list);
 	err = pthread_mutex_init(&st->send_lock, NULL);
 	if (err) {
 		err = -err;
@@ -1059,6 +1325,8 @@ struct dnet_net_state *dnet_state_create(struct dnet_node *n,
 	if (err)
 		goto err_out_dup_destroy;
 
+	dnet_state_setup_zerocopy(st);
+
 	if (n->client_prio) {
 		err = setsockopt(st->read_s, IPPROTO_IP, IP_TOS, &n->client_prio, 4);
 		if (err) {
@@ -1183,6 +1451,11 @@ static void dnet_state_send_clean(struct dnet_net_state *st)
 		list_del(&r->req_entry);
 		dnet_io_req_free(r);
 	}
+
+	list_for_each_entry_safe(r, tmp, &st->zerocopy_list, req_entry) {
+		list_del(&r->req_entry);
+		dnet_io_req_free(r);
+	}
 }
 
 void dnet_state_destroy(struct dnet_net_state *st)
@@ -1226,7 +1499,8 @@ int dnet_send_request(struct dnet_net_state *st, struct dnet_io_req *r)
 		setsockopt(st->write_s, IPPROTO_TCP, TCP_CORK, &cork, 4);
 	}
 
-	if (1) {
+	/* ranges of the reply sent by dnet_send_fd_ranges() have no command */
+	if (r->header || r->data) {
 		struct dnet_cmd *cmd = r->header;
 		if (!cmd)
 			cmd = r->data;
@@ -1245,7 +1519,10 @@ int dnet_send_request(struct dnet_net_state *st, struct dnet_io_req *r)
 
 	if (r->dsize && r->data && st->send_offset < (r->dsize + r->hsize)) {
 		offset = st->send_offset - r->hsize;
-		err = dnet_send_nolock(st, r->data + offset, r->dsize - offset);
+		if (st->zerocopy && r->dsize >= st->n->zerocopy_threshold)
+			err = dnet_send_zerocopy_nolock(st, r, r->data + offset, r->dsize - offset);
+		else
+			err = dnet_send_nolock(st, r->data + offset, r->dsize - offset);
 		if (err)
 			goto err_out_exit;
 	}
@@ -1270,7 +1547,7 @@ int dnet_send_request(struct dnet_net_state *st, struct dnet_io_req *r)
 
 err_out_exit:
 
-	if (1) {
+	if (r->header || r->data) {
 		struct dnet_cmd *cmd = r->header;
 		if (!cmd)
 			cmd = r->data;
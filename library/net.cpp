@@ -457,7 +457,8 @@ static int dnet_validate_route_list(const char *server_addr, dnet_node *node, st
 	cnt = (struct dnet_addr_container *)(cmd + 1);
 	dnet_convert_addr_container(cnt);
 
-	if (cmd->size != sizeof(dnet_addr) * cnt->addr_num + sizeof(dnet_addr_container)) {
+	size = sizeof(dnet_addr) * cnt->addr_num + sizeof(dnet_addr_container);
+	if (cmd->size != (uint64_t)size && cmd->size != size + sizeof(dnet_route_list_version)) {
 		err = -EINVAL;
 		goto err_out_exit;
 	}
@@ -494,6 +495,37 @@ err_out_exit:
 	return err;
 }
 
+/*
+ * Returns true if every address is local or already has a state
+ */
+static bool dnet_route_list_addrs_known(dnet_node *node, const dnet_addr *addrs, size_t addrs_count)
+{
+	for (size_t i = 0; i < addrs_count; ++i) {
+		if (dnet_addr_is_local(node, &addrs[i]))
+			continue;
+
+		dnet_net_state *st = dnet_state_search_by_addr(node, &addrs[i]);
+		if (!st)
+			return false;
+
+		dnet_state_put(st);
+	}
+
+	return true;
+}
+
+/*
+ * Remote route list version is advanced only when every address of the reply is already connected,
+ * otherwise the next request asks for the same changes, so addresses which failed to connect are retried
+ */
+static void dnet_route_list_update_version(dnet_node *node, dnet_net_state *st, const dnet_route_list_version *version)
+{
+	pthread_mutex_lock(&node->state_lock);
+	if (version->version > st->remote_route_version)
+		st->remote_route_version = version->version;
+	pthread_mutex_unlock(&node->state_lock);
+}
+
 static int dnet_connect_route_list_complete(dnet_addr *addr, dnet_cmd *cmd, void *priv)
 {
 	dnet_connect_state *state = reinterpret_cast<dnet_connect_state *>(priv);
@@ -525,7 +557,8 @@ static int dnet_connect_route_list_complete(dnet_addr *addr, dnet_cmd *cmd, void
 	}
 
 	dnet_addr_container *cnt = reinterpret_cast<dnet_addr_container *>(cmd + 1);
-	const size_t states_num = cnt->addr_num / cnt->node_addr_num;
+	dnet_route_list_version *version = NULL;
+	size_t states_num;
 
 	dnet_addr *addrs;
 	dnet_addr_socket_list *sockets;
@@ -535,13 +568,30 @@ static int dnet_connect_route_list_complete(dnet_addr *addr, dnet_cmd *cmd, void
 
 	err = dnet_validate_route_list(server_addr, node, cmd);
 	if (err) {
-		goto err_out_exit;
+		goto err_out_put;
+	}
+
+	states_num = cnt->addr_num / cnt->node_addr_num;
+
+	/* versioned reply: current version of the remote route list follows the addresses */
+	if (cmd->size == sizeof(dnet_addr) * cnt->addr_num + sizeof(dnet_addr_container) + sizeof(dnet_route_list_version)) {
+		version = reinterpret_cast<dnet_route_list_version *>(cnt->addrs + cnt->addr_num);
+		dnet_convert_route_list_version(version);
+
+		dnet_log(node, DNET_LOG_INFO, "route-list: from: %s, version: %llu, changed states: %zu",
+			server_addr, (unsigned long long)version->version, states_num);
+	}
+
+	if (!states_num) {
+		if (version)
+			dnet_route_list_update_version(node, st, version);
+		goto err_out_put;
 	}
 
 	addrs = reinterpret_cast<dnet_addr *>(malloc(states_num * sizeof(dnet_addr)));
 	if (!addrs) {
 		err = -ENOMEM;
-		goto err_out_exit;
+		goto err_out_put;
 	}
 
 	for (size_t i = 0; i < states_num; i += cnt->node_addr_num) {
@@ -549,6 +599,9 @@ static int dnet_connect_route_list_complete(dnet_addr *addr, dnet_cmd *cmd, void
 		memcpy(&addrs[i], addr, sizeof(dnet_addr));
 	}
 
+	if (version && dnet_route_list_addrs_known(node, addrs, states_num))
+		dnet_route_list_update_version(node, st, version);
+
 	sockets = dnet_socket_create_addresses(node, addrs, states_num, false, state->join, &all_exist);
 	if (!sockets) {
 		err = -ENOMEM;
@@ -588,7 +641,8 @@ static int dnet_connect_route_list_complete(dnet_addr *addr, dnet_cmd *cmd, void
 
 err_out_free_addrs:
 	free(addrs);
-err_out_exit:
+err_out_put:
+	dnet_state_put(st);
 	return err;
 }
 
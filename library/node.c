@@ -748,6 +748,7 @@ struct dnet_session *dnet_session_copy(struct dnet_session *s)
 	new_s->ioflags = s->ioflags;
 	new_s->ts = s->ts;
 	new_s->user_flags = s->user_flags;
+	new_s->ttl = s->ttl;
 	new_s->direct_addr = s->direct_addr;
 	new_s->direct_backend = s->direct_backend;
 
@@ -890,6 +891,16 @@ uint64_t dnet_session_get_user_flags(struct dnet_session *s)
 	return s->user_flags;
 }
 
+void dnet_session_set_ttl(struct dnet_session *s, uint64_t ttl)
+{
+	s->ttl = ttl;
+}
+
+uint64_t dnet_session_get_ttl(struct dnet_session *s)
+{
+	return s->ttl;
+}
+
 void dnet_session_set_timeout(struct dnet_session *s, long wait_timeout)
 {
 	s->wait_ts.tv_sec = wait_timeout;
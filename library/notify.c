@@ -37,24 +37,71 @@
 
 #include "monitor/measure_points.h"
 
+/*
+ * Subscription of single client to changes of single key.
+ * Write path only stores the latest notification in the subscription
+ * and queues it to the notify thread, so successive updates of the key
+ * are coalesced into single notification if subscription is still in the queue.
+ */
 struct dnet_notify_entry
 {
 	struct list_head		notify_entry;
+	/* entry in node's queue of subscriptions with pending notification */
+	struct list_head		queue_entry;
 	struct dnet_cmd			cmd;
 	struct dnet_net_state		*state;
+	atomic_t			refcnt;
+
+	/* fields below are protected by n->notify_queue_lock */
+	int				queued;
+	int				removed;
+	unsigned long long		coalesced;
+	struct dnet_io_notification	notif;
+};
+
+/*
+ * All subscriptions to single key
+ */
+struct dnet_notify_key
+{
+	struct list_head		key_entry;
+	struct dnet_id			id;
+	struct list_head		entries;
 };
 
 static unsigned int dnet_notify_hash(struct dnet_id *id, unsigned int hash_size)
 {
-	unsigned int hash = 0xbb40e64d; /* 3.141592653 */
+	uint64_t hash = 0xbb40e64d; /* 3.141592653 */
+	uint64_t word;
 	unsigned int i;
-	unsigned int *int_id = (unsigned int *)id->id;
 
-	for (i=0; i<DNET_ID_SIZE / 4; ++i)
-		hash ^= int_id[i];
+	for (i = 0; i < DNET_ID_SIZE / sizeof(uint64_t); ++i) {
+		memcpy(&word, id->id + i * sizeof(uint64_t), sizeof(uint64_t));
+		hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+		hash ^= hash >> 29;
+	}
+
+	return hash % hash_size;
+}
 
-	hash %= hash_size;
-	return hash;
+static struct dnet_notify_key *dnet_notify_key_search(struct dnet_notify_bucket *b, struct dnet_id *id)
+{
+	struct dnet_notify_key *k;
+
+	list_for_each_entry(k, &b->notify_list, key_entry) {
+		if (!dnet_id_cmp(&k->id, id))
+			return k;
+	}
+
+	return NULL;
+}
+
+static void dnet_notify_entry_put(struct dnet_notify_entry *e)
+{
+	if (atomic_dec_and_test(&e->refcnt)) {
+		dnet_state_put(e->state);
+		free(e);
+	}
 }
 
 int dnet_update_notify(struct dnet_net_state *st, struct dnet_cmd *cmd, void *data)
@@ -64,32 +111,88 @@ int dnet_update_notify(struct dnet_net_state *st, struct dnet_cmd *cmd, void *da
 	struct dnet_node *n = st->n;
 	unsigned int hash = dnet_notify_hash(&cmd->id, n->notify_hash_size);
 	struct dnet_notify_bucket *b = &n->notify_hash[hash];
+	struct dnet_notify_key *k;
 	struct dnet_notify_entry *nt;
 	struct dnet_io_attr *io = data;
 	struct dnet_io_notification notif;
+	int queued = 0;
+
+	pthread_rwlock_rdlock(&b->notify_lock);
+	k = dnet_notify_key_search(b, &cmd->id);
+	if (!k) {
+		pthread_rwlock_unlock(&b->notify_lock);
+		return 0;
+	}
 
 	memcpy(&notif.io, io, sizeof(struct dnet_io_attr));
 	dnet_convert_io_attr(&notif.io);
+	memcpy(&notif.addr, &st->addr, sizeof(struct dnet_addr));
 
-	pthread_rwlock_rdlock(&b->notify_lock);
-	list_for_each_entry(nt, &b->notify_list, notify_entry) {
-		if (dnet_id_cmp(&cmd->id, &nt->cmd.id))
-			continue;
+	pthread_mutex_lock(&n->notify_queue_lock);
+	list_for_each_entry(nt, &k->entries, notify_entry) {
+		nt->notif = notif;
 
-		memcpy(&notif.addr, &st->addr, sizeof(struct dnet_addr));
+		if (nt->queued) {
+			nt->coalesced++;
+			continue;
+		}
 
-		dnet_log(n, DNET_LOG_NOTICE, "%s: sending notification.", dnet_dump_id(&cmd->id));
-		dnet_send_reply(nt->state, &nt->cmd, &notif, sizeof(struct dnet_io_notification), 1);
+		nt->queued = 1;
+		atomic_inc(&nt->refcnt);
+		list_add_tail(&nt->queue_entry, &n->notify_queue);
+		queued++;
 	}
+	pthread_mutex_unlock(&n->notify_queue_lock);
 	pthread_rwlock_unlock(&b->notify_lock);
 
+	if (queued)
+		pthread_cond_signal(&n->notify_queue_wait);
+
+	dnet_log(n, DNET_LOG_NOTICE, "%s: queued %d notifications.", dnet_dump_id(&cmd->id), queued);
+
 	return 0;
 }
 
-static void dnet_notify_entry_destroy(struct dnet_notify_entry *e)
+/*
+ * Sends queued notifications, so slow subscribers and
+ * large number of subscribers do not slow down write path
+ */
+static void *dnet_notify_process(void *data)
 {
-	dnet_state_put(e->state);
-	free(e);
+	struct dnet_node *n = data;
+	struct dnet_notify_entry *e;
+	struct dnet_io_notification notif;
+	int removed;
+
+	dnet_set_name("dnet_notify");
+
+	while (1) {
+		pthread_mutex_lock(&n->notify_queue_lock);
+		while (list_empty(&n->notify_queue) && !n->notify_need_exit)
+			pthread_cond_wait(&n->notify_queue_wait, &n->notify_queue_lock);
+
+		if (list_empty(&n->notify_queue)) {
+			pthread_mutex_unlock(&n->notify_queue_lock);
+			break;
+		}
+
+		e = list_first_entry(&n->notify_queue, struct dnet_notify_entry, queue_entry);
+		list_del_init(&e->queue_entry);
+		e->queued = 0;
+		notif = e->notif;
+		removed = e->removed;
+		pthread_mutex_unlock(&n->notify_queue_lock);
+
+		if (!removed && !n->notify_need_exit) {
+			dnet_log(n, DNET_LOG_NOTICE, "%s: sending notification, coalesced: %llu.",
+					dnet_dump_id(&e->cmd.id), e->coalesced);
+			dnet_send_reply(e->state, &e->cmd, &notif, sizeof(struct dnet_io_notification), 1);
+		}
+
+		dnet_notify_entry_put(e);
+	}
+
+	return NULL;
 }
 
 int dnet_notify_add(struct dnet_net_state *st, struct dnet_cmd *cmd)
@@ -98,6 +201,7 @@ int dnet_notify_add(struct dnet_net_state *st, struct dnet_cmd *cmd)
 
 	struct dnet_node *n = st->n;
 	struct dnet_notify_entry *e;
+	struct dnet_notify_key *k, *new_key;
 	unsigned int hash = dnet_notify_hash(&cmd->id, n->notify_hash_size);
 	struct dnet_notify_bucket *b = &n->notify_hash[hash];
 
@@ -105,39 +209,77 @@ int dnet_notify_add(struct dnet_net_state *st, struct dnet_cmd *cmd)
 	if (!e)
 		return -ENOMEM;
 
+	new_key = malloc(sizeof(struct dnet_notify_key));
+	if (!new_key) {
+		free(e);
+		return -ENOMEM;
+	}
+
+	memset(e, 0, sizeof(struct dnet_notify_entry));
+	INIT_LIST_HEAD(&e->queue_entry);
+	atomic_init(&e->refcnt, 1);
 	e->state = dnet_state_get(st);
 	memcpy(&e->cmd, cmd, sizeof(struct dnet_cmd));
 
 	pthread_rwlock_wrlock(&b->notify_lock);
-	list_add_tail(&e->notify_entry, &b->notify_list);
+	k = dnet_notify_key_search(b, &cmd->id);
+	if (!k) {
+		k = new_key;
+		new_key = NULL;
+
+		memcpy(&k->id, &cmd->id, sizeof(struct dnet_id));
+		INIT_LIST_HEAD(&k->entries);
+		list_add_tail(&k->key_entry, &b->notify_list);
+	}
+	list_add_tail(&e->notify_entry, &k->entries);
 	pthread_rwlock_unlock(&b->notify_lock);
 
+	free(new_key);
+
 	dnet_log(n, DNET_LOG_INFO, "%s: added notification, hash: 0x%x.", dnet_dump_id(&cmd->id), hash);
 
 	return 0;
 }
 
+/*
+ * Unlinks subscription, notification which is already queued will be dropped by notify thread
+ */
+static void dnet_notify_entry_remove(struct dnet_node *n, struct dnet_notify_entry *e)
+{
+	list_del(&e->notify_entry);
+
+	pthread_mutex_lock(&n->notify_queue_lock);
+	e->removed = 1;
+	pthread_mutex_unlock(&n->notify_queue_lock);
+
+	dnet_notify_entry_put(e);
+}
+
 int dnet_notify_remove(struct dnet_net_state *st, struct dnet_cmd *cmd)
 {
 	struct dnet_node *n = st->n;
-	struct dnet_notify_entry *e, *tmp;
+	struct dnet_notify_entry *e;
+	struct dnet_notify_key *k;
 	unsigned int hash = dnet_notify_hash(&cmd->id, n->notify_hash_size);
 	struct dnet_notify_bucket *b = &n->notify_hash[hash];
 	int err = -ENXIO;
 
 	pthread_rwlock_wrlock(&b->notify_lock);
-	list_for_each_entry_safe(e, tmp, &b->notify_list, notify_entry) {
-		if (dnet_id_cmp(&e->cmd.id, &cmd->id))
-			continue;
+	k = dnet_notify_key_search(b, &cmd->id);
+	if (k && !list_empty(&k->entries)) {
+		e = list_first_entry(&k->entries, struct dnet_notify_entry, notify_entry);
 
 		e->cmd.flags = 0;
 		err = dnet_send_reply(e->state, &e->cmd, NULL, 0, 0);
 
-		list_del(&e->notify_entry);
-		dnet_notify_entry_destroy(e);
+		dnet_notify_entry_remove(n, e);
+
+		if (list_empty(&k->entries)) {
+			list_del(&k->key_entry);
+			free(k);
+		}
 
 		dnet_log(n, DNET_LOG_INFO, "%s: removed notification.", dnet_dump_id(&cmd->id));
-		break;
 	}
 	pthread_rwlock_unlock(&b->notify_lock);
 
@@ -170,11 +312,39 @@ int dnet_notify_init(struct dnet_node *n)
 		}
 	}
 
+	INIT_LIST_HEAD(&n->notify_queue);
+	n->notify_need_exit = 0;
+
+	err = pthread_mutex_init(&n->notify_queue_lock, NULL);
+	if (err) {
+		err = -err;
+		dnet_log(n, DNET_LOG_ERROR, "Failed to initialize notify queue lock: err: %d", err);
+		goto err_out_free;
+	}
+
+	err = pthread_cond_init(&n->notify_queue_wait, NULL);
+	if (err) {
+		err = -err;
+		dnet_log(n, DNET_LOG_ERROR, "Failed to initialize notify queue condition: err: %d", err);
+		goto err_out_lock_destroy;
+	}
+
+	err = pthread_create(&n->notify_tid, NULL, dnet_notify_process, n);
+	if (err) {
+		err = -err;
+		dnet_log(n, DNET_LOG_ERROR, "Failed to start notify thread: err: %d", err);
+		goto err_out_cond_destroy;
+	}
+
 	dnet_log(n, DNET_LOG_INFO, "Successfully initialized notify hash table (%u entries).",
 			n->notify_hash_size);
 
 	return 0;
 
+err_out_cond_destroy:
+	pthread_cond_destroy(&n->notify_queue_wait);
+err_out_lock_destroy:
+	pthread_mutex_destroy(&n->notify_queue_lock);
 err_out_free:
 	n->notify_hash_size = i;
 	for (i=0; i<n->notify_hash_size; ++i) {
@@ -182,6 +352,7 @@ err_out_free:
 		pthread_rwlock_destroy(&b->notify_lock);
 	}
 	free(n->notify_hash);
+	n->notify_hash = NULL;
 err_out_exit:
 	return err;
 }
@@ -190,20 +361,37 @@ void dnet_notify_exit(struct dnet_node *n)
 {
 	unsigned int i;
 	struct dnet_notify_bucket *b;
+	struct dnet_notify_key *k, *ktmp;
 	struct dnet_notify_entry *e, *tmp;
 
+	if (!n->notify_hash)
+		return;
+
+	pthread_mutex_lock(&n->notify_queue_lock);
+	n->notify_need_exit = 1;
+	pthread_mutex_unlock(&n->notify_queue_lock);
+	pthread_cond_broadcast(&n->notify_queue_wait);
+	pthread_join(n->notify_tid, NULL);
+
 	for (i=0; i<n->notify_hash_size; ++i) {
 		b = &n->notify_hash[i];
 
 		pthread_rwlock_wrlock(&b->notify_lock);
-		list_for_each_entry_safe(e, tmp, &b->notify_list, notify_entry) {
-			list_del(&e->notify_entry);
+		list_for_each_entry_safe(k, ktmp, &b->notify_list, key_entry) {
+			list_for_each_entry_safe(e, tmp, &k->entries, notify_entry) {
+				dnet_notify_entry_remove(n, e);
+			}
 
-			dnet_notify_entry_destroy(e);
+			list_del(&k->key_entry);
+			free(k);
 		}
 		pthread_rwlock_unlock(&b->notify_lock);
 
 		pthread_rwlock_destroy(&b->notify_lock);
 	}
 	free(n->notify_hash);
+	n->notify_hash = NULL;
+
+	pthread_cond_destroy(&n->notify_queue_wait);
+	pthread_mutex_destroy(&n->notify_queue_lock);
 }
@@ -30,6 +30,12 @@
 #include "elliptics/interface.h"
 #include "../monitor/monitor.h"
 
+/*
+ * Request which is being processed by current io thread,
+ * final reply queued while processing inherits its timestamps
+ */
+static __thread struct dnet_io_req *dnet_io_req_current;
+
 static char *dnet_work_io_mode_string[] = {
 	[DNET_WORK_IO_MODE_BLOCKING] = "BLOCKING",
 	[DNET_WORK_IO_MODE_NONBLOCKING] = "NONBLOCKING",
@@ -57,6 +63,10 @@ static void dnet_work_pool_cleanup(struct dnet_work_pool_place *place)
 		pthread_join(wio->tid, NULL);
 	}
 
+	/* wait for commands which are being executed outside of pool threads, the last one wakes us up */
+	while (atomic_read(&place->pool->inline_refs) > 0)
+		pthread_cond_wait(&place->wait, &place->lock);
+
 
 	list_for_each_entry_safe(r, tmp, &place->pool->list, req_entry) {
 		list_del(&r->req_entry);
@@ -110,6 +120,9 @@ static int dnet_work_pool_grow(struct dnet_node *n, struct dnet_work_pool *pool,
 			dnet_log(n, DNET_LOG_ERROR, "Failed to create IO thread: %d", err);
 			goto err_out_io_threads;
 		}
+
+		if (dnet_thread_bind)
+			dnet_thread_bind(n, wio->tid, DNET_THREAD_POOL_IO, pool->io ? (ssize_t)pool->io->backend_id : -1);
 	}
 
 	dnet_log(n, DNET_LOG_INFO, "Grew %s pool by: %d -> %d IO threads",
@@ -248,6 +261,39 @@ static int dnet_cmd_needs_backend(int command)
 	return 1;
 }
 
+struct dnet_backend_io *dnet_backend_io_get(struct dnet_node *n, ssize_t backend_id)
+{
+	struct dnet_work_pool_place *place;
+	struct dnet_backend_io *io = NULL;
+
+	if (backend_id < 0 || backend_id >= (ssize_t)n->io->backends_count)
+		return NULL;
+
+	/* place lock is held only to take the reference */
+	place = &n->io->backends[backend_id].pool.recv_pool;
+
+	pthread_mutex_lock(&place->lock);
+	if (place->pool && !place->pool->io->need_exit) {
+		atomic_inc(&place->pool->inline_refs);
+		io = place->pool->io;
+	}
+	pthread_mutex_unlock(&place->lock);
+
+	return io;
+}
+
+void dnet_backend_io_put(struct dnet_backend_io *io)
+{
+	struct dnet_work_pool_place *place = &io->pool.recv_pool;
+
+	/* pool cleanup checks references under place lock, so wakeup is not lost */
+	if (atomic_dec_and_test(&place->pool->inline_refs)) {
+		pthread_mutex_lock(&place->lock);
+		pthread_cond_broadcast(&place->wait);
+		pthread_mutex_unlock(&place->lock);
+	}
+}
+
 static void *dnet_io_process(void *data_);
 void dnet_schedule_io(struct dnet_node *n, struct dnet_io_req *r)
 {
@@ -337,6 +383,76 @@ void dnet_schedule_io(struct dnet_node *n, struct dnet_io_req *r)
 	pthread_mutex_unlock(&place->lock);
 }
 
+/*
+ * Executes command in the current network thread if it does not need to wait for disk.
+ * Returns non-zero if command has not been executed and has to be scheduled to io pool.
+ */
+static int dnet_io_process_inline(struct dnet_node *n, struct dnet_io_req *r)
+{
+	struct dnet_net_state *st = r->st;
+	struct dnet_net_state *forward_state;
+	struct dnet_cmd *cmd = r->header;
+	struct dnet_backend_io *backend = NULL;
+	ssize_t backend_id = -1;
+	int err;
+
+	/* commands are processed by server library only */
+	if (!dnet_process_cmd_inline || !n->inline_commands || (cmd->flags & DNET_FLAGS_REPLY))
+		return 1;
+
+	/* forwarding is left to io threads */
+	if (!(cmd->flags & DNET_FLAGS_DIRECT)) {
+		forward_state = dnet_state_get_first(n, &cmd->id);
+		dnet_state_put(forward_state);
+
+		if (forward_state && forward_state != st && forward_state != n->st)
+			return 1;
+	}
+
+	if (cmd->flags & DNET_FLAGS_DIRECT_BACKEND)
+		backend_id = cmd->backend_id;
+	else if (dnet_cmd_needs_backend(cmd->cmd))
+		backend_id = dnet_state_search_backend(n, &cmd->id);
+
+	if (backend_id >= 0) {
+		backend = dnet_backend_io_get(n, backend_id);
+		if (!backend)
+			return 1;
+	} else if (dnet_cmd_needs_backend(cmd->cmd)) {
+		return 1;
+	}
+
+	backend_id = backend ? (ssize_t)backend->backend_id : -1;
+	cmd->backend_id = backend_id;
+
+	dnet_node_set_trace_id(n->log, cmd->trace_id, cmd->flags & DNET_FLAGS_TRACE_BIT, backend_id);
+
+	r->time.process_start = dnet_time_monotonic_us();
+	r->time.backend_id = backend_id;
+	r->time.cmd = *cmd;
+	dnet_io_req_current = r;
+
+	err = dnet_process_cmd_inline(backend, st, cmd, r->data);
+
+	dnet_io_req_current = NULL;
+
+	if (err <= 0) {
+		dnet_log(n, DNET_LOG_DEBUG, "%s: %s: processed inline: cmd: %s, err: %d",
+			dnet_state_dump_addr(st), dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), err);
+
+		if (!r->time.replied) {
+			r->time.process_finish = dnet_time_monotonic_us();
+			dnet_io_req_time_report(st, r);
+		}
+	}
+
+	dnet_node_unset_trace_id();
+
+	if (backend)
+		dnet_backend_io_put(backend);
+
+	return err > 0;
+}
 
 void dnet_schedule_command(struct dnet_net_state *st)
 {
@@ -397,6 +513,9 @@ again:
 			goto out;
 		}
 
+		if ((st->rcv_flags & DNET_IO_CMD) && st->rcv_offset == 0)
+			st->rcv_start = dnet_time_monotonic_us();
+
 		st->rcv_offset += err;
 	}
 
@@ -450,6 +569,14 @@ again:
 	dnet_schedule_command(st);
 
 	r->st = dnet_state_get(st);
+	r->time.recv_start = st->rcv_start;
+	r->time.recv_finish = dnet_time_monotonic_us();
+
+	if (!dnet_io_process_inline(n, r)) {
+		dnet_state_put(r->st);
+		dnet_io_req_free(r);
+		return 0;
+	}
 
 	dnet_schedule_io(n, r);
 	return 0;
@@ -603,6 +730,50 @@ void dnet_unschedule_all(struct dnet_net_state *st)
 		epoll_ctl(st->epoll_fd, EPOLL_CTL_DEL, st->accept_s, NULL);
 }
 
+void dnet_io_req_time_inherit(struct dnet_io_req *r)
+{
+	struct dnet_io_req *orig = dnet_io_req_current;
+	struct dnet_cmd *cmd = r->header;
+	uint64_t flags;
+
+	if (!orig || orig->time.replied)
+		return;
+
+	if (!cmd)
+		cmd = r->data;
+	if (!cmd)
+		return;
+
+	/* reply has been already converted to network byte order */
+	flags = dnet_bswap64(cmd->flags);
+	if (!(flags & DNET_FLAGS_REPLY))
+		return;
+
+	orig->time.reply_size += r->hsize + r->dsize + r->fsize;
+	if (flags & DNET_FLAGS_MORE)
+		return;
+
+	orig->time.process_finish = dnet_time_monotonic_us();
+	orig->time.replied = 1;
+	r->time = orig->time;
+}
+
+void dnet_io_req_time_report(struct dnet_net_state *st, struct dnet_io_req *r)
+{
+	struct dnet_io_req_time *t = &r->time;
+	uint64_t now;
+
+	if (!t->recv_start || !t->process_finish || !monitor_request_stages)
+		return;
+
+	now = dnet_time_monotonic_us();
+	monitor_request_stages(st->n, &t->cmd, &st->addr, t->backend_id, t->reply_size,
+			t->recv_finish - t->recv_start,
+			t->process_start - t->recv_finish,
+			t->process_finish - t->process_start,
+			now > t->process_finish ? now - t->process_finish : 0);
+}
+
 static int dnet_process_send_single(struct dnet_net_state *st)
 {
 	struct dnet_io_req *r = NULL;
@@ -643,7 +814,8 @@ static int dnet_process_send_single(struct dnet_net_state *st)
 					pthread_cond_broadcast(&st->send_wait);
 				}
 
-			dnet_io_req_free(r);
+			dnet_io_req_time_report(st, r);
+			dnet_io_req_sent(st, r);
 			st->send_offset = 0;
 		}
 
@@ -725,6 +897,28 @@ int dnet_schedule_recv(struct dnet_net_state *st)
 	return dnet_schedule_network_io(st, 0);
 }
 
+/*
+ * Returns zero if error event of the socket is not fatal.
+ * Completions of zerocopy sends are reported as socket errors too, and since read and write descriptors
+ * share the socket, completions may be already read while the event of the other descriptor was processed.
+ * Socket is dead only if it has pending error.
+ */
+static int dnet_state_check_error(struct dnet_net_state *st)
+{
+	int fd = st->write_s >= 0 ? st->write_s : st->read_s;
+	socklen_t len = sizeof(int);
+	int err, sock_err = 0;
+
+	err = dnet_state_zerocopy_complete(st);
+	if (err < 0)
+		return err;
+
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &sock_err, &len) < 0)
+		return -errno;
+
+	return -sock_err;
+}
+
 int dnet_state_net_process(struct dnet_net_state *st, struct epoll_event *ev)
 {
 	int err = -ECONNRESET;
@@ -741,8 +935,13 @@ int dnet_state_net_process(struct dnet_net_state *st, struct epoll_event *ev)
 	}
 
 	if (ev->events & (EPOLLHUP | EPOLLERR)) {
-		dnet_log(st->n, DNET_LOG_ERROR, "%s: received error event mask 0x%x", dnet_state_dump_addr(st), ev->events);
-		err = -ECONNRESET;
+		if (!(ev->events & EPOLLHUP) && !dnet_state_check_error(st)) {
+			if (!(ev->events & (EPOLLIN | EPOLLOUT)))
+				err = 0;
+		} else {
+			dnet_log(st->n, DNET_LOG_ERROR, "%s: received error event mask 0x%x", dnet_state_dump_addr(st), ev->events);
+			err = -ECONNRESET;
+		}
 	}
 err_out_exit:
 	return err;
@@ -769,6 +968,15 @@ static void dnet_check_io_pool(struct dnet_io_pool *io, uint64_t *list_size, uin
 	dnet_check_work_pool_place(&io->recv_pool_nb, list_size, threads_count);
 }
 
+uint64_t dnet_backend_io_queue_size(struct dnet_backend_io *io)
+{
+	uint64_t list_size = 0;
+	uint64_t threads_count = 0;
+
+	dnet_check_io_pool(&io->pool, &list_size, &threads_count);
+	return list_size;
+}
+
 static int dnet_check_io(struct dnet_io *io)
 {
 	uint64_t list_size = 0;
@@ -1076,8 +1284,33 @@ static void *dnet_io_process(void *data_)
 			dnet_state_dump_addr(st), dnet_dump_id(r->header), r, dnet_cmd_string(cmd->cmd), r->hsize, r->dsize, dnet_work_io_mode_str(pool->mode),
 			pool->io ? (ssize_t)pool->io->backend_id : (ssize_t)-1);
 
+		r->time.process_start = dnet_time_monotonic_us();
+		r->time.backend_id = pool->io ? (int)pool->io->backend_id : -1;
+		if (!(cmd->flags & DNET_FLAGS_REPLY)) {
+			r->time.cmd = *cmd;
+			dnet_io_req_current = r;
+		}
+
 		err = dnet_process_recv(pool->io, st, r);
 
+		dnet_io_req_current = NULL;
+
+		if (pool->io && !(cmd->flags & DNET_FLAGS_REPLY) && r->time.recv_finish) {
+			uint64_t now = dnet_time_monotonic_us();
+
+			pool->io->request_time_avg = (pool->io->request_time_avg * 7 + (now - r->time.recv_finish)) / 8;
+			pool->io->request_time_update = now;
+		}
+
+		/*
+		 * Request has not queued final reply (for example it did not need an ack),
+		 * so it is reported right after processing without send stage
+		 */
+		if (!(cmd->flags & DNET_FLAGS_REPLY) && !r->time.replied) {
+			r->time.process_finish = dnet_time_monotonic_us();
+			dnet_io_req_time_report(st, r);
+		}
+
 		dnet_log(n, DNET_LOG_DEBUG, "%s: %s: processed IO event: %p, cmd: %s",
 			dnet_state_dump_addr(st), dnet_dump_id(r->header), r, dnet_cmd_string(cmd->cmd));
 
@@ -1289,6 +1522,36 @@ void dnet_io_exit(struct dnet_node *n)
 	n->io = NULL;
 }
 
+static void dnet_work_pool_bind(struct dnet_node *n, struct dnet_work_pool_place *place)
+{
+	int i;
+
+	pthread_mutex_lock(&place->lock);
+	if (place->pool) {
+		for (i = 0; i < place->pool->num; ++i)
+			dnet_thread_bind(n, place->pool->wio_list[i].tid, DNET_THREAD_POOL_IO, -1);
+	}
+	pthread_mutex_unlock(&place->lock);
+}
+
+/*
+ * Network threads and node's io pools are started by dnet_node_create() before
+ * server configuration is attached to the node, so they are bound to configured CPUs afterwards
+ */
+void dnet_io_bind(struct dnet_node *n)
+{
+	int i;
+
+	if (!dnet_thread_bind)
+		return;
+
+	for (i = 0; i < n->io->net_thread_num; ++i)
+		dnet_thread_bind(n, n->io->net[i].tid, DNET_THREAD_POOL_NET, -1);
+
+	dnet_work_pool_bind(n, &n->io->pool.recv_pool);
+	dnet_work_pool_bind(n, &n->io->pool.recv_pool_nb);
+}
+
 int dnet_backend_io_init(struct dnet_node *n, struct dnet_backend_io *io, int io_thread_num, int nonblocking_io_thread_num)
 {
 	int err = 0;
@@ -0,0 +1,324 @@
+/*
+ * Copyright 2008+ Evgeniy Polyakov <zbr@ioremap.net>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Server side of DNET_IO_FLAGS_REPLICATE writes.
+ *
+ * Client sends the object only to the first group. Node of this group writes it
+ * to the rest groups and relays result of every group to the client as a reply
+ * with DNET_FLAGS_MORE. When all groups have answered, the transaction is completed
+ * by the empty reply without DNET_FLAGS_MORE.
+ */
+
+#include <sys/types.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elliptics.h"
+
+#include "elliptics/packet.h"
+#include "elliptics/interface.h"
+
+struct dnet_replicate {
+	/* one reference per remote group and one for the node executing the write */
+	atomic_t		refcnt;
+	struct dnet_net_state	*st;
+	struct dnet_cmd		cmd;
+};
+
+static void dnet_replicate_put(struct dnet_replicate *rep)
+{
+	if (!atomic_dec_and_test(&rep->refcnt))
+		return;
+
+	rep->cmd.flags &= ~DNET_FLAGS_NEED_ACK;
+	rep->cmd.status = 0;
+	rep->cmd.size = 0;
+
+	dnet_send_reply(rep->st, &rep->cmd, NULL, 0, 0);
+
+	dnet_state_put(rep->st);
+	free(rep);
+}
+
+/*
+ * Sends result of the single group to the client as a part of its transaction
+ */
+static int dnet_replicate_relay(struct dnet_replicate *rep, struct dnet_cmd *cmd,
+		const void *header, unsigned int hsize, const void *data, unsigned int dsize)
+{
+	struct dnet_cmd reply = rep->cmd;
+
+	reply.id = cmd->id;
+	reply.status = cmd->status;
+	reply.backend_id = cmd->backend_id;
+	reply.flags &= ~DNET_FLAGS_NEED_ACK;
+
+	return dnet_send_reply_data(rep->st, &reply, header, hsize, data, dsize, 1);
+}
+
+static int dnet_replicate_complete(struct dnet_addr *addr __unused, struct dnet_cmd *cmd, void *priv)
+{
+	struct dnet_replicate *rep = priv;
+
+	if (is_trans_destroyed(cmd)) {
+		dnet_replicate_put(rep);
+		return 0;
+	}
+
+	return dnet_replicate_relay(rep, cmd, NULL, 0, cmd + 1, cmd->size);
+}
+
+/*
+ * Fake state which collects replies of locally executed commands, the same as local_session uses
+ */
+static struct dnet_net_state *dnet_replicate_state_create(struct dnet_node *n)
+{
+	struct dnet_net_state *st;
+	struct dnet_addr addr;
+
+	st = malloc(sizeof(struct dnet_net_state));
+	if (!st)
+		return NULL;
+
+	memset(&addr, 0, sizeof(struct dnet_addr));
+	memset(st, 0, sizeof(struct dnet_net_state));
+
+	st->__need_exit = -1;
+	st->write_s = -1;
+	st->read_s = -1;
+	st->accept_s = -1;
+
+	if (dnet_state_micro_init(st, n, &addr, 0)) {
+		free(st);
+		return NULL;
+	}
+
+	return dnet_state_get(st);
+}
+
+static void dnet_replicate_state_destroy(struct dnet_net_state *st)
+{
+	dnet_state_put(st);
+	dnet_state_put(st);
+}
+
+/*
+ * Writes object into local @backend and relays replies collected by @local state to the client.
+ * @data is restored from @io before the write, since io attributes are converted in place.
+ */
+static void dnet_replicate_local(struct dnet_replicate *rep, struct dnet_backend_io *backend,
+		struct dnet_net_state *local, int group_id, void *data, const struct dnet_io_attr *io)
+{
+	struct dnet_io_req *r, *tmp;
+	struct dnet_cmd cmd = rep->cmd, status, *c;
+	void *header, *payload;
+	uint64_t hsize, dsize;
+
+	cmd.id.group_id = group_id;
+
+	if (!backend) {
+		cmd.status = -ENXIO;
+		cmd.size = 0;
+		dnet_replicate_relay(rep, &cmd, NULL, 0, NULL, 0);
+		return;
+	}
+
+	cmd.backend_id = backend->backend_id;
+
+	memcpy(data, io, sizeof(struct dnet_io_attr));
+
+	dnet_process_cmd_raw(backend, local, &cmd, data, 0);
+
+	list_for_each_entry_safe(r, tmp, &local->send_list, req_entry) {
+		header = r->header;
+		hsize = r->hsize;
+		payload = r->data;
+		dsize = r->dsize;
+
+		/* plain dnet_send() places the whole packet into data */
+		if (!header) {
+			header = payload;
+			hsize = dsize;
+			payload = NULL;
+			dsize = 0;
+		}
+
+		if (hsize >= sizeof(struct dnet_cmd)) {
+			c = header;
+			status = *c;
+			dnet_convert_cmd(&status);
+
+			dnet_replicate_relay(rep, &status, c + 1, hsize - sizeof(struct dnet_cmd), payload, dsize);
+		}
+
+		list_del(&r->req_entry);
+		dnet_io_req_free(r);
+	}
+}
+
+int dnet_process_replicate(struct dnet_backend_io *backend, struct dnet_net_state *st, struct dnet_cmd *cmd, void *data)
+{
+	struct dnet_node *n = st->n;
+	struct dnet_io_attr *io = data, orig_io;
+	struct dnet_io_replicas *replicas = (struct dnet_io_replicas *)(io + 1);
+	struct dnet_replicate *rep;
+	struct dnet_net_state *local = NULL, *remote;
+	struct dnet_backend_io *local_backend;
+	struct dnet_session *s = NULL;
+	struct dnet_io_control ctl;
+	struct dnet_id id;
+	uint64_t rsize;
+	int *groups = NULL;
+	int num, i, err;
+
+	if (cmd->size < sizeof(struct dnet_io_attr) + sizeof(struct dnet_io_replicas)) {
+		err = -EINVAL;
+		goto err_out_exit;
+	}
+
+	num = dnet_bswap32(replicas->num);
+	rsize = sizeof(struct dnet_io_replicas) + (uint64_t)num * sizeof(int);
+	if (num < 0 || cmd->size < sizeof(struct dnet_io_attr) + rsize) {
+		err = -EINVAL;
+		goto err_out_exit;
+	}
+
+	groups = malloc((num + 1) * sizeof(int));
+	if (!groups) {
+		err = -ENOMEM;
+		goto err_out_exit;
+	}
+
+	for (i = 0; i < num; ++i)
+		groups[i] = dnet_bswap32(replicas->groups[i]);
+
+	/*
+	 * Cut the list of groups: io attributes are moved right before the data,
+	 * so the rest of processing sees usual write
+	 */
+	memcpy(&orig_io, io, sizeof(struct dnet_io_attr));
+	dnet_convert_io_attr(&orig_io);
+	orig_io.flags &= ~DNET_IO_FLAGS_REPLICATE;
+
+	data += rsize;
+	cmd->size -= rsize;
+
+	rep = malloc(sizeof(struct dnet_replicate));
+	if (!rep) {
+		err = -ENOMEM;
+		goto err_out_free;
+	}
+
+	atomic_init(&rep->refcnt, 1);
+	rep->st = dnet_state_get(st);
+	rep->cmd = *cmd;
+
+	local = dnet_replicate_state_create(n);
+	if (!local) {
+		err = -ENOMEM;
+		goto err_out_put;
+	}
+
+	s = dnet_session_create(n);
+	if (!s) {
+		err = -ENOMEM;
+		goto err_out_put;
+	}
+	dnet_session_set_trace_id(s, cmd->trace_id);
+
+	memset(&ctl, 0, sizeof(struct dnet_io_control));
+	ctl.io = orig_io;
+	ctl.data = data + sizeof(struct dnet_io_attr);
+	ctl.fd = -1;
+	ctl.cmd = DNET_CMD_WRITE;
+	ctl.cflags = DNET_FLAGS_NEED_ACK | (cmd->flags & (DNET_FLAGS_NOCACHE | DNET_FLAGS_TRACE_BIT));
+	ctl.complete = dnet_replicate_complete;
+	ctl.priv = rep;
+
+	/* remote groups are sent first, so their writes run in parallel with the local ones */
+	for (i = 0; i < num; ++i) {
+		dnet_setup_id(&id, groups[i], cmd->id.id);
+
+		remote = dnet_state_get_first(n, &id);
+		dnet_state_put(remote);
+
+		if (remote == n->st) {
+			continue;
+		}
+
+		dnet_setup_id(&ctl.id, groups[i], cmd->id.id);
+
+		atomic_inc(&rep->refcnt);
+		dnet_io_trans_alloc_send(s, &ctl);
+
+		groups[i] = -1;
+	}
+
+	dnet_convert_io_attr(&orig_io);
+
+	dnet_replicate_local(rep, backend, local, cmd->id.group_id, data, &orig_io);
+
+	/* other groups of this node */
+	for (i = 0; i < num; ++i) {
+		if (groups[i] < 0)
+			continue;
+
+		dnet_setup_id(&id, groups[i], cmd->id.id);
+
+		local_backend = dnet_backend_io_get(n, dnet_state_search_backend(n, &id));
+
+		dnet_replicate_local(rep, local_backend, local, groups[i], data, &orig_io);
+
+		if (local_backend)
+			dnet_backend_io_put(local_backend);
+	}
+
+	dnet_log(n, DNET_LOG_INFO, "%s: replicated write: groups: %d, size: %llu",
+			dnet_dump_id(&cmd->id), num + 1, (unsigned long long)dnet_bswap64(orig_io.size));
+
+	err = 0;
+
+err_out_put:
+	if (s)
+		dnet_session_destroy(s);
+	if (local)
+		dnet_replicate_state_destroy(local);
+
+	if (err) {
+		dnet_state_put(rep->st);
+		free(rep);
+	} else {
+		dnet_replicate_put(rep);
+	}
+err_out_free:
+	free(groups);
+err_out_exit:
+	/* nothing has been written, transaction is completed by the error reply */
+	if (err) {
+		dnet_log(n, DNET_LOG_ERROR, "%s: replicated write failed: %d", dnet_dump_id(&cmd->id), err);
+
+		cmd->flags |= DNET_FLAGS_NEED_ACK;
+		dnet_send_ack(st, cmd, err, 0);
+	}
+	return err;
+}
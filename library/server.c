@@ -101,6 +101,10 @@ struct dnet_node *dnet_server_node_create(struct dnet_config_data *cfg_data)
 		goto err_out_exit;
 
 	n->config_data = cfg_data;
+	n->zerocopy_threshold = cfg_data->zerocopy_threshold;
+	n->inline_commands = cfg_data->inline_commands;
+	n->coalesce_reads = cfg_data->coalesce_reads;
+	dnet_io_bind(n);
 
 	err = dnet_server_io_init(n);
 	if (err)
@@ -117,14 +121,14 @@ struct dnet_node *dnet_server_node_create(struct dnet_config_data *cfg_data)
 	if (!n->notify_hash_size) {
 		n->notify_hash_size = DNET_DEFAULT_NOTIFY_HASH_SIZE;
 
-		err = dnet_notify_init(n);
-		if (err)
-			goto err_out_monitor_destroy;
-
 		dnet_log(n, DNET_LOG_NOTICE, "No notify hash size provided, using default %d.",
 				n->notify_hash_size);
 	}
 
+	err = dnet_notify_init(n);
+	if (err)
+		goto err_out_monitor_destroy;
+
 	err = dnet_local_addr_add(n, addrs, addr_num);
 	if (err)
 		goto err_out_notify_exit;
@@ -171,10 +175,17 @@ struct dnet_node *dnet_server_node_create(struct dnet_config_data *cfg_data)
 			goto err_out_state_destroy;
 		}
 
+		n->defrag = dnet_defrag_scheduler_create(n, cfg_data->defrag_concurrency);
+		if (!n->defrag) {
+			err = -ENOMEM;
+			dnet_log(n, DNET_LOG_ERROR, "failed to create defragmentation scheduler: %s %d", strerror(-err), err);
+			goto err_out_state_destroy;
+		}
+
 		err = dnet_backend_init_all(n);
 		if (err) {
 			dnet_log(n, DNET_LOG_ERROR, "failed to init backends: %s %d", strerror(-err), err);
-			goto err_out_state_destroy;
+			goto err_out_defrag_destroy;
 		}
 
 		if (!cfg->srw.config) {
@@ -198,6 +209,9 @@ struct dnet_node *dnet_server_node_create(struct dnet_config_data *cfg_data)
 err_out_backends_cleanup:
 	dnet_set_need_exit(n);
 	dnet_backend_cleanup_all(n);
+err_out_defrag_destroy:
+	dnet_defrag_scheduler_destroy(n->defrag);
+	n->defrag = NULL;
 err_out_state_destroy:
 	dnet_state_put(n->st);
 err_out_route_list_destroy:
@@ -234,6 +248,10 @@ void dnet_server_node_destroy(struct dnet_node *n)
 	dnet_route_list_destroy(n->route);
 	n->route = NULL;
 
+	/* scheduler starts defragmentation of enabled backends, so it is stopped before them */
+	dnet_defrag_scheduler_destroy(n->defrag);
+	n->defrag = NULL;
+
 	dnet_backend_cleanup_all(n);
 
 	dnet_srw_cleanup(n);
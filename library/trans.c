@@ -271,6 +271,8 @@ void dnet_trans_destroy(struct dnet_trans *t)
 		char str[64];
 		char io_buf[1024] = "";
 		struct tm tm;
+		/* time formatting below is only needed for the log message */
+		int log_enabled = dnet_log_enabled(st->n->log, DNET_LOG_INFO);
 
 		if (t->cmd.status != -ETIMEDOUT) {
 			if (st->stall) {
@@ -281,8 +283,10 @@ void dnet_trans_destroy(struct dnet_trans *t)
 			st->stall = 0;
 		}
 
-		localtime_r((time_t *)&t->start.tv_sec, &tm);
-		strftime(str, sizeof(str), "%F %R:%S", &tm);
+		if (log_enabled) {
+			localtime_r((time_t *)&t->start.tv_sec, &tm);
+			strftime(str, sizeof(str), "%F %R:%S", &tm);
+		}
 
 		if (((t->command == DNET_CMD_READ) || (t->command == DNET_CMD_WRITE)) && (t->alloc_size >= sizeof(struct dnet_cmd) + sizeof(struct dnet_io_attr))) {
 			struct dnet_cmd *local_cmd = (struct dnet_cmd *)(t + 1);
@@ -297,19 +301,21 @@ void dnet_trans_destroy(struct dnet_trans *t)
 				st->weight = 1.0 / ((1.0 / st->weight + norm) / 2.0);
 			}
 
-			io_tv.tv_sec = local_io->timestamp.tsec;
-			io_tv.tv_usec = local_io->timestamp.tnsec / 1000;
+			if (log_enabled) {
+				io_tv.tv_sec = local_io->timestamp.tsec;
+				io_tv.tv_usec = local_io->timestamp.tnsec / 1000;
 
-			localtime_r((time_t *)&io_tv.tv_sec, &tm);
-			strftime(time_str, sizeof(time_str), "%F %R:%S", &tm);
+				localtime_r((time_t *)&io_tv.tv_sec, &tm);
+				strftime(time_str, sizeof(time_str), "%F %R:%S", &tm);
 
-			snprintf(io_buf, sizeof(io_buf), ", ioflags: %s, io-offset: %llu, io-size: %llu/%llu, "
-					"io-user-flags: 0x%llx, ts: %ld.%06ld '%s.%06lu', weight: %f -> %f",
-				dnet_flags_dump_ioflags(local_io->flags),
-				(unsigned long long)local_io->offset, (unsigned long long)local_io->size, (unsigned long long)local_io->total_size,
-				(unsigned long long)local_io->user_flags,
-				io_tv.tv_sec, io_tv.tv_usec, time_str, io_tv.tv_usec,
-				old_weight, st->weight);
+				snprintf(io_buf, sizeof(io_buf), ", ioflags: %s, io-offset: %llu, io-size: %llu/%llu, "
+						"io-user-flags: 0x%llx, ts: %ld.%06ld '%s.%06lu', weight: %f -> %f",
+					dnet_flags_dump_ioflags(local_io->flags),
+					(unsigned long long)local_io->offset, (unsigned long long)local_io->size, (unsigned long long)local_io->total_size,
+					(unsigned long long)local_io->user_flags,
+					io_tv.tv_sec, io_tv.tv_usec, time_str, io_tv.tv_usec,
+					old_weight, st->weight);
+			}
 		}
 
 		dnet_log(st->n, DNET_LOG_INFO, "%s: destruction %s trans: %llu, reply: %d, st: %s, stall: %d, "
@@ -56,6 +56,26 @@ static void fill_backend_backend(rapidjson::Value &stat_value,
 	free(json_stat);
 }
 
+/*
+ * Gets statistics of background verification of backend's data and writes it to "scrub" section
+ */
+static void fill_backend_scrub(rapidjson::Value &stat_value,
+                               rapidjson::Document::AllocatorType &allocator,
+                               const struct dnet_backend_io &backend) {
+	char *json_stat = NULL;
+	size_t size = 0;
+	struct dnet_backend_callbacks *cb = backend.cb;
+	if (cb->scrub_stat_json && !cb->scrub_stat_json(cb->command_private, &json_stat, &size) && json_stat && size) {
+		rapidjson::Document scrub_value(&allocator);
+		scrub_value.Parse<0>(json_stat);
+		stat_value.AddMember("scrub",
+		                     static_cast<rapidjson::Value&>(scrub_value),
+		                     allocator);
+	}
+
+	free(json_stat);
+}
+
 static void dump_list_stats(rapidjson::Value &stat, list_stat &list_stats, rapidjson::Document::AllocatorType &allocator) {
 	stat.AddMember("current_size", list_stats.list_size, allocator)
 	    .AddMember("min", list_stats.min_list_size, allocator)
@@ -164,6 +184,7 @@ static rapidjson::Value& backend_stats_json(uint64_t categories,
 
 		if (categories & DNET_MONITOR_BACKEND) {
 			fill_backend_backend(stat_value, allocator, backend);
+			fill_backend_scrub(stat_value, allocator, backend);
 		}
 		if (categories & DNET_MONITOR_IO) {
 			fill_backend_io(stat_value, allocator, backend);
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2013+ Kirill Smorodinnikov <shaitkir@gmail.com>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hot_keys.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include <string.h>
+#include <time.h>
+
+#include "elliptics/interface.h"
+
+namespace ioremap { namespace monitor {
+
+/*
+ * Number of rows in count-min sketch
+ */
+static const size_t sketch_depth = 4;
+
+static uint64_t coarse_monotonic_ms() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * 64-bit finalizer of MurmurHash3
+ */
+static inline uint64_t mix(uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+size_t hot_keys_tracker::id_hash::operator() (const dnet_raw_id &id) const {
+	size_t ret = 0;
+	memcpy(&ret, id.id, std::min(sizeof(ret), sizeof(id.id)));
+	return ret;
+}
+
+bool hot_keys_tracker::id_equal::operator() (const dnet_raw_id &lhs, const dnet_raw_id &rhs) const {
+	return memcmp(lhs.id, rhs.id, sizeof(lhs.id)) == 0;
+}
+
+hot_keys_tracker::hot_keys_tracker(size_t top_size, size_t width)
+: m_top_size(top_size)
+, m_min_requests(0)
+{
+	size_t real_width = 1;
+	while (real_width < width)
+		real_width <<= 1;
+	m_width_mask = real_width - 1;
+
+	m_requests.reset(new std::atomic<uint64_t>[sketch_depth * real_width]);
+	m_bytes.reset(new std::atomic<uint64_t>[sketch_depth * real_width]);
+	for (size_t i = 0; i < sketch_depth * real_width; ++i) {
+		m_requests[i] = 0;
+		m_bytes[i] = 0;
+	}
+	m_top.reserve(top_size + 1);
+}
+
+/*
+ * Uses double hashing: id is folded into two 64-bit words
+ * and i-th row uses mix(h1 + i * h2) as position
+ */
+void hot_keys_tracker::position(const dnet_raw_id &id, size_t *positions) const {
+	uint64_t h1 = 0, h2 = 0;
+	for (size_t offset = 0; offset < sizeof(id.id); offset += sizeof(uint64_t)) {
+		uint64_t word = 0;
+		memcpy(&word, id.id + offset, std::min(sizeof(word), sizeof(id.id) - offset));
+		if ((offset / sizeof(uint64_t)) & 1)
+			h2 ^= word;
+		else
+			h1 ^= word;
+	}
+	h2 = mix(h2) | 1;
+
+	for (size_t i = 0; i < sketch_depth; ++i) {
+		positions[i] = i * (m_width_mask + 1) + (mix(h1 + i * h2) & m_width_mask);
+	}
+}
+
+void hot_keys_tracker::update(const dnet_raw_id &id, uint64_t size) {
+	size_t positions[sketch_depth];
+	position(id, positions);
+
+	uint64_t requests = std::numeric_limits<uint64_t>::max();
+	uint64_t bytes = std::numeric_limits<uint64_t>::max();
+	for (size_t i = 0; i < sketch_depth; ++i) {
+		requests = std::min(requests, m_requests[positions[i]].fetch_add(1, std::memory_order_relaxed) + 1);
+		bytes = std::min(bytes, m_bytes[positions[i]].fetch_add(size, std::memory_order_relaxed) + size);
+	}
+
+	/*
+	 * Every key in the top has at least m_min_requests requests and its estimate never decreases,
+	 * so the key with less requests can't be in the top and can't replace anyone there
+	 */
+	if (requests < m_min_requests.load(std::memory_order_relaxed))
+		return;
+
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	auto it = m_top.find(id);
+	if (it != m_top.end()) {
+		it->second.requests = std::max(it->second.requests, requests);
+		it->second.bytes = std::max(it->second.bytes, bytes);
+		return;
+	}
+
+	if (m_top.size() >= m_top_size) {
+		auto min = m_top.begin();
+		for (auto jt = m_top.begin(); jt != m_top.end(); ++jt) {
+			if (jt->second.requests < min->second.requests)
+				min = jt;
+		}
+
+		if (min == m_top.end() || min->second.requests >= requests)
+			return;
+
+		m_top.erase(min);
+	}
+
+	hot_key &key = m_top[id];
+	key.id = id;
+	key.requests = requests;
+	key.bytes = bytes;
+
+	if (m_top.size() >= m_top_size) {
+		uint64_t min_requests = std::numeric_limits<uint64_t>::max();
+		for (auto jt = m_top.begin(); jt != m_top.end(); ++jt) {
+			min_requests = std::min(min_requests, jt->second.requests);
+		}
+		m_min_requests.store(min_requests, std::memory_order_relaxed);
+	}
+}
+
+std::vector<hot_key> hot_keys_tracker::top() const {
+	std::vector<hot_key> ret;
+	{
+		std::unique_lock<std::mutex> guard(m_lock);
+		ret.reserve(m_top.size());
+		for (auto it = m_top.begin(); it != m_top.end(); ++it) {
+			ret.push_back(it->second);
+		}
+	}
+
+	std::sort(ret.begin(), ret.end(), [] (const hot_key &lhs, const hot_key &rhs) {
+		return lhs.requests > rhs.requests;
+	});
+	return ret;
+}
+
+void hot_keys_tracker::reset() {
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	for (size_t i = 0; i < sketch_depth * (m_width_mask + 1); ++i) {
+		m_requests[i].store(0, std::memory_order_relaxed);
+		m_bytes[i].store(0, std::memory_order_relaxed);
+	}
+	m_top.clear();
+	m_min_requests.store(0, std::memory_order_relaxed);
+}
+
+hot_keys::backend_hot_keys::backend_hot_keys(size_t top_size, size_t sketch_width)
+: read(top_size, sketch_width)
+, write(top_size, sketch_width)
+, window_start(coarse_monotonic_ms())
+, last_duration(0)
+{}
+
+hot_keys::hot_keys(size_t backends_count, size_t top_size, size_t sketch_width, uint64_t window)
+: m_window(window)
+{
+	if (!top_size)
+		return;
+
+	m_backends.reserve(backends_count);
+	for (size_t i = 0; i < backends_count; ++i) {
+		m_backends.emplace_back(new backend_hot_keys(top_size, sketch_width));
+	}
+}
+
+void hot_keys::update(size_t backend_id, int cmd, const dnet_raw_id &id, uint64_t size) {
+	if (backend_id >= m_backends.size())
+		return;
+
+	backend_hot_keys &backend = *m_backends[backend_id];
+	check_window(backend, coarse_monotonic_ms());
+
+	switch (cmd) {
+	case DNET_CMD_READ:
+		backend.read.update(id, size);
+		break;
+	case DNET_CMD_WRITE:
+		backend.write.update(id, size);
+		break;
+	default:
+		break;
+	}
+}
+
+void hot_keys::check_window(backend_hot_keys &backend, uint64_t now) {
+	uint64_t start = backend.window_start.load();
+	if (now - start < m_window)
+		return;
+
+	// only one thread finishes the window
+	if (!backend.window_start.compare_exchange_strong(start, now))
+		return;
+
+	std::unique_lock<std::mutex> guard(backend.last_lock);
+	backend.last_read = backend.read.top();
+	backend.last_write = backend.write.top();
+	backend.last_duration = now - start;
+	backend.read.reset();
+	backend.write.reset();
+}
+
+static void hot_keys_json(const std::vector<hot_key> &keys, uint64_t duration,
+                          rapidjson::Value &stat_value,
+                          rapidjson::Document::AllocatorType &allocator) {
+	const double seconds = duration ? duration / 1000. : 1.;
+	char id_str[DNET_ID_SIZE * 2 + 1];
+
+	for (auto it = keys.begin(); it != keys.end(); ++it) {
+		rapidjson::Value key_value(rapidjson::kObjectType);
+
+		dnet_dump_id_len_raw(it->id.id, DNET_ID_SIZE, id_str);
+		rapidjson::Value id_value;
+		id_value.SetString(id_str, allocator);
+
+		key_value.AddMember("id", id_value, allocator);
+		key_value.AddMember("requests", it->requests, allocator);
+		key_value.AddMember("bytes", it->bytes, allocator);
+		key_value.AddMember("requests_rate", it->requests / seconds, allocator);
+		key_value.AddMember("bytes_rate", it->bytes / seconds, allocator);
+		stat_value.PushBack(key_value, allocator);
+	}
+}
+
+rapidjson::Value& hot_keys::report(rapidjson::Value &stat_value,
+                                   rapidjson::Document::AllocatorType &allocator) {
+	const uint64_t now = coarse_monotonic_ms();
+
+	for (size_t backend_id = 0; backend_id < m_backends.size(); ++backend_id) {
+		backend_hot_keys &backend = *m_backends[backend_id];
+		check_window(backend, now);
+
+		std::unique_lock<std::mutex> guard(backend.last_lock);
+		if (backend.last_read.empty() && backend.last_write.empty())
+			continue;
+
+		rapidjson::Value backend_value(rapidjson::kObjectType);
+		backend_value.AddMember("duration", backend.last_duration, allocator);
+
+		rapidjson::Value read_value(rapidjson::kArrayType);
+		hot_keys_json(backend.last_read, backend.last_duration, read_value, allocator);
+		backend_value.AddMember("read", read_value, allocator);
+
+		rapidjson::Value write_value(rapidjson::kArrayType);
+		hot_keys_json(backend.last_write, backend.last_duration, write_value, allocator);
+		backend_value.AddMember("write", write_value, allocator);
+
+		stat_value.AddMember(std::to_string(static_cast<unsigned long long>(backend_id)).c_str(),
+		                     allocator, backend_value, allocator);
+	}
+
+	return stat_value;
+}
+
+}} /* namespace ioremap::monitor */
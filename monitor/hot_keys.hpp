@@ -0,0 +1,191 @@
+/*
+ * Copyright 2013+ Kirill Smorodinnikov <shaitkir@gmail.com>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DNET_MONITOR_HOT_KEYS_HPP
+#define __DNET_MONITOR_HOT_KEYS_HPP
+
+#if __GNUC__ == 4 && __GNUC_MINOR__ < 5
+#  include <cstdatomic>
+#else
+#  include <atomic>
+#endif
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+#include "elliptics/packet.h"
+
+namespace ioremap { namespace monitor {
+
+/*!
+ * \internal
+ *
+ * Statistics of single hot key
+ */
+struct hot_key {
+	dnet_raw_id	id;
+	/*!
+	 * \internal
+	 *
+	 * Estimated number of requests to the key
+	 */
+	uint64_t	requests;
+	/*!
+	 * \internal
+	 *
+	 * Estimated number of bytes read or written by requests to the key
+	 */
+	uint64_t	bytes;
+};
+
+/*!
+ * \internal
+ *
+ * Heavy-hitters tracker: count-min sketch of requests and bytes
+ * plus the list of \a top_size keys with maximum number of requests.
+ * Updates of keys which are definitely not in the top are lock-free.
+ */
+class hot_keys_tracker {
+public:
+	/*!
+	 * \internal
+	 *
+	 * Constructor: initializes tracker which keeps \a top_size hottest keys
+	 * and uses sketch with \a width counters (rounded up to power of two) per row
+	 */
+	hot_keys_tracker(size_t top_size, size_t width);
+
+	/*!
+	 * \internal
+	 *
+	 * Accounts request to key \a id which has read or written \a size bytes
+	 */
+	void update(const dnet_raw_id &id, uint64_t size);
+
+	/*!
+	 * \internal
+	 *
+	 * Returns current top sorted by number of requests
+	 */
+	std::vector<hot_key> top() const;
+
+	/*!
+	 * \internal
+	 *
+	 * Clears the sketch and the top
+	 */
+	void reset();
+
+private:
+	struct id_hash {
+		size_t operator() (const dnet_raw_id &id) const;
+	};
+
+	struct id_equal {
+		bool operator() (const dnet_raw_id &lhs, const dnet_raw_id &rhs) const;
+	};
+
+	void position(const dnet_raw_id &id, size_t *positions) const;
+
+	size_t					m_top_size;
+	size_t					m_width_mask;
+	std::unique_ptr<std::atomic<uint64_t>[]>	m_requests;
+	std::unique_ptr<std::atomic<uint64_t>[]>	m_bytes;
+
+	mutable std::mutex			m_lock;
+	/*!
+	 * \internal
+	 *
+	 * Minimum number of requests among keys in the top,
+	 * it is zero while the top is not full
+	 */
+	std::atomic<uint64_t>			m_min_requests;
+	std::unordered_map<dnet_raw_id, hot_key, id_hash, id_equal>	m_top;
+};
+
+/*!
+ * \internal
+ *
+ * Hot keys of all backends of the node
+ * Statistics are collected during time window and the last finished window is reported.
+ */
+class hot_keys {
+public:
+	/*!
+	 * \internal
+	 *
+	 * Constructor: initializes trackers for \a backends_count backends
+	 * which keep \a top_size keys collected during \a window milliseconds
+	 * \a top_size equal to zero disables tracking
+	 */
+	hot_keys(size_t backends_count, size_t top_size, size_t sketch_width, uint64_t window);
+
+	/*!
+	 * \internal
+	 *
+	 * Accounts command \a cmd to key \a id which was executed by backend \a backend_id
+	 * and has read or written \a size bytes
+	 */
+	void update(size_t backend_id, int cmd, const dnet_raw_id &id, uint64_t size);
+
+	/*!
+	 * \internal
+	 *
+	 * Fills \a stat_value by hot keys of all backends and returns it
+	 */
+	rapidjson::Value& report(rapidjson::Value &stat_value,
+	                         rapidjson::Document::AllocatorType &allocator);
+
+private:
+	struct backend_hot_keys {
+		backend_hot_keys(size_t top_size, size_t sketch_width);
+
+		hot_keys_tracker	read;
+		hot_keys_tracker	write;
+
+		/*!
+		 * \internal
+		 *
+		 * Start of the current window in milliseconds
+		 */
+		std::atomic<uint64_t>	window_start;
+
+		std::mutex		last_lock;
+		uint64_t		last_duration;
+		std::vector<hot_key>	last_read;
+		std::vector<hot_key>	last_write;
+	};
+
+	/*!
+	 * \internal
+	 *
+	 * Finishes current window of \a backend if it is older than \a m_window
+	 */
+	void check_window(backend_hot_keys &backend, uint64_t now);
+
+	uint64_t						m_window;
+	std::vector<std::unique_ptr<backend_hot_keys>>		m_backends;
+};
+
+}} /* namespace ioremap::monitor */
+
+#endif /* __DNET_MONITOR_HOT_KEYS_HPP */
@@ -30,6 +30,7 @@ namespace status_strings {
 const std::string not_found = "HTTP/1.1 404 Not Found\r\n";
 const std::string bad_request = "HTTP/1.1 400 Bad Request\r\n";
 const std::string ok = "HTTP/1.1 200 OK\r\n";
+const std::string service_unavailable = "HTTP/1.1 503 Service Unavailable\r\n";
 }
 
 namespace content_strings {
@@ -41,6 +42,10 @@ const std::string bad_request = "<html>\n"
 	"<head><title>Bad Request</title></head>\n"
 	"<body><h1>400 Bad Request</h1></body>\n"
 	"</html>\n";
+const std::string service_unavailable = "<html>\n"
+	"<head><title>Service Unavailable</title></head>\n"
+	"<body><h1>503 Service Unavailable</h1></body>\n"
+	"</html>\n";
 const std::string list = "<html>\n"
 	"<body>\n"
 	"GET <a href='/list'>/list</a> - Retrieves a list of acceptable statistics<br/>\n"
@@ -52,11 +57,16 @@ const std::string list = "<html>\n"
 	"GET <a href='/backend'>/backend</a> - Retrieves statistics about backend<br/>\n"
 	"GET <a href='/procfs'>/procfs</a> - Retrieves system statistics about process<br/>\n"
 	"GET <a href='/stats'>/stats</a> - Retrieves in-process runtime statistics<br/>\n"
+	"GET <a href='/hot_keys'>/hot_keys</a> - Retrieves the most requested keys of each backend<br/>\n"
+	"GET <a href='/request_stages'>/request_stages</a> - Retrieves time spent by requests at each stage of processing<br/>\n"
+	"GET <a href='/slow_requests'>/slow_requests</a> - Retrieves the last slow and randomly sampled requests<br/>\n"
+	"Append ?since=VERSION to any of them to retrieve only values changed since report with given version<br/>\n"
 	"</body>\n"
 	"</html>\n";
 }
 
 const std::string categories_url = "/?categories=";
+const std::string since_parameter = "since=";
 
 const std::map<std::string, uint64_t> handlers = {
 	{"/all", DNET_MONITOR_ALL},
@@ -66,63 +76,106 @@ const std::map<std::string, uint64_t> handlers = {
 	{"/io_histograms", DNET_MONITOR_IO_HISTOGRAMS},
 	{"/backend", DNET_MONITOR_BACKEND},
 	{"/procfs", DNET_MONITOR_PROCFS},
-	{"/stats", DNET_MONITOR_STATS}
+	{"/stats", DNET_MONITOR_STATS},
+	{"/hot_keys", DNET_MONITOR_HOT_KEYS},
+	{"/request_stages", DNET_MONITOR_REQUEST_STAGES},
+	{"/slow_requests", DNET_MONITOR_SLOW_REQUESTS}
 };
 
 /*!
- * Generates HTTP response for @req category with @content
+ * Parsed statistics request
  */
-std::string make_reply(uint64_t req, std::string content = "") {
-	std::stringstream ret;
-	std::string content_type = "application/json";
-	if (req == 0) {
-		ret << status_strings::ok;
-		content = content_strings::list;
-		content_type = "text/html";
-	} else {
-		ret << status_strings::ok;
-	}
+struct request {
+	/*!
+	 * Requested categories, 0 means list of acceptable statistics
+	 */
+	uint64_t	categories;
+	/*!
+	 * Version of the report since which changes are requested, 0 means full report
+	 */
+	uint64_t	since;
+};
 
-	ret << "Content-Type: " << content_type << "\r\n"
-		<< "Content-Length: " << std::to_string((long long unsigned int)content.size()) << "\r\n"
-		<< (req != 0 ? "Content-Encoding: deflate\r\n" : "")
+/*!
+ * Generates HTTP response header with @status for content of @content_type and @content_size,
+ * @deflate shows that content is compressed
+ */
+std::string make_header(const std::string &status, const std::string &content_type,
+                        size_t content_size, bool deflate) {
+	std::stringstream ret;
+	ret << status
+		<< "Content-Type: " << content_type << "\r\n"
+		<< "Content-Length: " << std::to_string((long long unsigned int)content_size) << "\r\n"
+		<< (deflate ? "Content-Encoding: deflate\r\n" : "")
 		<< "Connection: close\r\n"
-		<< "\r\n"
-		<< content;
+		<< "\r\n";
 
 	return ret.str();
 }
 
+/*!
+ * Generates HTTP response for @req category with @content
+ */
+std::string make_reply(uint64_t req, std::string content = "") {
+	if (req == 0)
+		return make_header(status_strings::ok, "text/html", content_strings::list.size(), false) + content_strings::list;
+
+	return make_header(status_strings::ok, "application/json", content.size(), true) + content;
+}
+
+/*!
+ * Parses unsigned integer from [@begin, @end), returns 0 if it is malformed
+ */
+uint64_t parse_number(const char *begin, const char *end) {
+	try {
+		return boost::lexical_cast<uint64_t>(std::string(begin, end));
+	} catch(...) {
+		printf("Couldn't parse number: %s\n", std::string(begin, end).c_str());
+	}
+	return 0;
+}
+
 /*!
  * Parses simple HTTP request and determines requested category
+ * and version of the report since which changes are requested
  * @packet - HTTP request packet
  * @size - size of HTTP request packet
  */
-uint64_t parse(const char* packet, size_t size) {
+request parse(const char* packet, size_t size) {
+	request ret = {0, 0};
+
 	const char* end = packet + size;
 	const char *method_end = std::find(packet, end, ' ');
 	if (method_end >= end || packet == method_end)
-		return 0;
+		return ret;
 
 	const char *url_begin = method_end + 1;
 	const char *url_end = std::find(url_begin, end, ' ');
 	if (url_end >= end)
-		return 0;
+		return ret;
+
+	/* both "/all?since=N" and "/?categories=M&since=N" are accepted */
+	const char *params_begin = std::find(url_begin + 1, url_end, '?');
+	const char *since_end = url_end;
+	if (params_begin != url_end) {
+		const char *since = std::search(params_begin, url_end, since_parameter.begin(), since_parameter.end());
+		if (since != url_end) {
+			const char *since_begin = since + since_parameter.size();
+			since_end = since - 1;
+			ret.since = parse_number(since_begin, std::find(since_begin, url_end, '&'));
+		}
+	}
 
-	auto it = handlers.find(std::string(url_begin, url_end));
-	if (it != handlers.end())
-		return it->second;
-	else if (ssize_t(categories_url.size()) < (url_end - url_begin) &&
+	auto it = handlers.find(std::string(url_begin, params_begin));
+	if (it != handlers.end()) {
+		ret.categories = it->second;
+	} else if (ssize_t(categories_url.size()) < (url_end - url_begin) &&
 	         strncmp(url_begin, categories_url.c_str(), categories_url.size()) == 0) {
 		const char *categories = url_begin + categories_url.size();
-		try {
-			return boost::lexical_cast<uint64_t>(std::string(categories, url_end));
-		} catch(...) {
-			printf("Couldn't parse categories: %s\n", categories);
-		}
+		ret.categories = parse_number(categories, std::find(categories, since_end, '&'));
 	}
 
-	return 0;
+	return ret;
 }
 
 }} /* namespace ioremap::monitor */
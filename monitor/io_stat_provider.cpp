@@ -77,6 +77,11 @@ std::string io_stat_provider::json(uint64_t categories) const {
 
 	doc.AddMember("blocked", m_node->io->blocked == 1, allocator);
 
+	rapidjson::Value logger_stat(rapidjson::kObjectType);
+	logger_stat.AddMember("async", dnet_log_async_enabled() != 0, allocator)
+	           .AddMember("dropped", dnet_log_async_dropped(), allocator);
+	doc.AddMember("logger", logger_stat, allocator);
+
 	rapidjson::StringBuffer buffer;
 	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
 	doc.Accept(writer);
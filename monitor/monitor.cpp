@@ -23,6 +23,7 @@
 #include <exception>
 
 #include "library/elliptics.h"
+#include "example/config.hpp"
 #include "io_stat_provider.hpp"
 #include "backends_stat_provider.hpp"
 #include "procfs_provider.hpp"
@@ -37,8 +38,58 @@ static ioremap::monitor::monitor* get_monitor(struct dnet_node *n) {
 
 namespace ioremap { namespace monitor {
 
+std::unique_ptr<monitor_config> monitor_config::parse(const elliptics::config::config &monitor)
+{
+	monitor_config config;
+	config.report_cache_lifetime = monitor.at<unsigned>("report_cache_lifetime", DNET_DEFAULT_MONITOR_REPORT_CACHE_LIFETIME_MS);
+	config.hot_keys_top = monitor.at<size_t>("hot_keys_top", DNET_DEFAULT_MONITOR_HOT_KEYS_TOP);
+	config.hot_keys_sketch_width = monitor.at<size_t>("hot_keys_sketch_width", DNET_DEFAULT_MONITOR_HOT_KEYS_SKETCH_WIDTH);
+	config.hot_keys_window = monitor.at<unsigned>("hot_keys_window", DNET_DEFAULT_MONITOR_HOT_KEYS_WINDOW_MS);
+
+	config.slow_requests_size = monitor.at<size_t>("slow_requests_size", DNET_DEFAULT_MONITOR_SLOW_REQUESTS_SIZE);
+	config.slow_request_threshold = monitor.at<unsigned>("slow_request_threshold", DNET_DEFAULT_MONITOR_SLOW_REQUEST_THRESHOLD_MS);
+	config.slow_request_sample_rate = monitor.at<double>("slow_request_sample_rate", DNET_DEFAULT_MONITOR_SLOW_REQUEST_SAMPLE_RATE);
+	config.server_threads = monitor.at<size_t>("server_threads", DNET_DEFAULT_MONITOR_SERVER_THREADS);
+	config.server_max_connections = monitor.at<size_t>("server_max_connections", DNET_DEFAULT_MONITOR_SERVER_MAX_CONNECTIONS);
+	config.server_timeout = monitor.at<unsigned>("server_timeout", DNET_DEFAULT_MONITOR_SERVER_TIMEOUT_MS);
+
+	if (config.hot_keys_window == 0)
+		throw elliptics::config::config_error(monitor.at("hot_keys_window").path() + " must be non-zero");
+
+	if (config.slow_request_sample_rate < 0 || config.slow_request_sample_rate > 1)
+		throw elliptics::config::config_error(monitor.at("slow_request_sample_rate").path() + " must be in range [0, 1]");
+
+	if (config.server_threads == 0)
+		throw elliptics::config::config_error(monitor.at("server_threads").path() + " must be non-zero");
+
+	if (config.server_timeout == 0)
+		throw elliptics::config::config_error(monitor.at("server_timeout").path() + " must be non-zero");
+
+	return blackhole::utils::make_unique<monitor_config>(config);
+}
+
+static monitor_config get_monitor_config(struct dnet_node *n) {
+	auto data = static_cast<elliptics::config::config_data *>(n->config_data);
+	if (data && data->monitor_config)
+		return *data->monitor_config;
+
+	monitor_config config;
+	config.report_cache_lifetime = DNET_DEFAULT_MONITOR_REPORT_CACHE_LIFETIME_MS;
+	config.hot_keys_top = DNET_DEFAULT_MONITOR_HOT_KEYS_TOP;
+	config.hot_keys_sketch_width = DNET_DEFAULT_MONITOR_HOT_KEYS_SKETCH_WIDTH;
+	config.hot_keys_window = DNET_DEFAULT_MONITOR_HOT_KEYS_WINDOW_MS;
+	config.slow_requests_size = DNET_DEFAULT_MONITOR_SLOW_REQUESTS_SIZE;
+	config.slow_request_threshold = DNET_DEFAULT_MONITOR_SLOW_REQUEST_THRESHOLD_MS;
+	config.slow_request_sample_rate = DNET_DEFAULT_MONITOR_SLOW_REQUEST_SAMPLE_RATE;
+	config.server_threads = DNET_DEFAULT_MONITOR_SERVER_THREADS;
+	config.server_max_connections = DNET_DEFAULT_MONITOR_SERVER_MAX_CONNECTIONS;
+	config.server_timeout = DNET_DEFAULT_MONITOR_SERVER_TIMEOUT_MS;
+	return config;
+}
+
 monitor::monitor(struct dnet_node *n, struct dnet_config *cfg)
 : m_node(n)
+, m_config(get_monitor_config(n))
 , m_server(*this, cfg->monitor_port, cfg->family)
 , m_statistics(*this, cfg)
 {
@@ -163,6 +214,24 @@ void monitor_command_counter(struct dnet_node *n, const int cmd, const int trans
 		                                               cache, size, time);
 }
 
+void monitor_hot_keys_update(struct dnet_node *n, size_t backend_id, const int cmd,
+                             const struct dnet_raw_id *id, const uint64_t size) {
+	auto real_monitor = get_monitor(n);
+	if (real_monitor)
+		real_monitor->get_statistics().hot_keys_update(backend_id, cmd, *id, size);
+}
+
+void monitor_request_stages(struct dnet_node *n, const struct dnet_cmd *cmd,
+                            const struct dnet_addr *addr, const int backend_id,
+                            const uint64_t reply_size,
+                            const uint64_t recv, const uint64_t wait,
+                            const uint64_t process, const uint64_t send) {
+	auto real_monitor = get_monitor(n);
+	if (real_monitor)
+		real_monitor->get_statistics().request_stages_update(*cmd, *addr, backend_id, reply_size,
+		                                                     recv, wait, process, send);
+}
+
 int dnet_monitor_process_cmd(struct dnet_net_state *orig, struct dnet_cmd *cmd __unused, void *data)
 {
 	//react::action_guard monitor_process_cmd_guard(ACTION_DNET_MONITOR_PROCESS_CMD);
@@ -186,7 +255,7 @@ int dnet_monitor_process_cmd(struct dnet_net_state *orig, struct dnet_cmd *cmd _
 		return dnet_send_reply(orig, cmd, disabled_reply.c_str(), disabled_reply.size(), 0);
 
 	try {
-		auto json = real_monitor->get_statistics().report(req->categories);
+		auto json = real_monitor->get_statistics().report(req->categories, req->since_version);
 		return dnet_send_reply(orig, cmd, &*json.begin(), json.size(), 0);
 	} catch(std::exception &e) {
 		static const std::string rep = "{\"monitor_status\":\"failed: " + std::string(e.what()) + "\"}";
@@ -29,6 +29,9 @@ extern "C" {
 
 struct dnet_node;
 struct dnet_config;
+struct dnet_raw_id;
+struct dnet_cmd;
+struct dnet_addr;
 
 /*!
  * \internal
@@ -110,6 +113,36 @@ void monitor_command_counter(struct dnet_node *n, const int cmd, const int trans
                              const int err, const int cache,
                              const uint32_t size, const unsigned long time);
 
+/*!
+ * \internal
+ *
+ * Accounts command \a cmd to key \a id in hot keys statistics of backend \a backend_id,
+ * \a size - size of data read or written by the command
+ */
+void monitor_hot_keys_update(struct dnet_node *n, size_t backend_id, const int cmd,
+                             const struct dnet_raw_id *id, const uint64_t size);
+
+/*!
+ * \internal
+ *
+ * Sends to \a monitor time spent by request at each stage of processing:
+ * \a cmd - header of the request
+ * \a addr - address of the peer which has sent the request
+ * \a backend_id - backend which has processed the request or -1 for node's io pool
+ * \a reply_size - total size of replies sent for the request
+ * \a recv - receiving of the request from network
+ * \a wait - waiting in io pool queue
+ * \a process - processing until final reply was queued for sending
+ * \a send - waiting in send queue and sending of final reply
+ * All times are in microseconds.
+ * Monitor is linked into server library only, so client library checks whether it is present.
+ */
+void __attribute__((weak)) monitor_request_stages(struct dnet_node *n, const struct dnet_cmd *cmd,
+                            const struct dnet_addr *addr, const int backend_id,
+                            const uint64_t reply_size,
+                            const uint64_t recv, const uint64_t wait,
+                            const uint64_t process, const uint64_t send);
+
 int dnet_monitor_process_cmd(struct dnet_net_state *orig, struct dnet_cmd *cmd, void *data);
 
 #ifdef __cplusplus
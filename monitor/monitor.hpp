@@ -21,6 +21,7 @@
 #define __DNET_MONITOR_MONITOR_HPP
 
 #include "../library/elliptics.h"
+#include "../library/backend.h"
 
 #include "server.hpp"
 #include "statistics.hpp"
@@ -59,8 +60,14 @@ public:
 
 	struct dnet_node *node() { return m_node; }
 
+	/*!
+	 * Returns monitor's configuration
+	 */
+	const monitor_config &config() const { return m_config; }
+
 private:
 	struct dnet_node	*m_node;
+	monitor_config	m_config;
 	server		m_server;
 	statistics	m_statistics;
 };
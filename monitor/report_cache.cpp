@@ -0,0 +1,189 @@
+/*
+ * Copyright 2013+ Kirill Smorodinnikov <shaitkir@gmail.com>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "report_cache.hpp"
+
+#include <time.h>
+
+#include "monitor/compress.hpp"
+
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace ioremap { namespace monitor {
+
+/*
+ * Maximum number of different categories masks which reports are kept,
+ * the oldest report is dropped when it is exceeded
+ */
+static const size_t max_cached_reports = 64;
+
+static uint64_t monotonic_ms() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Serializes \a value as one-element json array, so it can be parsed back
+ * by rapidjson which requires object or array at the root
+ */
+static std::string serialize_leaf(const rapidjson::Value &value) {
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	writer.StartArray();
+	value.Accept(writer);
+	writer.EndArray();
+	return buffer.GetString();
+}
+
+/*
+ * Splits \a value into the list of leaves: scalars, arrays and empty objects
+ */
+static void flatten(const rapidjson::Value &value, std::vector<std::string> &path,
+                    std::map<std::vector<std::string>, std::string> &leaves) {
+	if (!value.IsObject() || value.MemberBegin() == value.MemberEnd()) {
+		leaves[path] = serialize_leaf(value);
+		return;
+	}
+
+	for (auto it = value.MemberBegin(), end = value.MemberEnd(); it != end; ++it) {
+		path.emplace_back(it->name.GetString(), it->name.GetStringLength());
+		flatten(it->value, path, leaves);
+		path.pop_back();
+	}
+}
+
+static std::string convert_report(const rapidjson::Document &report) {
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	report.Accept(writer);
+	return compress(buffer.GetString());
+}
+
+report_cache::report_cache(unsigned int lifetime)
+: m_lifetime(lifetime)
+, m_version(0)
+{}
+
+std::string report_cache::get(uint64_t categories, uint64_t since, const generator &gen) {
+	auto e = get_entry(categories);
+
+	std::unique_lock<std::mutex> guard(e->lock);
+	if (!e->version || monotonic_ms() - e->timestamp >= m_lifetime)
+		update(*e, categories, gen);
+
+	if (since == 0 || since < e->first_version || since > e->version)
+		return e->compressed;
+
+	return incremental_report(*e, since);
+}
+
+std::shared_ptr<report_cache::entry> report_cache::get_entry(uint64_t categories) {
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	auto it = m_entries.find(categories);
+	if (it != m_entries.end())
+		return it->second;
+
+	if (m_entries.size() >= max_cached_reports) {
+		auto oldest = m_entries.begin();
+		for (auto jt = m_entries.begin(); jt != m_entries.end(); ++jt) {
+			if (jt->second->timestamp < oldest->second->timestamp)
+				oldest = jt;
+		}
+		m_entries.erase(oldest);
+	}
+
+	auto e = std::make_shared<entry>();
+	m_entries.insert(std::make_pair(categories, e));
+	return e;
+}
+
+void report_cache::update(entry &e, uint64_t categories, const generator &gen) {
+	rapidjson::Document report;
+	report.SetObject();
+	gen(categories, report);
+
+	std::map<path_t, std::string> values;
+	path_t path;
+	flatten(report, path, values);
+
+	uint64_t version;
+	{
+		std::unique_lock<std::mutex> guard(m_lock);
+		version = ++m_version;
+	}
+
+	std::map<path_t, leaf> leaves;
+	for (auto it = values.begin(); it != values.end(); ++it) {
+		leaf &l = leaves[it->first];
+		auto old = e.leaves.find(it->first);
+		if (old != e.leaves.end() && old->second.value == it->second) {
+			l.changed = old->second.changed;
+		} else {
+			l.changed = version;
+		}
+		l.value.swap(it->second);
+	}
+
+	report.AddMember("version", version, report.GetAllocator());
+
+	e.leaves.swap(leaves);
+	e.compressed = convert_report(report);
+	e.version = version;
+	if (!e.first_version)
+		e.first_version = version;
+	e.timestamp = monotonic_ms();
+}
+
+std::string report_cache::incremental_report(const entry &e, uint64_t since) const {
+	rapidjson::Document report;
+	report.SetObject();
+	auto &allocator = report.GetAllocator();
+
+	for (auto it = e.leaves.begin(); it != e.leaves.end(); ++it) {
+		if (it->second.changed <= since)
+			continue;
+
+		const path_t &path = it->first;
+		rapidjson::Value *node = &report;
+		for (size_t i = 0; i + 1 < path.size(); ++i) {
+			const char *name = path[i].c_str();
+			if (!node->HasMember(name)) {
+				rapidjson::Value object(rapidjson::kObjectType);
+				node->AddMember(name, allocator, object, allocator);
+			}
+			node = &(*node)[name];
+		}
+
+		rapidjson::Document value_doc(&allocator);
+		value_doc.Parse<0>(it->second.value.c_str());
+		if (value_doc.HasParseError() || !value_doc.IsArray() || value_doc.Size() != 1)
+			continue;
+
+		node->AddMember(path.back().c_str(), allocator, value_doc[0u], allocator);
+	}
+
+	report.AddMember("version", e.version, allocator);
+	report.AddMember("since", since, allocator);
+	return convert_report(report);
+}
+
+}} /* namespace ioremap::monitor */
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2013+ Kirill Smorodinnikov <shaitkir@gmail.com>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DNET_MONITOR_REPORT_CACHE_HPP
+#define __DNET_MONITOR_REPORT_CACHE_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+namespace ioremap { namespace monitor {
+
+/*!
+ * \internal
+ *
+ * Cache of generated reports
+ * Keeps last compressed report for each requested categories mask and reuses it
+ * while it is younger than configured lifetime.
+ * Also remembers in which version each value of the report was changed last time,
+ * so it can generate incremental report which contains only values changed since some version.
+ */
+class report_cache {
+public:
+	/*!
+	 * \internal
+	 *
+	 * Callback which fills \a report by statistics of \a categories
+	 */
+	typedef std::function<void (uint64_t categories, rapidjson::Document &report)> generator;
+
+	/*!
+	 * \internal
+	 *
+	 * Constructor: initializes cache with \a lifetime of reports in milliseconds
+	 */
+	report_cache(unsigned int lifetime);
+
+	/*!
+	 * \internal
+	 *
+	 * Returns compressed report for \a categories
+	 * If \a since is not zero, returns only values which were changed after version \a since.
+	 * Full report is returned if there is no enough information about version \a since.
+	 * \a gen is called if there is no cached report or it is too old.
+	 */
+	std::string get(uint64_t categories, uint64_t since, const generator &gen);
+
+private:
+	typedef std::vector<std::string> path_t;
+
+	/*!
+	 * \internal
+	 *
+	 * Single scalar value (or array) of the report
+	 */
+	struct leaf {
+		/*!
+		 * \internal
+		 *
+		 * Value serialized as one-element json array
+		 */
+		std::string	value;
+		/*!
+		 * \internal
+		 *
+		 * Version of the report in which value was changed last time
+		 */
+		uint64_t	changed;
+	};
+
+	struct entry {
+		entry() : timestamp(0), first_version(0), version(0) {}
+
+		std::mutex			lock;
+		/*!
+		 * \internal
+		 *
+		 * Monotonic time of report generation in milliseconds
+		 */
+		uint64_t			timestamp;
+		/*!
+		 * \internal
+		 *
+		 * Version of the first report generated for the categories,
+		 * values changes before it are unknown
+		 */
+		uint64_t			first_version;
+		uint64_t			version;
+		std::string			compressed;
+		std::map<path_t, leaf>		leaves;
+	};
+
+	std::shared_ptr<entry> get_entry(uint64_t categories);
+
+	void update(entry &e, uint64_t categories, const generator &gen);
+
+	std::string incremental_report(const entry &e, uint64_t since) const;
+
+	unsigned int					m_lifetime;
+
+	std::mutex					m_lock;
+	uint64_t					m_version;
+	std::map<uint64_t, std::shared_ptr<entry>>	m_entries;
+};
+
+}} /* namespace ioremap::monitor */
+
+#endif /* __DNET_MONITOR_REPORT_CACHE_HPP */
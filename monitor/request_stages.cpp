@@ -0,0 +1,148 @@
+/*
+ * Copyright 2013+ Kirill Smorodinnikov <shaitkir@gmail.com>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "request_stages.hpp"
+
+#include <string>
+
+namespace ioremap { namespace monitor {
+
+static size_t latency_bucket(uint64_t usecs, size_t buckets_count) {
+	size_t bucket = usecs ? 64 - __builtin_clzll(usecs) : 0;
+	return bucket < buckets_count ? bucket : buckets_count - 1;
+}
+
+latency_distribution::latency_distribution()
+: m_sum(0)
+, m_max(0)
+{
+	for (size_t i = 0; i < buckets_count; ++i) {
+		m_buckets[i] = 0;
+	}
+}
+
+void latency_distribution::update(uint64_t usecs) {
+	m_buckets[latency_bucket(usecs, buckets_count)].fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(usecs, std::memory_order_relaxed);
+
+	uint64_t max = m_max.load(std::memory_order_relaxed);
+	while (usecs > max && !m_max.compare_exchange_weak(max, usecs, std::memory_order_relaxed)) {
+	}
+}
+
+rapidjson::Value& latency_distribution::report(rapidjson::Value &stat_value,
+                                               rapidjson::Document::AllocatorType &allocator) const {
+	static const struct {
+		const char	*name;
+		double		quantile;
+	} percentiles[] = {
+		{"p50", 0.5},
+		{"p90", 0.9},
+		{"p99", 0.99},
+		{"p999", 0.999},
+	};
+
+	uint64_t buckets[buckets_count];
+	uint64_t count = 0;
+	for (size_t i = 0; i < buckets_count; ++i) {
+		buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+		count += buckets[i];
+	}
+
+	stat_value.AddMember("count", count, allocator);
+	stat_value.AddMember("sum", m_sum.load(std::memory_order_relaxed), allocator);
+	stat_value.AddMember("max", m_max.load(std::memory_order_relaxed), allocator);
+
+	for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); ++p) {
+		const uint64_t rank = count * percentiles[p].quantile;
+		uint64_t bound = 0, accumulated = 0;
+		for (size_t i = 0; i < buckets_count; ++i) {
+			accumulated += buckets[i];
+			if (accumulated > rank) {
+				bound = i ? (1ULL << i) : 0;
+				break;
+			}
+		}
+		stat_value.AddMember(percentiles[p].name, bound, allocator);
+	}
+
+	return stat_value;
+}
+
+request_stages::request_stages(size_t backends_count) {
+	m_stages.reserve(backends_count + 1);
+	for (size_t i = 0; i < backends_count + 1; ++i) {
+		m_stages.emplace_back(new stages());
+	}
+}
+
+void request_stages::update(int backend_id, uint64_t recv, uint64_t wait, uint64_t process, uint64_t send) {
+	size_t index = m_stages.size() - 1;
+	if (backend_id >= 0) {
+		if (static_cast<size_t>(backend_id) >= index)
+			return;
+		index = backend_id;
+	}
+
+	stages &s = *m_stages[index];
+	s.recv.update(recv);
+	s.wait.update(wait);
+	s.process.update(process);
+	s.send.update(send);
+	s.total.update(recv + wait + process + send);
+}
+
+rapidjson::Value& request_stages::stages_report(const stages &s, rapidjson::Value &stat_value,
+                                                rapidjson::Document::AllocatorType &allocator) const {
+	rapidjson::Value recv_value(rapidjson::kObjectType);
+	stat_value.AddMember("recv", s.recv.report(recv_value, allocator), allocator);
+
+	rapidjson::Value wait_value(rapidjson::kObjectType);
+	stat_value.AddMember("wait", s.wait.report(wait_value, allocator), allocator);
+
+	rapidjson::Value process_value(rapidjson::kObjectType);
+	stat_value.AddMember("process", s.process.report(process_value, allocator), allocator);
+
+	rapidjson::Value send_value(rapidjson::kObjectType);
+	stat_value.AddMember("send", s.send.report(send_value, allocator), allocator);
+
+	rapidjson::Value total_value(rapidjson::kObjectType);
+	stat_value.AddMember("total", s.total.report(total_value, allocator), allocator);
+
+	return stat_value;
+}
+
+rapidjson::Value& request_stages::report(rapidjson::Value &stat_value,
+                                         rapidjson::Document::AllocatorType &allocator) const {
+	rapidjson::Value backends_value(rapidjson::kObjectType);
+	for (size_t backend_id = 0; backend_id + 1 < m_stages.size(); ++backend_id) {
+		rapidjson::Value backend_value(rapidjson::kObjectType);
+		stages_report(*m_stages[backend_id], backend_value, allocator);
+		backends_value.AddMember(std::to_string(static_cast<unsigned long long>(backend_id)).c_str(),
+		                         allocator, backend_value, allocator);
+	}
+	stat_value.AddMember("backends", backends_value, allocator);
+
+	rapidjson::Value node_value(rapidjson::kObjectType);
+	stat_value.AddMember("node", stages_report(*m_stages.back(), node_value, allocator), allocator);
+
+	return stat_value;
+}
+
+}} /* namespace ioremap::monitor */
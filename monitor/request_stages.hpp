@@ -0,0 +1,135 @@
+/*
+ * Copyright 2013+ Kirill Smorodinnikov <shaitkir@gmail.com>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DNET_MONITOR_REQUEST_STAGES_HPP
+#define __DNET_MONITOR_REQUEST_STAGES_HPP
+
+#if __GNUC__ == 4 && __GNUC_MINOR__ < 5
+#  include <cstdatomic>
+#else
+#  include <atomic>
+#endif
+#include <memory>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+namespace ioremap { namespace monitor {
+
+/*!
+ * \internal
+ *
+ * Lock-free distribution of latencies
+ * Latencies are accounted in buckets with power of two bounds in microseconds.
+ */
+class latency_distribution {
+public:
+	latency_distribution();
+
+	/*!
+	 * \internal
+	 *
+	 * Accounts latency \a usecs
+	 */
+	void update(uint64_t usecs);
+
+	/*!
+	 * \internal
+	 *
+	 * Fills \a stat_value by number of accounted latencies, their sum, maximum
+	 * and upper bounds of 50, 90, 99 and 99.9 percentiles and returns it
+	 */
+	rapidjson::Value& report(rapidjson::Value &stat_value,
+	                         rapidjson::Document::AllocatorType &allocator) const;
+
+private:
+	/*!
+	 * \internal
+	 *
+	 * i-th bucket keeps latencies from [2^(i-1), 2^i) microseconds, zero bucket keeps zero latencies
+	 * and the last bucket keeps all latencies which are bigger than ~9 minutes
+	 */
+	static const size_t buckets_count = 31;
+
+	std::atomic<uint64_t>	m_buckets[buckets_count];
+	std::atomic<uint64_t>	m_sum;
+	std::atomic<uint64_t>	m_max;
+};
+
+/*!
+ * \internal
+ *
+ * Distributions of time spent by requests at each stage of processing:
+ * receiving from network, waiting in io pool queue, processing and sending reply.
+ * Requests are accounted per backend which has processed them,
+ * requests processed by node's own io pool are accounted separately.
+ */
+class request_stages {
+public:
+	/*!
+	 * \internal
+	 *
+	 * Constructor: initializes distributions for \a backends_count backends
+	 */
+	request_stages(size_t backends_count);
+
+	/*!
+	 * \internal
+	 *
+	 * Accounts stages of request which was processed by backend \a backend_id
+	 * or by node's io pool if \a backend_id is negative
+	 * \a recv - time spent on receiving the request
+	 * \a wait - time spent by the request in io pool queue
+	 * \a process - time spent on processing of the request until its final reply was queued
+	 * \a send - time spent by final reply in send queue
+	 * All times are in microseconds.
+	 */
+	void update(int backend_id, uint64_t recv, uint64_t wait, uint64_t process, uint64_t send);
+
+	/*!
+	 * \internal
+	 *
+	 * Fills \a stat_value by stages distributions of all backends and returns it
+	 */
+	rapidjson::Value& report(rapidjson::Value &stat_value,
+	                         rapidjson::Document::AllocatorType &allocator) const;
+
+private:
+	struct stages {
+		latency_distribution	recv;
+		latency_distribution	wait;
+		latency_distribution	process;
+		latency_distribution	send;
+		latency_distribution	total;
+	};
+
+	rapidjson::Value& stages_report(const stages &s, rapidjson::Value &stat_value,
+	                                rapidjson::Document::AllocatorType &allocator) const;
+
+	/*!
+	 * \internal
+	 *
+	 * Stages of each backend, the last one is for requests processed by node's io pool
+	 */
+	std::vector<std::unique_ptr<stages>>	m_stages;
+};
+
+}} /* namespace ioremap::monitor */
+
+#endif /* __DNET_MONITOR_REQUEST_STAGES_HPP */
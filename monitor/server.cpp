@@ -25,38 +25,85 @@
 
 namespace ioremap { namespace monitor {
 
+/*
+ * Reports are sent by chunks of this size,
+ * so timeout is applied to each chunk rather than to the whole report
+ */
+static const size_t write_chunk_size = 64 * 1024;
+
 class handler: public std::enable_shared_from_this<handler> {
 public:
-	handler(monitor &mon, boost::asio::io_service &io_service)
+	handler(monitor &mon, boost::asio::io_service &io_service, std::atomic<size_t> &connections)
 	: m_monitor(mon)
 	, m_socket(io_service)
+	, m_strand(io_service)
+	, m_timer(io_service)
+	, m_connections(connections)
 	, m_remote("")
-	{}
+	, m_offset(0)
+	{
+		++m_connections;
+	}
+
+	~handler() {
+		--m_connections;
+	}
 
 	void start() {
-		m_remote = m_socket.remote_endpoint().address().to_string();
-		dnet_log(m_monitor.node(), DNET_LOG_INFO, "monitor: server: accepted client: %s:%d", m_remote.c_str(), m_socket.remote_endpoint().port());
+		set_remote();
+		dnet_log(m_monitor.node(), DNET_LOG_INFO, "monitor: server: accepted client: %s", m_remote.c_str());
+		arm_timer();
 		async_read();
 	}
 
+	/*!
+	 * Replies 503 Service Unavailable without reading the request
+	 */
+	void reject() {
+		set_remote();
+		dnet_log(m_monitor.node(), DNET_LOG_ERROR, "monitor: server: rejected client: %s: too many connections: %zu",
+		         m_remote.c_str(), m_connections.load());
+		async_write(make_header(status_strings::service_unavailable, "text/html",
+		                        content_strings::service_unavailable.size(), false),
+		            content_strings::service_unavailable);
+	}
+
 	boost::asio::ip::tcp::socket &socket() {
 		return m_socket;
 	}
 
 private:
+	void set_remote();
 	void async_read();
-	void async_write(std::string data);
+	void async_write(std::string header, std::string content);
+	void async_write_chunk();
 	void handle_read(const boost::system::error_code &err, size_t size);
-	void handle_write();
+	void handle_write(const boost::system::error_code &err, size_t size);
+	void arm_timer();
+	void handle_timeout(const boost::system::error_code &err);
 	void close();
 
-	uint64_t parse_request(size_t size);
+	request parse_request(size_t size);
 
 	monitor							&m_monitor;
 	boost::asio::ip::tcp::socket	m_socket;
+	/*!
+	 * Serializes callbacks of the connection which are executed by different server threads
+	 */
+	boost::asio::io_service::strand	m_strand;
+	/*!
+	 * Closes connection if it has not made any progress during configured timeout
+	 */
+	boost::asio::deadline_timer		m_timer;
+	std::atomic<size_t>				&m_connections;
 	std::string						m_remote;
 	boost::array<char, 1024>		m_buffer;
+	std::string						m_header;
 	std::string						m_report;
+	/*!
+	 * Number of bytes of \a m_header and \a m_report which have been sent
+	 */
+	size_t							m_offset;
 };
 
 static boost::asio::ip::tcp convert_family(int family) {
@@ -65,20 +112,31 @@ static boost::asio::ip::tcp convert_family(int family) {
 
 server::server(monitor &mon, unsigned int port, int family)
 : m_monitor(mon)
-, m_acceptor(m_io_service, boost::asio::ip::tcp::endpoint(convert_family(family), port)) {
-	m_listen = std::thread(std::bind(&server::listen, this));
+, m_acceptor(m_io_service, boost::asio::ip::tcp::endpoint(convert_family(family), port))
+, m_connections(0)
+, m_stopped(false) {
+	async_accept();
+
+	m_threads.reserve(mon.config().server_threads);
+	for (size_t i = 0; i < mon.config().server_threads; ++i) {
+		m_threads.emplace_back(std::bind(&server::listen, this));
+	}
 }
 
 server::~server() {
 	stop();
-	m_listen.join();
+	for (auto it = m_threads.begin(); it != m_threads.end(); ++it) {
+		it->join();
+	}
 }
 
 void server::listen() {
-	while (!m_monitor.node()->need_exit) {
+	dnet_set_name("dnet_monitor");
+
+	while (!m_stopped && !m_monitor.node()->need_exit) {
 		try {
-			async_accept();
 			m_io_service.run();
+			break;
 		} catch (const std::exception &e) {
 			dnet_log(m_monitor.node(), DNET_LOG_ERROR, "monitor: server: got exception: %s, restarting it", e.what());
 		} catch (...) {
@@ -88,7 +146,7 @@ void server::listen() {
 }
 
 void server::async_accept() {
-	auto h = std::make_shared<handler>(m_monitor, m_io_service);
+	auto h = std::make_shared<handler>(m_monitor, m_io_service, m_connections);
 	m_acceptor.async_accept(h->socket(),
 	                        std::bind(&server::handle_accept, this,
 	                                  h,
@@ -96,24 +154,44 @@ void server::async_accept() {
 }
 
 void server::handle_accept(std::shared_ptr<handler> h, const boost::system::error_code &err) {
-	if (!err) {
-		h->start();
-	}
+	if (err == boost::asio::error::operation_aborted)
+		return;
+
+	/*
+	 * Only accepted connections are counted at this moment,
+	 * handler for the next connection will be created by async_accept() below
+	 */
+	const bool overloaded = m_connections.load() > m_monitor.config().server_max_connections;
 
 	async_accept();
+
+	if (!err) {
+		if (overloaded)
+			h->reject();
+		else
+			h->start();
+	}
 }
 
 
 void server::stop() {
+	m_stopped = true;
 	m_io_service.stop();
 }
 
+void handler::set_remote() {
+	boost::system::error_code ec;
+	auto endpoint = m_socket.remote_endpoint(ec);
+	if (!ec)
+		m_remote = endpoint.address().to_string() + ":" + std::to_string(static_cast<unsigned long long>(endpoint.port()));
+}
+
 void handler::async_read() {
 	auto self(shared_from_this());
 	m_socket.async_read_some(boost::asio::buffer(m_buffer),
-	                         std::bind(&handler::handle_read, self,
-	                                   std::placeholders::_1,
-	                                   std::placeholders::_2));
+	                         m_strand.wrap(std::bind(&handler::handle_read, self,
+	                                                 std::placeholders::_1,
+	                                                 std::placeholders::_2)));
 }
 
 void handler::handle_read(const boost::system::error_code &err, size_t size) {
@@ -123,36 +201,97 @@ void handler::handle_read(const boost::system::error_code &err, size_t size) {
 	}
 
 	auto req = parse_request(size);
-	std::string content = "";
 
-	if (req > 0) {
-		dnet_log(m_monitor.node(), DNET_LOG_DEBUG, "monitor: server: got statistics request for categories: %lx from: %s:%d", req, m_remote.c_str(), m_socket.remote_endpoint().port());
-		content = m_monitor.get_statistics().report(req);
+	if (req.categories == 0) {
+		auto reply = make_reply(0);
+		async_write(std::move(reply), std::string());
+		return;
 	}
 
-	std::string reply = make_reply(req, content);
-	async_write(reply);
+	dnet_log(m_monitor.node(), DNET_LOG_DEBUG, "monitor: server: got statistics request for categories: %lx, since: %lu from: %s", req.categories, req.since, m_remote.c_str());
+	std::string content = m_monitor.get_statistics().report(req.categories, req.since);
+	std::string header = make_header(status_strings::ok, "application/json", content.size(), true);
+	async_write(std::move(header), std::move(content));
 }
 
-void handler::async_write(std::string data) {
+void handler::async_write(std::string header, std::string content) {
+	m_header = std::move(header);
+	m_report = std::move(content);
+	m_offset = 0;
+	dnet_log(m_monitor.node(), DNET_LOG_DEBUG, "monitor: server: send requested statistics: started: %s, size: %lu", m_remote.c_str(), m_header.size() + m_report.size());
+	// report generation could take a while, so give the reply a full deadline
+	arm_timer();
+	async_write_chunk();
+}
+
+void handler::async_write_chunk() {
+	auto self(shared_from_this());
+	std::vector<boost::asio::const_buffer> buffers;
+	size_t left = write_chunk_size;
+
+	if (m_offset < m_header.size()) {
+		const size_t size = std::min(left, m_header.size() - m_offset);
+		buffers.push_back(boost::asio::buffer(m_header.data() + m_offset, size));
+		left -= size;
+	}
+
+	const size_t report_offset = m_offset > m_header.size() ? m_offset - m_header.size() : 0;
+	if (left && report_offset < m_report.size()) {
+		buffers.push_back(boost::asio::buffer(m_report.data() + report_offset,
+		                                      std::min(left, m_report.size() - report_offset)));
+	}
+
+	boost::asio::async_write(m_socket, buffers,
+	                         m_strand.wrap(std::bind(&handler::handle_write, self,
+	                                                 std::placeholders::_1,
+	                                                 std::placeholders::_2)));
+}
+
+void handler::handle_write(const boost::system::error_code &err, size_t size) {
+	if (err) {
+		dnet_log(m_monitor.node(), DNET_LOG_ERROR, "monitor: server: send requested statistics: failed: %s: %s", m_remote.c_str(), err.message().c_str());
+		close();
+		return;
+	}
+
+	m_offset += size;
+	if (m_offset < m_header.size() + m_report.size()) {
+		arm_timer();
+		async_write_chunk();
+		return;
+	}
+
+	dnet_log(m_monitor.node(), DNET_LOG_DEBUG, "monitor: server: send requested statistics: finished: %s", m_remote.c_str());
+	close();
+}
+
+void handler::arm_timer() {
 	auto self(shared_from_this());
-	m_report = std::move(data);
-	dnet_log(m_monitor.node(), DNET_LOG_DEBUG, "monitor: server: send requested statistics: started: %s:%d, size: %lu", m_remote.c_str(), m_socket.remote_endpoint().port(), m_report.size());
-	boost::asio::async_write(m_socket, boost::asio::buffer(m_report),
-	                         std::bind(&handler::handle_write, self));
+	m_timer.expires_from_now(boost::posix_time::milliseconds(m_monitor.config().server_timeout));
+	m_timer.async_wait(m_strand.wrap(std::bind(&handler::handle_timeout, self,
+	                                           std::placeholders::_1)));
 }
 
-void handler::handle_write() {
-	dnet_log(m_monitor.node(), DNET_LOG_DEBUG, "monitor: server: send requested statistics: finished: %s:%d", m_remote.c_str(), m_socket.remote_endpoint().port());
+void handler::handle_timeout(const boost::system::error_code &err) {
+	if (err == boost::asio::error::operation_aborted)
+		return;
+
+	// timer could be rearmed after it has expired but before this callback was executed
+	if (m_timer.expires_at() > boost::asio::deadline_timer::traits_type::now())
+		return;
+
+	dnet_log(m_monitor.node(), DNET_LOG_ERROR, "monitor: server: client: %s: timed out", m_remote.c_str());
 	close();
 }
 
 void handler::close() {
 	boost::system::error_code ec;
+	m_timer.cancel(ec);
 	m_socket.shutdown(boost::asio::socket_base::shutdown_both, ec);
+	m_socket.close(ec);
 }
 
-uint64_t handler::parse_request(size_t size) {
+request handler::parse_request(size_t size) {
 	return parse(m_buffer.data(), size);
 }
 
@@ -20,7 +20,13 @@
 #ifndef __DNET_MONITOR_SERVER_HPP
 #define __DNET_MONITOR_SERVER_HPP
 
+#if __GNUC__ == 4 && __GNUC_MINOR__ < 5
+#  include <cstdatomic>
+#else
+#  include <atomic>
+#endif
 #include <thread>
+#include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/array.hpp>
@@ -61,7 +67,7 @@ private:
 	server(const server&);
 
 	/*!
-	 * Starts listening monitor port
+	 * Runs boost::asio handlers in one of the server's threads
 	 */
 	void listen();
 
@@ -87,9 +93,16 @@ private:
 	boost::asio::ip::tcp::acceptor	m_acceptor;
 
 	/*!
-	 * Thread for executing boost::asio
+	 * Number of currently served connections,
+	 * connections above the configured limit are rejected
 	 */
-	std::thread						m_listen;
+	std::atomic<size_t>				m_connections;
+	std::atomic<bool>				m_stopped;
+
+	/*!
+	 * Threads for executing boost::asio
+	 */
+	std::vector<std::thread>		m_threads;
 };
 
 }} /* namespace ioremap::monitor */
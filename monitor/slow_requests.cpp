@@ -0,0 +1,169 @@
+/*
+ * Copyright 2013+ Kirill Smorodinnikov <shaitkir@gmail.com>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "slow_requests.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <time.h>
+
+#include "elliptics/interface.h"
+
+namespace ioremap { namespace monitor {
+
+/*
+ * State of per-thread xorshift64* generator, it is seeded on the first use
+ */
+static __thread uint64_t random_state;
+
+static uint64_t thread_random() {
+	if (!random_state) {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		random_state = (ts.tv_sec * 1000000000ULL + ts.tv_nsec) ^
+			(reinterpret_cast<uintptr_t>(&random_state) * 0x9e3779b97f4a7c15ULL);
+		if (!random_state)
+			random_state = 1;
+	}
+
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return random_state * 2685821657736338717ULL;
+}
+
+slow_requests::slow_requests(size_t size, uint64_t threshold, double sample_rate)
+: m_threshold(threshold)
+, m_sample_threshold(0)
+, m_sample_rate(sample_rate)
+, m_seq(0)
+, m_ring(size)
+{
+	if (sample_rate >= 1.)
+		m_sample_threshold = std::numeric_limits<uint64_t>::max();
+	else if (sample_rate > 0.)
+		m_sample_threshold = sample_rate * std::numeric_limits<uint64_t>::max();
+}
+
+bool slow_requests::sample() const {
+	return m_sample_threshold && thread_random() <= m_sample_threshold;
+}
+
+void slow_requests::update(const dnet_cmd &cmd, const dnet_addr &addr, int backend_id, uint64_t reply_size,
+                           uint64_t recv, uint64_t wait, uint64_t process, uint64_t send) {
+	if (m_ring.empty())
+		return;
+
+	const bool slow = m_threshold && recv + wait + process + send >= m_threshold;
+	if (!slow && !sample())
+		return;
+
+	struct timeval timestamp;
+	gettimeofday(&timestamp, NULL);
+
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	slow_request &req = m_ring[m_seq % m_ring.size()];
+	req.seq = m_seq++;
+	req.timestamp = timestamp;
+	req.cmd = cmd;
+	req.addr = addr;
+	req.backend_id = backend_id;
+	req.reply_size = reply_size;
+	req.recv = recv;
+	req.wait = wait;
+	req.process = process;
+	req.send = send;
+	req.sampled = !slow;
+}
+
+rapidjson::Value& slow_requests::report(rapidjson::Value &stat_value,
+                                        rapidjson::Document::AllocatorType &allocator) const {
+	std::vector<slow_request> requests;
+	uint64_t seq;
+	{
+		std::unique_lock<std::mutex> guard(m_lock);
+		seq = m_seq;
+		const size_t count = std::min<uint64_t>(m_seq, m_ring.size());
+		requests.reserve(count);
+		for (uint64_t i = m_seq - count; i < m_seq; ++i) {
+			requests.push_back(m_ring[i % m_ring.size()]);
+		}
+	}
+
+	stat_value.AddMember("threshold", m_threshold, allocator);
+	stat_value.AddMember("sample_rate", m_sample_rate, allocator);
+	stat_value.AddMember("captured", seq, allocator);
+
+	rapidjson::Value requests_value(rapidjson::kArrayType);
+	char id_str[DNET_ID_SIZE * 2 + 1];
+	char addr_str[128];
+
+	for (auto it = requests.begin(); it != requests.end(); ++it) {
+		rapidjson::Value request_value(rapidjson::kObjectType);
+		request_value.AddMember("seq", it->seq, allocator);
+
+		rapidjson::Value timestamp_value(rapidjson::kObjectType);
+		timestamp_value.AddMember("tv_sec", it->timestamp.tv_sec, allocator);
+		timestamp_value.AddMember("tv_usec", it->timestamp.tv_usec, allocator);
+		request_value.AddMember("timestamp", timestamp_value, allocator);
+
+		request_value.AddMember("reason", it->sampled ? "sampled" : "slow", allocator);
+
+		rapidjson::Value cmd_value;
+		cmd_value.SetString(dnet_cmd_string(it->cmd.cmd), allocator);
+		request_value.AddMember("cmd", cmd_value, allocator);
+
+		dnet_dump_id_len_raw(it->cmd.id.id, DNET_ID_SIZE, id_str);
+		rapidjson::Value id_value;
+		id_value.SetString(id_str, allocator);
+		request_value.AddMember("id", id_value, allocator);
+		request_value.AddMember("group", it->cmd.id.group_id, allocator);
+
+		request_value.AddMember("trans", static_cast<uint64_t>(it->cmd.trans), allocator);
+
+		rapidjson::Value flags_value;
+		flags_value.SetString(dnet_flags_dump_cflags(it->cmd.flags), allocator);
+		request_value.AddMember("flags", flags_value, allocator);
+
+		request_value.AddMember("size", static_cast<uint64_t>(it->cmd.size), allocator);
+		request_value.AddMember("reply_size", it->reply_size, allocator);
+		request_value.AddMember("backend_id", it->backend_id, allocator);
+
+		rapidjson::Value addr_value;
+		addr_value.SetString(dnet_server_convert_dnet_addr_raw(&it->addr, addr_str, sizeof(addr_str)), allocator);
+		request_value.AddMember("peer", addr_value, allocator);
+
+		rapidjson::Value stages_value(rapidjson::kObjectType);
+		stages_value.AddMember("recv", it->recv, allocator);
+		stages_value.AddMember("wait", it->wait, allocator);
+		stages_value.AddMember("process", it->process, allocator);
+		stages_value.AddMember("send", it->send, allocator);
+		stages_value.AddMember("total", it->recv + it->wait + it->process + it->send, allocator);
+		request_value.AddMember("stages", stages_value, allocator);
+
+		requests_value.PushBack(request_value, allocator);
+	}
+	stat_value.AddMember("requests", requests_value, allocator);
+
+	return stat_value;
+}
+
+}} /* namespace ioremap::monitor */
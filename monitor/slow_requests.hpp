@@ -0,0 +1,154 @@
+/*
+ * Copyright 2013+ Kirill Smorodinnikov <shaitkir@gmail.com>
+ *
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DNET_MONITOR_SLOW_REQUESTS_HPP
+#define __DNET_MONITOR_SLOW_REQUESTS_HPP
+
+#include <sys/time.h>
+
+#include <mutex>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+#include "elliptics/packet.h"
+
+namespace ioremap { namespace monitor {
+
+/*!
+ * \internal
+ *
+ * Context of single captured request
+ */
+struct slow_request {
+	/*!
+	 * \internal
+	 *
+	 * Sequence number of the capture, it grows monotonically
+	 */
+	uint64_t	seq;
+	/*!
+	 * \internal
+	 *
+	 * Wall-clock time when the request was captured
+	 */
+	struct timeval	timestamp;
+	/*!
+	 * \internal
+	 *
+	 * Header of the request
+	 */
+	dnet_cmd	cmd;
+	/*!
+	 * \internal
+	 *
+	 * Address of the peer which has sent the request
+	 */
+	dnet_addr	addr;
+	int		backend_id;
+	/*!
+	 * \internal
+	 *
+	 * Total size of replies sent for the request
+	 */
+	uint64_t	reply_size;
+	/*!
+	 * \internal
+	 *
+	 * Times spent at each stage of processing in microseconds
+	 */
+	uint64_t	recv;
+	uint64_t	wait;
+	uint64_t	process;
+	uint64_t	send;
+	/*!
+	 * \internal
+	 *
+	 * Shows that the request was captured by random sampling rather than by latency threshold
+	 */
+	bool		sampled;
+};
+
+/*!
+ * \internal
+ *
+ * Bounded log of requests which took longer than configured threshold
+ * plus small random sample of all requests.
+ * The newest captures overwrite the oldest ones.
+ */
+class slow_requests {
+public:
+	/*!
+	 * \internal
+	 *
+	 * Constructor: initializes log which keeps \a size last captures
+	 * of requests which took at least \a threshold microseconds (0 disables threshold)
+	 * and of randomly chosen \a sample_rate part of all requests
+	 * \a size equal to zero disables capturing
+	 */
+	slow_requests(size_t size, uint64_t threshold, double sample_rate);
+
+	/*!
+	 * \internal
+	 *
+	 * Captures request \a cmd received from \a addr and processed by backend \a backend_id
+	 * if it is slow or sampled. \a reply_size - total size of replies,
+	 * \a recv, \a wait, \a process and \a send - times spent at each stage of processing in microseconds
+	 */
+	void update(const dnet_cmd &cmd, const dnet_addr &addr, int backend_id, uint64_t reply_size,
+	            uint64_t recv, uint64_t wait, uint64_t process, uint64_t send);
+
+	/*!
+	 * \internal
+	 *
+	 * Fills \a stat_value by captured requests from the oldest to the newest and returns it
+	 */
+	rapidjson::Value& report(rapidjson::Value &stat_value,
+	                         rapidjson::Document::AllocatorType &allocator) const;
+
+private:
+	/*!
+	 * \internal
+	 *
+	 * Returns true if request should be captured by random sampling
+	 */
+	bool sample() const;
+
+	uint64_t			m_threshold;
+	/*!
+	 * \internal
+	 *
+	 * Sample rate scaled to the range of 64-bit random numbers
+	 */
+	uint64_t			m_sample_threshold;
+	double				m_sample_rate;
+
+	mutable std::mutex		m_lock;
+	/*!
+	 * \internal
+	 *
+	 * Total number of captured requests, position of the next capture is m_seq % m_ring.size()
+	 */
+	uint64_t			m_seq;
+	std::vector<slow_request>	m_ring;
+};
+
+}} /* namespace ioremap::monitor */
+
+#endif /* __DNET_MONITOR_SLOW_REQUESTS_HPP */
@@ -22,7 +22,6 @@
 #include "monitor.hpp"
 #include "cache/cache.hpp"
 #include "elliptics/backends.h"
-#include "monitor/compress.hpp"
 
 //FIXME: elliptics uses rather modified version of rapidjson
 // which is partially incompatible with a stock version used by
@@ -37,12 +36,25 @@
 
 namespace ioremap { namespace monitor {
 
+static size_t backends_count(struct dnet_node *n) {
+	return n->config_data ? dnet_backend_info_list_count(n->config_data->backends) : 0;
+}
+
 statistics::statistics(monitor& mon, struct dnet_config *cfg)
 : m_monitor(mon)
 , m_read_histograms(default_xs(), default_ys())
 , m_write_histograms(default_xs(), default_ys())
 , m_indx_update_histograms(default_xs(), default_ys())
-, m_indx_internal_histograms(default_xs(), default_ys()) {
+, m_indx_internal_histograms(default_xs(), default_ys())
+, m_hot_keys(backends_count(mon.node()),
+             mon.config().hot_keys_top,
+             mon.config().hot_keys_sketch_width,
+             mon.config().hot_keys_window)
+, m_request_stages(backends_count(mon.node()))
+, m_slow_requests(mon.config().slow_requests_size,
+                  mon.config().slow_request_threshold * 1000ULL,
+                  mon.config().slow_request_sample_rate)
+, m_report_cache(mon.config().report_cache_lifetime) {
 	memset(m_cmd_stats.c_array(), 0, sizeof(command_counters) * m_cmd_stats.size());
 }
 
@@ -120,17 +132,14 @@ void statistics::remove_provider(const std::string &name) {
 	m_stat_providers.erase(it, m_stat_providers.end());
 }
 
-inline std::string convert_report(const rapidjson::Document &report) {
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-	report.Accept(writer);
-	return compress(buffer.GetString());
+std::string statistics::report(uint64_t categories, uint64_t since) {
+	return m_report_cache.get(categories, since,
+	                          std::bind(&statistics::generate_report, this,
+	                                    std::placeholders::_1, std::placeholders::_2));
 }
 
-std::string statistics::report(uint64_t categories) {
-	rapidjson::Document report;
+void statistics::generate_report(uint64_t categories, rapidjson::Document &report) {
 	dnet_log(m_monitor.node(), DNET_LOG_INFO, "monitor: collecting statistics for categories: %lx", categories);
-	report.SetObject();
 	auto &allocator = report.GetAllocator();
 
 	struct timeval time;
@@ -152,6 +161,21 @@ std::string statistics::report(uint64_t categories) {
 		report.AddMember("histogram", histogram_report(histogram_value, allocator), allocator);
 	}
 
+	if (categories & DNET_MONITOR_HOT_KEYS) {
+		rapidjson::Value hot_keys_value(rapidjson::kObjectType);
+		report.AddMember("hot_keys", m_hot_keys.report(hot_keys_value, allocator), allocator);
+	}
+
+	if (categories & DNET_MONITOR_REQUEST_STAGES) {
+		rapidjson::Value stages_value(rapidjson::kObjectType);
+		report.AddMember("request_stages", m_request_stages.report(stages_value, allocator), allocator);
+	}
+
+	if (categories & DNET_MONITOR_SLOW_REQUESTS) {
+		rapidjson::Value slow_requests_value(rapidjson::kObjectType);
+		report.AddMember("slow_requests", m_slow_requests.report(slow_requests_value, allocator), allocator);
+	}
+
 	if (categories & DNET_MONITOR_STATS) {
 #if defined(HAVE_HANDYSTATS) && !defined(HANDYSTATS_DISABLE)
 		rapidjson::Value stats_value(rapidjson::kObjectType);
@@ -176,7 +200,6 @@ std::string statistics::report(uint64_t categories) {
 	}
 
 	dnet_log(m_monitor.node(), DNET_LOG_DEBUG, "monitor: finished generating json statistics for categories: %lx", categories);
-	return convert_report(report);
 }
 
 static void ext_stat_json(ext_counter &ext_stat, rapidjson::Value &stat_value, rapidjson::Document::AllocatorType &allocator) {
@@ -36,6 +36,10 @@
 #include "../library/elliptics.h"
 
 #include "histogram.hpp"
+#include "hot_keys.hpp"
+#include "request_stages.hpp"
+#include "slow_requests.hpp"
+#include "report_cache.hpp"
 #include "monitor.h"
 
 namespace ioremap { namespace monitor {
@@ -198,11 +202,14 @@ public:
 	/*!
 	 * \internal
 	 *
-	 * Generates and returns json statistics for specified \a category
+	 * Returns compressed json statistics for specified \a category
 	 * For that statistics will interview all external statistics provider
-	 * which supports \a categories
+	 * which supports \a categories unless report for \a categories has been
+	 * recently generated.
+	 * If \a since is not zero, only values changed since report with version \a since
+	 * will be returned.
 	 */
-	std::string report(uint64_t categories);
+	std::string report(uint64_t categories, uint64_t since = 0);
 
 	/*!
 	 * \internal
@@ -218,6 +225,28 @@ public:
 	void command_counter(int cmd, const int trans, const int err, const int cache,
 	                     const uint32_t size, const unsigned long time);
 
+	/*!
+	 * \internal
+	 *
+	 * Accounts command \a cmd to key \a id in hot keys statistics of backend \a backend_id
+	 * \a size - size of data read or written by the command
+	 */
+	void hot_keys_update(size_t backend_id, int cmd, const dnet_raw_id &id, uint64_t size) {
+		m_hot_keys.update(backend_id, cmd, id, size);
+	}
+
+	/*!
+	 * \internal
+	 *
+	 * Accounts time spent by request \a cmd from \a addr at each stage of processing by backend \a backend_id
+	 * and captures it if it is slow or sampled, see request_stages::update and slow_requests::update for details
+	 */
+	void request_stages_update(const dnet_cmd &cmd, const dnet_addr &addr, int backend_id, uint64_t reply_size,
+	                           uint64_t recv, uint64_t wait, uint64_t process, uint64_t send) {
+		m_request_stages.update(backend_id, recv, wait, process, send);
+		m_slow_requests.update(cmd, addr, backend_id, reply_size, recv, wait, process, send);
+	}
+
 	/*!
 	 * \internal
 	 *
@@ -227,6 +256,13 @@ public:
 	void add_provider(stat_provider *stat, const std::string &name);
 	void remove_provider(const std::string &name);
 private:
+	/*!
+	 * \internal
+	 *
+	 * Generates json statistics for \a categories into \a report
+	 */
+	void generate_report(uint64_t categories, rapidjson::Document &report);
+
 	/*!
 	 * \internal
 	 *
@@ -317,6 +353,27 @@ private:
 	 */
 	command_histograms				m_indx_internal_histograms;
 
+	/*!
+	 * \internal
+	 *
+	 * The most requested keys of each backend
+	 */
+	hot_keys					m_hot_keys;
+
+	/*!
+	 * \internal
+	 *
+	 * Time spent by requests at each stage of processing
+	 */
+	request_stages					m_request_stages;
+
+	/*!
+	 * \internal
+	 *
+	 * The last slow and sampled requests
+	 */
+	slow_requests					m_slow_requests;
+
 	/*!
 	 * \internal
 	 *
@@ -324,6 +381,13 @@ private:
 	 */
 	mutable std::mutex				m_provider_mutex;
 	std::vector<std::pair<std::unique_ptr<stat_provider>, std::string>>	m_stat_providers;
+
+	/*!
+	 * \internal
+	 *
+	 * Recently generated reports
+	 */
+	report_cache					m_report_cache;
 };
 
 }} /* namespace ioremap::monitor */
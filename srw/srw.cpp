@@ -87,6 +87,10 @@ class dnet_upstream_t: public cocaine::api::stream_t
 			SRW_LOG(*m_node->log, DNET_LOG_ERROR, "app/" + m_name, "%s: %d", message, code);
 		}
 
+		/*
+		 * Reply is sent without intermediate buffers: the only copy of the payload
+		 * is made when it is queued into the send queue of the client's state
+		 */
 		void reply(bool completed, const char *reply, size_t size) {
 			std::unique_lock<std::mutex> guard(m_lock);
 			if (m_completed)
@@ -390,20 +394,16 @@ class srw {
 
 				std::string s = Json::StyledWriter().write(info);
 
-				struct sph *reply;
-				std::string tmp;
-
-				tmp.resize(sizeof(struct sph));
-				reply = (struct sph *)tmp.data();
+				std::vector<char> header(sizeof(struct sph) + event.size());
+				struct sph *reply = (struct sph *)header.data();
 
+				memset(reply, 0, sizeof(struct sph));
 				reply->event_size = event.size();
 				reply->data_size = s.size();
 				memcpy(&reply->addr, &st->n->addrs[0], sizeof(struct dnet_addr));
+				memcpy(reply + 1, event.data(), event.size());
 
-				tmp += event;
-				tmp += s;
-
-				err = dnet_send_reply(st, cmd, (void *)tmp.data(), tmp.size(), 0);
+				err = dnet_send_reply_data(st, cmd, header.data(), header.size(), s.data(), s.size(), 0);
 				dnet_log(m_node, DNET_LOG_INFO, "%s: sph: %s: %s: info request complete", id_str, sph_str, event.c_str());
 
 			} else if (sph->flags & (DNET_SPH_FLAGS_REPLY | DNET_SPH_FLAGS_FINISH)) {
@@ -349,6 +349,59 @@ static void test_set_backend_ids_for_enabled(session &sess)
 	BOOST_REQUIRE(compare_ids(ids, route_ids));
 }
 
+static void test_migrate_backend_ids(session &sess)
+{
+	const key id = std::string("migrate-backend-ids-test");
+	const std::string data = "migrate-backend-ids-data";
+
+	ELLIPTICS_REQUIRE(async_write, sess.write_data(id, data, 0));
+	const write_result_entry written = async_write.get_one();
+	const address owner(*written.address());
+	const uint32_t owner_backend = written.command()->backend_id;
+
+	// Any other enabled backend of the group receives the key by the new id equal to the key
+	address target;
+	uint32_t target_backend = 0;
+	for (size_t i = 0; i < nodes_count; ++i) {
+		for (uint32_t backend_id : { 0, 3 }) {
+			const address remote = global_data->nodes[i].remote();
+			if (!(remote == owner && backend_id == owner_backend)) {
+				target = remote;
+				target_backend = backend_id;
+			}
+		}
+	}
+
+	id.transform(sess);
+
+	auto ids = backend_ids(sess, target, target_backend);
+	ids.push_back(id.raw_id());
+
+	ELLIPTICS_REQUIRE(async_migrate_result, sess.migrate_backend_ids(target, target_backend, ids));
+
+	// Wait 0.1 secs to ensure that route list was changed
+	usleep(100 * 1000);
+
+	// The key is either already copied or the read is proxied to its previous owner
+	ELLIPTICS_REQUIRE(async_read, sess.read_data(id, 0, 0));
+	BOOST_REQUIRE_EQUAL(async_read.get_one().file().to_string(), data);
+
+	// Direct reads are never proxied, so the key is found only when it is copied
+	session direct = sess.clone();
+	direct.set_exceptions_policy(session::no_exceptions);
+	direct.set_direct_id(target, target_backend);
+
+	int err = -ENOENT;
+	for (int i = 0; i < 50 && err; ++i) {
+		auto async_direct_read = direct.read_data(id, 0, 0);
+		async_direct_read.wait();
+		err = async_direct_read.error().code();
+		if (err)
+			usleep(100 * 1000);
+	}
+	BOOST_REQUIRE_EQUAL(err, 0);
+}
+
 static void test_make_backend_readonly(session &sess)
 {
 	server_node &node = global_data->nodes.back();
@@ -450,6 +503,7 @@ bool register_tests(test_suite *suite, node n)
 	ELLIPTICS_TEST_CASE(test_direct_backend, create_session(n, { 0 }, 0, 0));
 	ELLIPTICS_TEST_CASE(test_set_backend_ids_for_disabled, create_session(n, { 0 }, 0, 0));
 	ELLIPTICS_TEST_CASE(test_set_backend_ids_for_enabled, create_session(n, { 0 }, 0, 0));
+	ELLIPTICS_TEST_CASE(test_migrate_backend_ids, create_session(n, { 0 }, 0, 0));
 	ELLIPTICS_TEST_CASE(test_make_backend_readonly, create_session(n, { 0 }, 0, 0));
 	ELLIPTICS_TEST_CASE(test_make_backend_writeable, create_session(n, { 0 }, 0, 0));
 	ELLIPTICS_TEST_CASE(test_change_group, create_session(n, { 0 }, 0, 0));
@@ -0,0 +1,735 @@
+/*
+ * 2015+ Copyright (c) Evgeniy Polyakov <zbr@ioremap.net>
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/*
+ * Microbenchmarks of server internals: route table lookup, transaction tree,
+ * operation locks, slru cache, iterator responses sorting, index tables update and key transformation.
+ *
+ * Every benchmark is run with every requested number of threads,
+ * results are printed either as text table or as one json object per line.
+ */
+
+#include "../cache/cache.hpp"
+#include "../cache/slru_cache.hpp"
+#include "../bindings/cpp/session_indexes.hpp"
+
+#include <elliptics/session.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace ioremap;
+
+namespace benchmarks {
+
+/*
+ * Number of pregenerated random keys per thread
+ */
+static const size_t keys_count = 4096;
+
+static std::vector<dnet_id> generate_ids(size_t count, uint64_t seed, int group_id)
+{
+	std::mt19937_64 random(seed);
+	std::vector<dnet_id> ids(count);
+
+	for (auto it = ids.begin(); it != ids.end(); ++it) {
+		memset(&*it, 0, sizeof(dnet_id));
+		for (size_t i = 0; i < DNET_ID_SIZE; i += sizeof(uint64_t)) {
+			uint64_t value = random();
+			memcpy(it->id + i, &value, std::min(sizeof(value), DNET_ID_SIZE - i));
+		}
+		it->group_id = group_id;
+	}
+
+	return ids;
+}
+
+/*
+ * Network state which is not connected anywhere:
+ * replies are queued into its send list, but are never sent since the state is marked as exiting
+ */
+class fake_state {
+public:
+	fake_state(dnet_node *n) {
+		m_st = (dnet_net_state *)calloc(1, sizeof(dnet_net_state));
+		if (!m_st)
+			throw std::bad_alloc();
+
+		m_st->n = n;
+		m_st->read_s = m_st->write_s = -1;
+		m_st->__need_exit = -EPIPE;
+		m_st->weight = DNET_STATE_DEFAULT_WEIGHT;
+		atomic_init(&m_st->refcnt, 1);
+		INIT_LIST_HEAD(&m_st->idc_list);
+		INIT_LIST_HEAD(&m_st->send_list);
+		pthread_mutex_init(&m_st->send_lock, NULL);
+		pthread_mutex_init(&m_st->trans_lock, NULL);
+	}
+
+	~fake_state() {
+		drain();
+
+		pthread_mutex_lock(&m_st->n->state_lock);
+		dnet_idc_destroy_nolock(m_st);
+		pthread_mutex_unlock(&m_st->n->state_lock);
+
+		pthread_mutex_destroy(&m_st->send_lock);
+		pthread_mutex_destroy(&m_st->trans_lock);
+		free(m_st);
+	}
+
+	dnet_net_state *get() {
+		return m_st;
+	}
+
+	/*
+	 * Frees all queued replies
+	 */
+	void drain() {
+		pthread_mutex_lock(&m_st->send_lock);
+		while (!list_empty(&m_st->send_list)) {
+			list_head *entry = m_st->send_list.next;
+			dnet_io_req *r = (dnet_io_req *)((char *)entry - offsetof(dnet_io_req, req_entry));
+
+			list_del(entry);
+			dnet_io_req_free(r);
+		}
+		pthread_mutex_unlock(&m_st->send_lock);
+	}
+
+private:
+	fake_state(const fake_state &) = delete;
+	fake_state &operator =(const fake_state &) = delete;
+
+	dnet_net_state *m_st;
+};
+
+class benchmark {
+public:
+	benchmark(const std::string &name, uint64_t iterations)
+	: m_name(name), m_iterations(iterations) {}
+	virtual ~benchmark() {}
+
+	const std::string &name() const {
+		return m_name;
+	}
+
+	uint64_t iterations() const {
+		return m_iterations;
+	}
+
+	/*
+	 * Called before every run with \a threads threads
+	 */
+	virtual void prepare(size_t threads) {
+		(void) threads;
+	}
+
+	/*
+	 * Executes \a iterations iterations of the benchmark in thread \a thread
+	 */
+	virtual void run(size_t thread, uint64_t iterations) = 0;
+
+private:
+	std::string	m_name;
+	uint64_t	m_iterations;
+};
+
+/*
+ * Route table of 32 nodes with 4 backends each and 64 ids per backend in the same group,
+ * lookups are done by dnet_state_get_first_with_backend() which takes node's state_lock
+ * or by dnet_state_search_nolock() which shows the cost of the search itself
+ */
+class route_lookup : public benchmark {
+public:
+	route_lookup(dnet_node *n, bool locked, uint64_t iterations)
+	: benchmark(locked ? "route_get_first" : "route_search_nolock", iterations)
+	, m_node(n)
+	, m_locked(locked)
+	{
+		const size_t states_count = 32, backends_count = 4, ids_count = 64;
+
+		for (size_t i = 0; i < states_count; ++i) {
+			m_states.emplace_back(new fake_state(n));
+
+			for (size_t backend_id = 0; backend_id < backends_count; ++backend_id) {
+				std::vector<char> buffer(sizeof(dnet_backend_ids) + ids_count * sizeof(dnet_raw_id));
+				dnet_backend_ids *backend = (dnet_backend_ids *)buffer.data();
+
+				backend->backend_id = backend_id;
+				backend->group_id = 1;
+				backend->flags = 0;
+				backend->ids_count = ids_count;
+
+				auto ids = generate_ids(ids_count, i * backends_count + backend_id + 1, 1);
+				for (size_t j = 0; j < ids_count; ++j)
+					memcpy(backend->ids[j].id, ids[j].id, DNET_ID_SIZE);
+
+				int err = dnet_idc_update_backend(m_states.back()->get(), backend);
+				if (err)
+					throw std::runtime_error("failed to update route table: " + std::to_string(err));
+			}
+		}
+	}
+
+	virtual void prepare(size_t threads) {
+		m_ids.clear();
+		for (size_t i = 0; i < threads; ++i)
+			m_ids.emplace_back(generate_ids(keys_count, 1000 + i, 1));
+	}
+
+	virtual void run(size_t thread, uint64_t iterations) {
+		const std::vector<dnet_id> &ids = m_ids[thread];
+		int backend_id;
+
+		for (uint64_t i = 0; i < iterations; ++i) {
+			const dnet_id &id = ids[i % keys_count];
+			dnet_net_state *st;
+
+			if (m_locked)
+				st = dnet_state_get_first_with_backend(m_node, &id, &backend_id);
+			else
+				st = dnet_state_search_nolock(m_node, &id, &backend_id);
+			dnet_state_put(st);
+		}
+	}
+
+private:
+	dnet_node					*m_node;
+	bool						m_locked;
+	std::vector<std::unique_ptr<fake_state>>	m_states;
+	std::vector<std::vector<dnet_id>>		m_ids;
+};
+
+/*
+ * Insert, search and remove of transaction into the tree of single state
+ * which already contains 10000 transactions in flight
+ */
+class transactions : public benchmark {
+public:
+	transactions(dnet_node *n, uint64_t iterations)
+	: benchmark("trans_insert_search_remove", iterations)
+	, m_node(n)
+	, m_state(n)
+	{
+		dnet_net_state *st = m_state.get();
+
+		for (uint64_t i = 0; i < 10000; ++i) {
+			dnet_trans *t = dnet_trans_alloc(n, 0);
+			t->trans = i * 7919;
+			dnet_trans_insert_nolock(st, t);
+			m_background.push_back(t);
+		}
+	}
+
+	~transactions() {
+		dnet_net_state *st = m_state.get();
+
+		for (auto it = m_background.begin(); it != m_background.end(); ++it) {
+			dnet_trans_remove_nolock(st, *it);
+			dnet_trans_put(*it);
+		}
+	}
+
+	virtual void run(size_t thread, uint64_t iterations) {
+		dnet_net_state *st = m_state.get();
+		const uint64_t base = (uint64_t)(thread + 1) << 40;
+
+		for (uint64_t i = 0; i < iterations; ++i) {
+			dnet_trans *t = dnet_trans_alloc(m_node, 0);
+			t->trans = base + i;
+
+			pthread_mutex_lock(&st->trans_lock);
+			dnet_trans_insert_nolock(st, t);
+			pthread_mutex_unlock(&st->trans_lock);
+
+			pthread_mutex_lock(&st->trans_lock);
+			dnet_trans *found = dnet_trans_search(st, t->trans);
+			pthread_mutex_unlock(&st->trans_lock);
+			dnet_trans_put(found);
+
+			pthread_mutex_lock(&st->trans_lock);
+			dnet_trans_remove_nolock(st, t);
+			pthread_mutex_unlock(&st->trans_lock);
+
+			dnet_trans_put(t);
+		}
+	}
+
+private:
+	dnet_node			*m_node;
+	fake_state			m_state;
+	std::vector<dnet_trans *>	m_background;
+};
+
+/*
+ * Acquire and release of operation lock, either of random keys or of the same key by all threads
+ */
+class oplock : public benchmark {
+public:
+	oplock(dnet_node *n, bool same_key, uint64_t iterations)
+	: benchmark(same_key ? "oplock_same_key" : "oplock_random_keys", iterations)
+	, m_node(n)
+	, m_same_key(same_key)
+	{}
+
+	virtual void prepare(size_t threads) {
+		m_ids.clear();
+		for (size_t i = 0; i < threads; ++i)
+			m_ids.emplace_back(generate_ids(m_same_key ? 1 : keys_count, m_same_key ? 1 : 2000 + i, 1));
+	}
+
+	virtual void run(size_t thread, uint64_t iterations) {
+		std::vector<dnet_id> &ids = m_ids[thread];
+
+		for (uint64_t i = 0; i < iterations; ++i) {
+			dnet_id &id = ids[i % ids.size()];
+
+			dnet_oplock(m_node, &id);
+			dnet_opunlock(m_node, &id);
+		}
+	}
+
+private:
+	dnet_node				*m_node;
+	bool					m_same_key;
+	std::vector<std::vector<dnet_id>>	m_ids;
+};
+
+/*
+ * Reads and writes of 1 KiB objects of 65536 keys key space into cache-only slru cache.
+ * Eviction variant uses cache which is 8 times smaller than the key space.
+ */
+class slru_cache : public benchmark {
+public:
+	enum mode_t {
+		mode_write,
+		mode_read,
+		mode_evict
+	};
+
+	slru_cache(dnet_node *n, mode_t mode, uint64_t iterations)
+	: benchmark(mode == mode_write ? "cache_write" : (mode == mode_read ? "cache_read" : "cache_write_evict"), iterations)
+	, m_node(n)
+	, m_mode(mode)
+	, m_data(value_size, 'x')
+	, m_keys(generate_ids(key_space, 3000, 1))
+	{
+		memset(&m_backend, 0, sizeof(m_backend));
+
+		const size_t cache_size = (mode == mode_evict) ? key_space * value_size / 8 : key_space * value_size * 4;
+		m_cache.reset(new cache::slru_cache_t(&m_backend, n,
+					std::vector<size_t>({cache_size / 2, cache_size / 2}), 3600));
+
+		if (mode == mode_read) {
+			fake_state state(n);
+			for (size_t i = 0; i < key_space; ++i)
+				write(state, m_keys[i]);
+		}
+	}
+
+	~slru_cache() {
+		m_backend.need_exit = 1;
+		m_cache.reset();
+	}
+
+	virtual void prepare(size_t threads) {
+		m_states.clear();
+		for (size_t i = 0; i < threads; ++i)
+			m_states.emplace_back(new fake_state(m_node));
+	}
+
+	virtual void run(size_t thread, uint64_t iterations) {
+		fake_state &state = *m_states[thread];
+		std::mt19937_64 random(4000 + thread);
+
+		for (uint64_t i = 0; i < iterations; ++i) {
+			dnet_id &id = m_keys[random() % key_space];
+
+			if (m_mode == mode_read) {
+				dnet_cmd cmd;
+				dnet_io_attr io;
+				prepare_request(id, DNET_CMD_READ, &cmd, &io);
+
+				m_cache->read(id.id, &cmd, &io);
+			} else {
+				write(state, id);
+			}
+
+			if ((i & 255) == 255)
+				state.drain();
+		}
+
+		state.drain();
+	}
+
+private:
+	enum {
+		key_space = 65536,
+		value_size = 1024
+	};
+
+	void prepare_request(const dnet_id &id, int command, dnet_cmd *cmd, dnet_io_attr *io) {
+		memset(cmd, 0, sizeof(dnet_cmd));
+		memset(io, 0, sizeof(dnet_io_attr));
+
+		cmd->id = id;
+		cmd->cmd = command;
+		cmd->size = sizeof(dnet_io_attr) + value_size;
+
+		memcpy(io->id, id.id, DNET_ID_SIZE);
+		io->flags = DNET_IO_FLAGS_CACHE | DNET_IO_FLAGS_CACHE_ONLY;
+		io->size = value_size;
+	}
+
+	void write(fake_state &state, const dnet_id &id) {
+		dnet_cmd cmd;
+		dnet_io_attr io;
+		prepare_request(id, DNET_CMD_WRITE, &cmd, &io);
+
+		m_cache->write(id.id, state.get(), &cmd, &io, m_data.data());
+	}
+
+	dnet_node					*m_node;
+	mode_t						m_mode;
+	std::string					m_data;
+	std::vector<dnet_id>				m_keys;
+	dnet_backend_io					m_backend;
+	std::unique_ptr<cache::slru_cache_t>		m_cache;
+	std::vector<std::unique_ptr<fake_state>>	m_states;
+};
+
+/*
+ * Sorting of 65536 iterator responses by dnet_iterator_response_container_sort(),
+ * every thread sorts its own container
+ */
+class iterator_sort : public benchmark {
+public:
+	iterator_sort(uint64_t iterations)
+	: benchmark("iterator_response_sort_64k", iterations)
+	{}
+
+	~iterator_sort() {
+		close_files();
+	}
+
+	virtual void prepare(size_t threads) {
+		close_files();
+
+		std::mt19937_64 random(5000);
+		m_responses.resize(responses_count);
+		for (auto it = m_responses.begin(); it != m_responses.end(); ++it) {
+			memset(&*it, 0, sizeof(dnet_iterator_response));
+			for (size_t i = 0; i < DNET_ID_SIZE; i += sizeof(uint64_t)) {
+				uint64_t value = random();
+				memcpy(it->key.id + i, &value, std::min(sizeof(value), DNET_ID_SIZE - i));
+			}
+		}
+
+		for (size_t i = 0; i < threads; ++i) {
+			char path[] = "/tmp/dnet-benchmark-XXXXXX";
+			int fd = mkstemp(path);
+			if (fd < 0)
+				throw std::runtime_error("failed to create temporary file");
+			unlink(path);
+			m_fds.push_back(fd);
+		}
+	}
+
+	virtual void run(size_t thread, uint64_t iterations) {
+		const int fd = m_fds[thread];
+		const size_t size = m_responses.size() * sizeof(dnet_iterator_response);
+
+		for (uint64_t i = 0; i < iterations; ++i) {
+			if (pwrite(fd, m_responses.data(), size, 0) != (ssize_t)size)
+				throw std::runtime_error("failed to write responses");
+
+			int err = dnet_iterator_response_container_sort(fd, size);
+			if (err)
+				throw std::runtime_error("failed to sort responses: " + std::to_string(err));
+		}
+	}
+
+private:
+	enum {
+		responses_count = 65536
+	};
+
+	void close_files() {
+		for (auto it = m_fds.begin(); it != m_fds.end(); ++it)
+			close(*it);
+		m_fds.clear();
+	}
+
+	std::vector<dnet_iterator_response>	m_responses;
+	std::vector<int>			m_fds;
+};
+
+/*
+ * Insertion of new entry into index table of 1000 entries by convert_index_table(),
+ * it includes unpacking and packing of the whole table by msgpack
+ */
+class index_convert : public benchmark {
+public:
+	index_convert(dnet_node *n, uint64_t iterations)
+	: benchmark("index_convert_1000", iterations)
+	, m_node(n)
+	, m_index_data(elliptics::data_pointer::copy(std::string(64, 'i')))
+	{
+		memset(&m_request, 0, sizeof(m_request));
+		memset(&m_entry, 0, sizeof(m_entry));
+		m_request.id = generate_ids(1, 6000, 1)[0];
+
+		auto ids = generate_ids(1000, 6001, 1);
+		for (auto it = ids.begin(); it != ids.end(); ++it)
+			m_table = insert(&*it, m_table);
+	}
+
+	virtual void prepare(size_t threads) {
+		m_ids.clear();
+		for (size_t i = 0; i < threads; ++i)
+			m_ids.emplace_back(generate_ids(keys_count, 7000 + i, 1));
+	}
+
+	virtual void run(size_t thread, uint64_t iterations) {
+		std::vector<dnet_id> &ids = m_ids[thread];
+
+		for (uint64_t i = 0; i < iterations; ++i)
+			insert(&ids[i % keys_count], m_table);
+	}
+
+private:
+	elliptics::data_pointer insert(dnet_id *id, const elliptics::data_pointer &table) {
+		std::vector<dnet_indexes_reply_entry> *removed = NULL;
+		dnet_indexes_request request = m_request;
+		memcpy(request.id.id, id->id, DNET_ID_SIZE);
+
+		return elliptics::convert_index_table(m_node, &m_request.id, &request, m_index_data, table,
+				DNET_INDEXES_FLAGS_INTERNAL_INSERT, removed, m_entry);
+	}
+
+	dnet_node				*m_node;
+	elliptics::data_pointer			m_index_data;
+	elliptics::data_pointer			m_table;
+	dnet_indexes_request			m_request;
+	dnet_indexes_request_entry		m_entry;
+	std::vector<std::vector<dnet_id>>	m_ids;
+};
+
+/*
+ * Transformation of 32 bytes key into id
+ */
+class key_transform : public benchmark {
+public:
+	key_transform(dnet_node *n, uint64_t iterations)
+	: benchmark("key_transform", iterations)
+	, m_node(n)
+	{}
+
+	virtual void run(size_t thread, uint64_t iterations) {
+		char key[32];
+		dnet_raw_id id;
+
+		memset(key, 'k', sizeof(key));
+		memcpy(key, &thread, sizeof(thread));
+
+		for (uint64_t i = 0; i < iterations; ++i) {
+			memcpy(key + sizeof(thread), &i, sizeof(i));
+			dnet_transform_node(m_node, key, sizeof(key), id.id, sizeof(id.id));
+		}
+	}
+
+private:
+	dnet_node	*m_node;
+};
+
+struct result {
+	std::string	name;
+	size_t		threads;
+	uint64_t	operations;
+	double		seconds;
+};
+
+/*
+ * Runs \a iterations iterations of benchmark \a b in every of \a threads threads simultaneously
+ */
+static result run(benchmark &b, size_t threads, uint64_t iterations)
+{
+	std::atomic<size_t> ready(0);
+	std::atomic<bool> start(false);
+	std::vector<std::thread> workers;
+
+	b.prepare(threads);
+
+	for (size_t i = 0; i < threads; ++i) {
+		workers.emplace_back([&, i] () {
+			++ready;
+			while (!start.load())
+				std::this_thread::yield();
+
+			b.run(i, iterations);
+		});
+	}
+
+	while (ready.load() < threads)
+		std::this_thread::yield();
+
+	const auto begin = std::chrono::steady_clock::now();
+	start = true;
+
+	for (auto it = workers.begin(); it != workers.end(); ++it)
+		it->join();
+
+	const auto end = std::chrono::steady_clock::now();
+
+	result ret;
+	ret.name = b.name();
+	ret.threads = threads;
+	ret.operations = iterations * threads;
+	ret.seconds = std::chrono::duration<double>(end - begin).count();
+	return ret;
+}
+
+static void print(const result &r, bool json)
+{
+	const double ops_per_second = r.operations / r.seconds;
+	/* average time of single operation in single thread */
+	const double ns_per_operation = r.seconds * 1e9 * r.threads / r.operations;
+	char line[256];
+
+	if (json) {
+		snprintf(line, sizeof(line), "{\"benchmark\": \"%s\", \"threads\": %zu, \"operations\": %llu, "
+				"\"seconds\": %.6f, \"ops_per_second\": %.1f, \"ns_per_operation\": %.1f}",
+				r.name.c_str(), r.threads, (unsigned long long)r.operations,
+				r.seconds, ops_per_second, ns_per_operation);
+	} else {
+		snprintf(line, sizeof(line), "%-28s threads: %3zu, operations: %10llu, time: %9.3f s, "
+				"%14.1f ops/s, %10.1f ns/op",
+				r.name.c_str(), r.threads, (unsigned long long)r.operations,
+				r.seconds, ops_per_second, ns_per_operation);
+	}
+
+	std::cout << line << std::endl;
+}
+
+} // namespace benchmarks
+
+int main(int argc, char *argv[])
+{
+	namespace bpo = boost::program_options;
+	using namespace benchmarks;
+
+	bpo::options_description generic("Microbenchmarks of server internals");
+
+	std::string threads_list, filter, format;
+	double scale;
+
+	generic.add_options()
+		("help", "This help message")
+		("threads", bpo::value<std::string>(&threads_list)->default_value("1,2,4,8"),
+			"Comma-separated list of numbers of threads to run every benchmark with")
+		("filter", bpo::value<std::string>(&filter), "Run only benchmarks which names contain this substring")
+		("scale", bpo::value<double>(&scale)->default_value(1), "Multiplier of default number of iterations")
+		("format", bpo::value<std::string>(&format)->default_value("text"), "Output format: text or json")
+		;
+
+	bpo::variables_map vm;
+	std::vector<size_t> threads;
+
+	try {
+		bpo::store(bpo::command_line_parser(argc, argv).options(generic).run(), vm);
+
+		if (vm.count("help")) {
+			std::cout << generic << std::endl;
+			return 0;
+		}
+
+		bpo::notify(vm);
+
+		for (auto &number : elliptics::parse_groups(threads_list.c_str())) {
+			if (number <= 0)
+				throw std::invalid_argument("number of threads must be positive");
+			threads.push_back(number);
+		}
+		if (threads.empty())
+			throw std::invalid_argument("no threads specified");
+		if (format != "text" && format != "json")
+			throw std::invalid_argument("unknown format: " + format);
+		if (scale <= 0)
+			throw std::invalid_argument("scale must be positive");
+	} catch (const std::exception &e) {
+		std::cerr << "Invalid options: " << e.what() << "\n" << generic << std::endl;
+		return -1;
+	}
+
+	elliptics::file_logger logger("/dev/stderr", DNET_LOG_ERROR);
+	elliptics::node node(elliptics::logger(logger, blackhole::log::attributes_t()));
+	dnet_node *n = node.get_native();
+
+	int err = dnet_locks_init(n, 1024);
+	if (err) {
+		std::cerr << "Failed to initialize operation locks: " << err << std::endl;
+		return -1;
+	}
+
+	typedef std::function<benchmark *()> factory;
+	const auto iterations = [scale] (uint64_t count) {
+		return std::max<uint64_t>(1, count * scale);
+	};
+
+	const std::vector<std::pair<std::string, factory>> factories = {
+		{ "route_get_first", [&] () { return new route_lookup(n, true, iterations(1000000)); } },
+		{ "route_search_nolock", [&] () { return new route_lookup(n, false, iterations(1000000)); } },
+		{ "trans_insert_search_remove", [&] () { return new transactions(n, iterations(500000)); } },
+		{ "oplock_random_keys", [&] () { return new oplock(n, false, iterations(1000000)); } },
+		{ "oplock_same_key", [&] () { return new oplock(n, true, iterations(200000)); } },
+		{ "cache_write", [&] () { return new slru_cache(n, slru_cache::mode_write, iterations(200000)); } },
+		{ "cache_read", [&] () { return new slru_cache(n, slru_cache::mode_read, iterations(500000)); } },
+		{ "cache_write_evict", [&] () { return new slru_cache(n, slru_cache::mode_evict, iterations(200000)); } },
+		{ "iterator_response_sort_64k", [&] () { return new iterator_sort(iterations(20)); } },
+		{ "index_convert_1000", [&] () { return new index_convert(n, iterations(2000)); } },
+		{ "key_transform", [&] () { return new key_transform(n, iterations(1000000)); } },
+	};
+
+	try {
+		for (auto it = factories.begin(); it != factories.end(); ++it) {
+			if (!filter.empty() && it->first.find(filter) == std::string::npos)
+				continue;
+
+			std::unique_ptr<benchmark> b(it->second());
+			for (auto jt = threads.begin(); jt != threads.end(); ++jt)
+				print(run(*b, *jt, b->iterations()), format == "json");
+		}
+	} catch (const std::exception &e) {
+		std::cerr << "Benchmark failed: " << e.what() << std::endl;
+		err = -1;
+	}
+
+	dnet_locks_destroy(n);
+
+	return err;
+}
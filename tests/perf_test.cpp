@@ -0,0 +1,454 @@
+/*
+ * 2015+ Copyright (c) Evgeniy Polyakov <zbr@ioremap.net>
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/*
+ * Loopback performance harness: starts local servers via start_nodes(),
+ * drives fixed workloads for fixed duration and reports throughput, latency percentiles
+ * and cpu time per operation as json, so results of different builds can be compared on the same machine.
+ */
+
+#include "test_base.hpp"
+
+#include <boost/program_options.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/prettywriter.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace tests {
+
+struct perf_options {
+	int		servers;
+	int		backends;
+	int		io_threads;
+	int		nonblocking_io_threads;
+	int		net_threads;
+	int64_t		cache_size;
+	bool		fork;
+
+	int		concurrency;
+	double		duration;
+	double		warmup;
+
+	int		keys;
+	int		small_size;
+	int		large_keys;
+	int		large_size;
+	int		bulk_size;
+	int		indexes;
+};
+
+static const int perf_group = 1;
+
+struct workload {
+	std::string name;
+	/* executes single operation, returns its error code */
+	std::function<int (session &sess, std::mt19937_64 &random)> operation;
+};
+
+struct workload_result {
+	std::string		name;
+	uint64_t		operations;
+	uint64_t		errors;
+	double			seconds;
+	double			cpu_seconds;
+	std::vector<uint64_t>	latencies;
+};
+
+static std::string small_key(uint64_t index)
+{
+	return "perf-small-" + std::to_string(index);
+}
+
+static std::string large_key(uint64_t index)
+{
+	return "perf-large-" + std::to_string(index);
+}
+
+/*
+ * Returns cpu time in seconds consumed by this process and by forked servers
+ */
+static double cpu_time(const nodes_data &data)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	double ret = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000. +
+		usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.;
+
+	const double ticks = sysconf(_SC_CLK_TCK);
+
+	for (auto it = data.nodes.begin(); it != data.nodes.end(); ++it) {
+		if (!it->pid())
+			continue;
+
+		std::ifstream in("/proc/" + std::to_string(it->pid()) + "/stat");
+		std::string stat;
+		std::getline(in, stat);
+
+		/* fields after process name which may contain spaces, utime and stime are 12th and 13th of them */
+		const size_t pos = stat.rfind(')');
+		if (pos == std::string::npos)
+			continue;
+
+		std::istringstream fields(stat.substr(pos + 2));
+		std::string field;
+		unsigned long long utime = 0, stime = 0;
+		for (int i = 0; i < 11 && fields >> field; ++i);
+		fields >> utime >> stime;
+
+		ret += (utime + stime) / ticks;
+	}
+
+	return ret;
+}
+
+static nodes_data::ptr start_perf_nodes(const perf_options &options, const std::string &path)
+{
+	std::vector<server_config> configs;
+
+	for (int i = 0; i < options.servers; ++i) {
+		server_config config = server_config::default_value();
+		config.options
+			("io_thread_num", options.io_threads)
+			("nonblocking_io_thread_num", options.nonblocking_io_threads)
+			("net_thread_num", options.net_threads)
+			("cache_size", options.cache_size)
+			("indexes_shard_count", 1)
+			;
+
+		config.backends[0]("group", perf_group);
+		config.backends.resize(options.backends, config.backends.front());
+		configs.push_back(config);
+	}
+
+	return start_nodes(std::cerr, configs, path, options.fork, false);
+}
+
+static void prepare_write(session &sess, const std::string &id, const std::string &data)
+{
+	auto result = sess.write_data(id, data, 0);
+	result.wait();
+	if (result.error())
+		throw std::runtime_error("failed to write " + id + ": " + result.error().message());
+}
+
+/*
+ * Writes objects which are read by read workloads
+ */
+static void prepare_data(session &sess, const perf_options &options)
+{
+	const std::string small_data(options.small_size, 's');
+	const std::string large_data(options.large_size, 'l');
+
+	for (int i = 0; i < options.keys; ++i)
+		prepare_write(sess, small_key(i), small_data);
+
+	for (int i = 0; i < options.large_keys; ++i)
+		prepare_write(sess, large_key(i), large_data);
+}
+
+static std::vector<workload> create_workloads(session &sess, const perf_options &options)
+{
+	std::vector<workload> workloads;
+
+	workloads.push_back({ "small_read", [options] (session &sess, std::mt19937_64 &random) {
+		auto result = sess.read_data(small_key(random() % options.keys), 0, 0);
+		result.wait();
+		return result.error().code();
+	}});
+
+	workloads.push_back({ "large_read", [options] (session &sess, std::mt19937_64 &random) {
+		auto result = sess.read_data(large_key(random() % options.large_keys), 0, 0);
+		result.wait();
+		return result.error().code();
+	}});
+
+	const data_pointer small_data = data_pointer::copy(std::string(options.small_size, 'w'));
+	workloads.push_back({ "small_write", [options, small_data] (session &sess, std::mt19937_64 &random) {
+		auto result = sess.write_data("perf-write-" + std::to_string(random() % options.keys), small_data, 0);
+		result.wait();
+		return result.error().code();
+	}});
+
+	workloads.push_back({ "bulk_read", [options] (session &sess, std::mt19937_64 &random) {
+		std::vector<std::string> keys;
+		keys.reserve(options.bulk_size);
+		for (int i = 0; i < options.bulk_size; ++i)
+			keys.push_back(small_key(random() % options.keys));
+
+		auto result = sess.bulk_read(keys);
+		result.wait();
+		return result.error().code();
+	}});
+
+	/* one operation is iteration over all keys of single backend without data */
+	std::vector<dnet_id> backends;
+	{
+		std::set<std::pair<std::string, uint32_t>> unique;
+		const auto routes = sess.get_routes();
+
+		for (auto it = routes.begin(); it != routes.end(); ++it) {
+			if (!unique.insert(std::make_pair(std::string(dnet_server_convert_dnet_addr(&it->addr)), it->backend_id)).second)
+				continue;
+
+			dnet_id id;
+			dnet_setup_id(&id, it->group_id, it->id.id);
+			backends.push_back(id);
+		}
+	}
+	if (!backends.empty()) {
+		workloads.push_back({ "iterate", [backends] (session &sess, std::mt19937_64 &random) {
+			const dnet_id &id = backends[random() % backends.size()];
+			auto result = sess.start_iterator(key(id), std::vector<dnet_iterator_range>(), DNET_ITYPE_NETWORK, 0);
+			for (auto it = result.begin(); it != result.end(); ++it);
+			return result.error().code();
+		}});
+	}
+
+	const data_pointer index_data = data_pointer::copy(std::string(64, 'i'));
+	workloads.push_back({ "index_update", [options, index_data] (session &sess, std::mt19937_64 &random) {
+		const std::vector<std::string> indexes(1, "perf-index-" + std::to_string(random() % options.indexes));
+		const std::vector<data_pointer> datas(1, index_data);
+
+		auto result = sess.update_indexes("perf-index-object-" + std::to_string(random() % options.keys), indexes, datas);
+		result.wait();
+		return result.error().code();
+	}});
+
+	return workloads;
+}
+
+/*
+ * Runs \a w by \a options.concurrency threads for \a duration seconds,
+ * latencies are collected only if \a result is not NULL
+ */
+static void run_workload(session &sess, const nodes_data &data, const workload &w, const perf_options &options,
+		double duration, workload_result *result)
+{
+	typedef std::chrono::steady_clock clock;
+
+	std::vector<std::vector<uint64_t>> latencies(options.concurrency);
+	std::atomic<uint64_t> errors(0);
+	std::vector<std::thread> threads;
+
+	const double cpu_begin = cpu_time(data);
+	const auto begin = clock::now();
+	const auto end = begin + std::chrono::microseconds(static_cast<uint64_t>(duration * 1000000));
+
+	for (int i = 0; i < options.concurrency; ++i) {
+		threads.emplace_back([&, i] () {
+			session thread_sess = sess.clone();
+			std::mt19937_64 random(i + 1);
+			std::vector<uint64_t> &thread_latencies = latencies[i];
+
+			for (auto now = clock::now(); now < end; ) {
+				const int err = w.operation(thread_sess, random);
+				const auto finish = clock::now();
+
+				if (err)
+					++errors;
+				thread_latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(finish - now).count());
+				now = finish;
+			}
+		});
+	}
+
+	for (auto it = threads.begin(); it != threads.end(); ++it)
+		it->join();
+
+	if (!result)
+		return;
+
+	result->name = w.name;
+	result->errors = errors;
+	result->seconds = std::chrono::duration<double>(clock::now() - begin).count();
+	result->cpu_seconds = cpu_time(data) - cpu_begin;
+	result->latencies.clear();
+	for (auto it = latencies.begin(); it != latencies.end(); ++it)
+		result->latencies.insert(result->latencies.end(), it->begin(), it->end());
+	result->operations = result->latencies.size();
+	std::sort(result->latencies.begin(), result->latencies.end());
+}
+
+static uint64_t percentile(const std::vector<uint64_t> &sorted, double value)
+{
+	if (sorted.empty())
+		return 0;
+
+	size_t index = static_cast<size_t>(value / 100. * sorted.size());
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void report(std::ostream &out, const perf_options &options, const std::vector<workload_result> &results)
+{
+	rapidjson::Document doc;
+	doc.SetObject();
+	auto &allocator = doc.GetAllocator();
+
+	rapidjson::Value config(rapidjson::kObjectType);
+	config.AddMember("servers", options.servers, allocator);
+	config.AddMember("backends", options.backends, allocator);
+	config.AddMember("io_threads", options.io_threads, allocator);
+	config.AddMember("nonblocking_io_threads", options.nonblocking_io_threads, allocator);
+	config.AddMember("net_threads", options.net_threads, allocator);
+	config.AddMember("cache_size", options.cache_size, allocator);
+	config.AddMember("fork", options.fork, allocator);
+	config.AddMember("concurrency", options.concurrency, allocator);
+	config.AddMember("duration", options.duration, allocator);
+	config.AddMember("keys", options.keys, allocator);
+	config.AddMember("small_size", options.small_size, allocator);
+	config.AddMember("large_size", options.large_size, allocator);
+	config.AddMember("bulk_size", options.bulk_size, allocator);
+	config.AddMember("cpus", static_cast<int>(std::thread::hardware_concurrency()), allocator);
+	doc.AddMember("config", config, allocator);
+
+	rapidjson::Value workloads(rapidjson::kArrayType);
+	for (auto it = results.begin(); it != results.end(); ++it) {
+		rapidjson::Value value(rapidjson::kObjectType);
+		rapidjson::Value name;
+		name.SetString(it->name.c_str(), it->name.size(), allocator);
+
+		value.AddMember("name", name, allocator);
+		value.AddMember("operations", it->operations, allocator);
+		value.AddMember("errors", it->errors, allocator);
+		value.AddMember("seconds", it->seconds, allocator);
+		value.AddMember("ops_per_second", it->operations / it->seconds, allocator);
+		value.AddMember("latency_us_p50", percentile(it->latencies, 50), allocator);
+		value.AddMember("latency_us_p99", percentile(it->latencies, 99), allocator);
+		value.AddMember("latency_us_max", it->latencies.empty() ? 0 : it->latencies.back(), allocator);
+		value.AddMember("cpu_us_per_operation",
+				it->operations ? it->cpu_seconds * 1000000. / it->operations : 0., allocator);
+		workloads.PushBack(value, allocator);
+	}
+	doc.AddMember("workloads", workloads, allocator);
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+	doc.Accept(writer);
+
+	out.write(buffer.GetString(), buffer.Size());
+	out << std::endl;
+}
+
+} // namespace tests
+
+int main(int argc, char *argv[])
+{
+	namespace bpo = boost::program_options;
+	using namespace tests;
+
+	perf_options options;
+	std::string path, output;
+	std::vector<std::string> names;
+
+	bpo::options_description generic("Loopback performance test options");
+	generic.add_options()
+		("help", "This help message")
+		("path", bpo::value(&path), "Path where to store servers' data, temporary directory is used by default")
+		("output", bpo::value(&output), "File to write json report to, stdout is used by default")
+		("workload", bpo::value(&names), "Workload to run (small_read, large_read, small_write, bulk_read, iterate, "
+			"index_update), may be specified multiple times, all workloads are run by default")
+		("servers", bpo::value(&options.servers)->default_value(2), "Number of servers")
+		("backends", bpo::value(&options.backends)->default_value(2), "Number of backends per server")
+		("io-threads", bpo::value(&options.io_threads)->default_value(4), "Number of blocking io threads per backend")
+		("nonblocking-io-threads", bpo::value(&options.nonblocking_io_threads)->default_value(4),
+			"Number of nonblocking io threads per backend")
+		("net-threads", bpo::value(&options.net_threads)->default_value(2), "Number of net threads per server")
+		("cache-size", bpo::value(&options.cache_size)->default_value(0), "Cache size per server in bytes")
+		("fork", bpo::value(&options.fork)->default_value(false), "Run servers in separate processes")
+		("concurrency", bpo::value(&options.concurrency)->default_value(16), "Number of requests in flight")
+		("duration", bpo::value(&options.duration)->default_value(10), "Duration of every workload in seconds")
+		("warmup", bpo::value(&options.warmup)->default_value(1), "Warmup before every workload in seconds")
+		("keys", bpo::value(&options.keys)->default_value(10000), "Number of small objects")
+		("small-size", bpo::value(&options.small_size)->default_value(4096), "Size of small objects")
+		("large-keys", bpo::value(&options.large_keys)->default_value(64), "Number of large objects")
+		("large-size", bpo::value(&options.large_size)->default_value(1024 * 1024), "Size of large objects")
+		("bulk-size", bpo::value(&options.bulk_size)->default_value(100), "Number of keys in single bulk read")
+		("indexes", bpo::value(&options.indexes)->default_value(16), "Number of indexes updated by index workload")
+		;
+
+	bpo::variables_map vm;
+	try {
+		bpo::store(bpo::parse_command_line(argc, argv, generic), vm);
+		bpo::notify(vm);
+	} catch (const std::exception &e) {
+		std::cerr << "Invalid options: " << e.what() << "\n" << generic << std::endl;
+		return -1;
+	}
+
+	if (vm.count("help")) {
+		std::cerr << generic;
+		return 0;
+	}
+
+	if (options.servers <= 0 || options.backends <= 0 || options.concurrency <= 0 ||
+			options.keys <= 0 || options.large_keys <= 0 || options.bulk_size <= 0 || options.indexes <= 0) {
+		std::cerr << "Invalid options: numbers of servers, backends, requests, keys and indexes must be positive\n"
+			<< generic << std::endl;
+		return -1;
+	}
+
+	srand(0);
+
+	try {
+		nodes_data::ptr data = start_perf_nodes(options, path);
+		session sess = create_session(*data->node, {perf_group}, 0, 0);
+
+		std::cerr << "Preparing data" << std::endl;
+		prepare_data(sess, options);
+
+		std::vector<workload_result> results;
+		auto workloads = create_workloads(sess, options);
+
+		for (auto it = workloads.begin(); it != workloads.end(); ++it) {
+			if (!names.empty() && std::find(names.begin(), names.end(), it->name) == names.end())
+				continue;
+
+			std::cerr << "Running workload: " << it->name << std::endl;
+
+			if (options.warmup > 0)
+				run_workload(sess, *data, *it, options, options.warmup, NULL);
+
+			workload_result result;
+			run_workload(sess, *data, *it, options, options.duration, &result);
+			results.push_back(result);
+		}
+
+		if (output.empty()) {
+			report(std::cout, options, results);
+		} else {
+			std::ofstream out(output.c_str());
+			report(out, options, results);
+		}
+	} catch (const std::exception &e) {
+		std::cerr << "Performance test failed: " << e.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -43,3 +43,55 @@ class TestSession:
         for category in elliptics.monitor_stat_categories.values.values():
             stat = session.monitor_stat(addr, categories=category).get()[0]
             assert stat
+
+    def test_monitor_incremental(self, server, simple_node):
+        session = make_session(node=simple_node,
+                               test_name='TestSession.test_monitor_incremental')
+        addr = session.routes.addresses()[0]
+
+        full = session.monitor_stat(addr).get()[0].statistics
+        assert 'version' in full
+        version = full['version']
+
+        stat = session.monitor_stat(addr, since_version=version).get()[0]
+        assert stat.error.code == 0
+        changes = stat.statistics
+        assert changes['since'] == version
+        assert changes['version'] >= version
+        assert set(changes.keys()) <= set(full.keys()) | set(['since'])
+
+    def test_monitor_hot_keys(self, server, simple_node):
+        session = make_session(node=simple_node,
+                               test_name='TestSession.test_monitor_hot_keys')
+        addr = session.routes.addresses()[0]
+
+        stat = session.monitor_stat(addr, categories=elliptics.monitor_stat_categories.hot_keys).get()[0]
+        assert stat.error.code == 0
+        assert type(stat.statistics['hot_keys']) == dict
+
+    def test_monitor_request_stages(self, server, simple_node):
+        session = make_session(node=simple_node,
+                               test_name='TestSession.test_monitor_request_stages')
+        addr = session.routes.addresses()[0]
+
+        stat = session.monitor_stat(addr, categories=elliptics.monitor_stat_categories.request_stages).get()[0]
+        assert stat.error.code == 0
+        stages = stat.statistics['request_stages']
+        assert type(stages['backends']) == dict
+        for stage in ('recv', 'wait', 'process', 'send', 'total'):
+            assert stage in stages['node']
+            assert stages['node'][stage]['p50'] <= stages['node'][stage]['p999']
+
+    def test_monitor_slow_requests(self, server, simple_node):
+        session = make_session(node=simple_node,
+                               test_name='TestSession.test_monitor_slow_requests')
+        addr = session.routes.addresses()[0]
+
+        stat = session.monitor_stat(addr, categories=elliptics.monitor_stat_categories.slow_requests).get()[0]
+        assert stat.error.code == 0
+        slow_requests = stat.statistics['slow_requests']
+        assert type(slow_requests['requests']) == list
+        assert len(slow_requests['requests']) <= slow_requests['captured']
+        for request in slow_requests['requests']:
+            assert request['reason'] in ('slow', 'sampled')
+            assert request['stages']['total'] >= request['stages']['process']
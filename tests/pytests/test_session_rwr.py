@@ -191,6 +191,32 @@ class TestSession:
         checked_bulk_write(session, dict.fromkeys(keys, 'data'), data)
         checked_bulk_read(session, keys, data)
 
+    def test_bulk_read_batches(self, server, simple_node):
+        session = make_session(node=simple_node,
+                               test_name='TestSession.test_bulk_read_batches')
+        groups = session.routes.groups()
+        session.groups = groups
+
+        data = 'batch data'
+
+        keys = ['batch key ' + str(i) for i in xrange(100)]
+
+        checked_bulk_write(session, [(key, data) for key in keys], data)
+
+        result = session.bulk_read(keys)
+        results = []
+        while True:
+            batch = result.next_batch(30)
+            if not batch:
+                break
+            assert len(batch) <= 30
+            results.extend(batch)
+
+        assert len(results) == len(keys)
+        for r in results:
+            assert r.data_view.tobytes() == data
+            assert r.data_view.readonly
+
     def test_write_cas(self, server, simple_node):
         session = make_session(node=simple_node,
                                test_name='TestSession.test_write_cas')
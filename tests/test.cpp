@@ -22,6 +22,8 @@
 
 #include <boost/program_options.hpp>
 
+#include <rapidjson/document.h>
+
 using namespace ioremap::elliptics;
 using namespace boost::unit_test;
 
@@ -33,6 +35,15 @@ static void configure_nodes(const std::vector<std::string> &remotes, const std::
 {
 #ifndef NO_SERVER
 	if (remotes.empty()) {
+		// backend of group 3 verifies its records in background every second
+		server_config scrub_config = server_config::default_value().apply_options(config_data()
+			("group", 3)
+		);
+		scrub_config.backends[0]
+			("scrub_rate", 64 * 1024 * 1024)
+			("scrub_interval", 1)
+			("scrub_fresh_time", 3600);
+
 		global_data = start_nodes(results_reporter::get_stream(), std::vector<server_config>({
 			server_config::default_value().apply_options(config_data()
 				("group", 1)
@@ -42,9 +53,7 @@ static void configure_nodes(const std::vector<std::string> &remotes, const std::
 				("group", 2)
 			),
 
-			server_config::default_value().apply_options(config_data()
-				("group", 3)
-			)
+			scrub_config
 		}), path);
 	} else
 #endif // NO_SERVER
@@ -171,6 +180,30 @@ static void test_write(session &sess, const std::string &id, const std::string &
 	BOOST_REQUIRE_EQUAL(result.file().to_string(), data);
 }
 
+/*
+ * Replicated write is sent to the first group only, its node writes the object to the rest ones
+ */
+static void test_write_replicated(session &sess, const std::string &id, const std::string &data)
+{
+	std::vector<int> groups = sess.get_groups();
+
+	ELLIPTICS_REQUIRE(write_result, sess.write_data(id, data, 0));
+
+	sync_write_result write_results = write_result.get();
+	BOOST_REQUIRE_EQUAL(write_results.size(), groups.size());
+
+	session read_sess = sess.clone();
+	read_sess.set_ioflags(sess.get_ioflags() & ~DNET_IO_FLAGS_REPLICATE);
+
+	for (size_t i = 0; i < groups.size(); ++i) {
+		std::vector<int> current_groups(1, groups[i]);
+		ELLIPTICS_REQUIRE(read_result, read_sess.read_data(id, current_groups, 0, 0));
+
+		read_result_entry result = read_result.get_one();
+		BOOST_REQUIRE_EQUAL(result.file().to_string(), data);
+	}
+}
+
 static void test_recovery(session &sess, const std::string &id, const std::string &data)
 {
 	std::vector<int> groups = sess.get_groups();
@@ -751,6 +784,29 @@ static void test_metadata(session &sess, const std::string &id, const std::strin
 	BOOST_REQUIRE_EQUAL(read_entry.io_attribute()->user_flags, unique_flags);
 }
 
+static void test_expire(session &sess, const std::string &id, const std::string &data)
+{
+	const std::string expired_id = id + "-expired";
+
+	sess.set_ttl(3600);
+
+	ELLIPTICS_REQUIRE(write_result, sess.write_data(id, data, 0));
+	ELLIPTICS_COMPARE_REQUIRE(read_result, sess.read_data(id, 0, 0), data);
+	BOOST_REQUIRE_GT(read_result.get_one().io_attribute()->expire, uint64_t(time(NULL)));
+
+	key expired_key(expired_id);
+	expired_key.transform(sess);
+
+	dnet_io_attr io;
+	memset(&io, 0, sizeof(io));
+	memcpy(io.id, expired_key.raw_id().id, DNET_ID_SIZE);
+	io.expire = time(NULL) - 1;
+
+	ELLIPTICS_REQUIRE(write_expired_result, sess.write_data(io, data));
+	ELLIPTICS_REQUIRE_ERROR(read_expired_result, sess.read_data(expired_id, 0, 0), -ENOENT);
+	ELLIPTICS_REQUIRE_ERROR(lookup_expired_result, sess.lookup(expired_id), -ENOENT);
+}
+
 static void test_partial_bulk_read(session &sess)
 {
 	const std::string first_key = "first-bulk-partial-key";
@@ -1360,7 +1416,146 @@ static void test_lookup_non_existing(session &sess, int error)
 	ELLIPTICS_REQUIRE_ERROR(lookup, sess.lookup(std::string("lookup_non_existing")), error);
 }
 
+/*
+ * Identical reads sent at once are coalesced by the server, every one of them has to get the whole reply
+ */
+static void test_concurrent_reads(session &sess, const std::string &id, const std::string &data, size_t count)
+{
+	ELLIPTICS_REQUIRE(write_result, sess.write_data(id, data, 0));
+
+	std::vector<async_read_result> reads;
+	std::vector<async_read_result> partial_reads;
+	std::vector<async_read_result> missed_reads;
+
+	for (size_t i = 0; i < count; ++i) {
+		reads.emplace_back(sess.read_data(id, 0, 0));
+		partial_reads.emplace_back(sess.read_data(id, 1, 2));
+		missed_reads.emplace_back(sess.read_data(id + "-non-existing", 0, 0));
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		ELLIPTICS_REQUIRE(read_result, std::move(reads[i]));
+		BOOST_REQUIRE_EQUAL(read_result.get_one().file().to_string(), data);
+
+		ELLIPTICS_REQUIRE(partial_result, std::move(partial_reads[i]));
+		BOOST_REQUIRE_EQUAL(partial_result.get_one().file().to_string(), data.substr(1, 2));
+
+		ELLIPTICS_REQUIRE_ERROR(missed_result, std::move(missed_reads[i]), -ENOENT);
+	}
+}
+
+/*
+ * Several ranges of the object are read by single request, they are cut by the object's size
+ */
+static void test_read_ranges(session &sess, const std::string &id, const std::string &data)
+{
+	ELLIPTICS_REQUIRE(write_result, sess.write_data(id, data, 0));
+
+	std::vector<dnet_io_range> ranges(4);
+	ranges[0].offset = 0;
+	ranges[0].size = 4;
+	ranges[1].offset = 10;
+	ranges[1].size = 0;
+	ranges[2].offset = 6;
+	ranges[2].size = 2;
+	ranges[3].offset = data.size() - 2;
+	ranges[3].size = 100;
+
+	ELLIPTICS_REQUIRE(read_result, sess.read_ranges(id, ranges));
+
+	const read_result_entry &entry = read_result.get_one();
+	const std::vector<data_pointer> range_data = entry.ranges();
+
+	BOOST_REQUIRE_EQUAL(range_data.size(), ranges.size());
+	BOOST_REQUIRE_EQUAL(range_data[0].to_string(), data.substr(0, 4));
+	BOOST_REQUIRE_EQUAL(range_data[1].to_string(), data.substr(10));
+	BOOST_REQUIRE_EQUAL(range_data[2].to_string(), data.substr(6, 2));
+	BOOST_REQUIRE_EQUAL(range_data[3].to_string(), data.substr(data.size() - 2));
+	BOOST_REQUIRE_EQUAL(entry.file().to_string(), data.substr(0, 4) + data.substr(10) + data.substr(6, 2) + data.substr(data.size() - 2));
+
+	ranges[2].offset = data.size();
+	ELLIPTICS_REQUIRE_ERROR(out_of_range_result, sess.read_ranges(id, ranges), -E2BIG);
+}
+
+/*
+ * Striped object is read back as a whole, plain object is not mistaken for it
+ */
+static void test_striped_object(session &sess, const std::string &id, size_t size, uint64_t stripe_size)
+{
+	std::string data(size, '\0');
+	for (size_t i = 0; i < size; ++i)
+		data[i] = 'a' + i % 26 + i / 26 % 7;
+
+	ELLIPTICS_REQUIRE(write_result, sess.write_striped(id, data_pointer::copy(data), stripe_size));
+
+	ELLIPTICS_REQUIRE(read_result, sess.read_striped(id));
+	BOOST_REQUIRE_EQUAL(read_result.get_one().file().to_string(), data);
+
+	// overwrite by the smaller object with other content, it has fewer stripes than the previous version
+	const std::string smaller(data.rbegin(), data.rbegin() + size / 3 + 1);
+
+	ELLIPTICS_REQUIRE(overwrite_result, sess.write_striped(id, data_pointer::copy(smaller), stripe_size));
+
+	ELLIPTICS_REQUIRE(overwritten_read_result, sess.read_striped(id));
+	BOOST_REQUIRE_EQUAL(overwritten_read_result.get_one().file().to_string(), smaller);
+
+	ELLIPTICS_REQUIRE(plain_write_result, sess.write_data(id + "-plain", data, 0));
+	ELLIPTICS_REQUIRE_ERROR(plain_read_result, sess.read_striped(id + "-plain"), -EINVAL);
+
+	ELLIPTICS_REQUIRE(remove_result, sess.remove_striped(id));
+	ELLIPTICS_REQUIRE_ERROR(removed_read_result, sess.read_striped(id), -ENOENT);
+}
+
 #ifndef NO_SERVER
+/*
+ * Returns "scrub" section of statistics of the backend of group 3
+ */
+static rapidjson::Value &scrub_stat(session &sess, rapidjson::Document &doc)
+{
+	ELLIPTICS_REQUIRE(stat_result, sess.monitor_stat(global_data->nodes[2].remote(), DNET_MONITOR_BACKEND));
+
+	const std::string json = stat_result.get_one().statistics();
+	doc.Parse<0>(json.c_str());
+	BOOST_REQUIRE(!doc.HasParseError());
+	BOOST_REQUIRE(doc.HasMember("backends") && doc["backends"].HasMember("0"));
+
+	rapidjson::Value &backend = doc["backends"]["0"];
+	BOOST_REQUIRE(backend.HasMember("scrub"));
+	return backend["scrub"];
+}
+
+/*
+ * Record becomes fresh after scrubber's pass which started after the write, so it is read without checksum
+ * verification, its rewrite makes it not fresh and it is read with verification until the next pass
+ */
+static void test_scrub(session &sess, const std::string &id, const std::string &data)
+{
+	const time_t write_time = time(NULL);
+
+	ELLIPTICS_REQUIRE(write_result, sess.write_data(id, data, 0));
+
+	rapidjson::Document doc;
+	for (int i = 0; ; ++i) {
+		rapidjson::Value &scrub = scrub_stat(sess, doc);
+		if (scrub["last_start"].GetInt64() > write_time) {
+			BOOST_REQUIRE_GE(scrub["verified_records"].GetUint64(), 1);
+			BOOST_REQUIRE_EQUAL(scrub["corrupted_records"].GetUint64(), 0);
+			BOOST_REQUIRE_EQUAL(scrub["failed_records"].GetUint64(), 0);
+			BOOST_REQUIRE_GE(scrub["fresh_slices"].GetUint64(), 1);
+			break;
+		}
+
+		BOOST_REQUIRE_LT(i, 300);
+		usleep(100 * 1000);
+	}
+
+	ELLIPTICS_COMPARE_REQUIRE(fresh_read_result, sess.read_data(id, 0, 0), data);
+
+	const std::string new_data = data + "-rewritten";
+	ELLIPTICS_REQUIRE(rewrite_result, sess.write_data(id, new_data, 0));
+	ELLIPTICS_COMPARE_REQUIRE(rewritten_read_result, sess.read_data(id, 0, 0), new_data);
+}
+
 static void test_requests_to_own_server(session &sess)
 {
 	key id = std::string("own-requests-id");
@@ -1389,6 +1584,7 @@ bool register_tests(test_suite *suite, node n)
 	ELLIPTICS_TEST_CASE(test_write, create_session(n, {1, 2}, 0, 0), "new-id-real", "new-data-long");
 	ELLIPTICS_TEST_CASE(test_write, create_session(n, {1, 2}, 0, 0), "new-id-real", "short");
 	ELLIPTICS_TEST_CASE(test_remove, create_session(n, {1, 2}, 0, 0), "new-id-real");
+	ELLIPTICS_TEST_CASE(test_write_replicated, create_session(n, {1, 2}, 0, DNET_IO_FLAGS_REPLICATE), "replicated-id", "replicated-data");
 	ELLIPTICS_TEST_CASE(test_recovery, create_session(n, {1, 2}, 0, 0), "recovery-id", "recovered-data");
 	ELLIPTICS_TEST_CASE(test_indexes, create_session(n, {1, 2}, 0, 0));
 	ELLIPTICS_TEST_CASE(test_more_indexes, create_session(n, {1, 2}, 0, 0));
@@ -1412,6 +1608,7 @@ bool register_tests(test_suite *suite, node n)
 	ELLIPTICS_TEST_CASE(test_range_request, create_session(n, {2}, 0, 0), 3, 14, 2);
 	ELLIPTICS_TEST_CASE(test_range_request, create_session(n, {2}, 0, 0), 7, 3, 2);
 	ELLIPTICS_TEST_CASE(test_metadata, create_session(n, {1, 2}, 0, 0), "metadata-key", "meta-data");
+	ELLIPTICS_TEST_CASE(test_expire, create_session(n, {1, 2}, 0, 0), "expire-key", "expire-data");
 	ELLIPTICS_TEST_CASE(test_partial_bulk_read, create_session(n, {1, 2, 3}, 0, 0));
 	ELLIPTICS_TEST_CASE(test_indexes_update, create_session(n, {2}, 0, 0));
 	ELLIPTICS_TEST_CASE(test_prepare_latest, create_session(n, {1, 2}, 0, 0), "prepare-latest-key");
@@ -1432,8 +1629,13 @@ bool register_tests(test_suite *suite, node n)
 	ELLIPTICS_TEST_CASE(test_lookup_non_existing, create_session(n, { 1, 2 }, 0, 0), -ENOENT);
 	ELLIPTICS_TEST_CASE(test_lookup_non_existing, create_session(n, { 1 }, 0, 0), -ENOENT);
 	ELLIPTICS_TEST_CASE(test_lookup_non_existing, create_session(n, { 99 }, 0, 0), -ENXIO);
+	ELLIPTICS_TEST_CASE(test_concurrent_reads, create_session(n, { 1 }, 0, 0), "concurrent-reads-key", "concurrent-reads-data", 100);
+	ELLIPTICS_TEST_CASE(test_read_ranges, create_session(n, { 1, 2 }, 0, 0), "read-ranges-key", "0123456789abcdef");
+	ELLIPTICS_TEST_CASE(test_striped_object, create_session(n, { 1, 2 }, 0, 0), "striped-key", 1024 * 1024 + 17, 64 * 1024);
+	ELLIPTICS_TEST_CASE(test_striped_object, create_session(n, { 1, 2 }, 0, 0), "striped-small-key", 10, 64 * 1024);
 #ifndef NO_SERVER
 	ELLIPTICS_TEST_CASE(test_requests_to_own_server, create_session(node::from_raw(global_data->nodes.front().get_native()), { 1, 2, 3 }, 0, 0));
+	ELLIPTICS_TEST_CASE(test_scrub, create_session(n, { 3 }, 0, 0), "scrub-key", "scrub-data");
 #endif
 
 	return true;